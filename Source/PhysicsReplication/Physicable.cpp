@@ -2,9 +2,152 @@
 
 
 #include "Physicable.h"
+#include "PhysicsClockSyncComponent.h"
+#include "PhysicsNetBitProfiler.h"
+#include "PhysicableInstanceRenderer.h"
+#include "PhysicableIslandSubsystem.h"
+#include "PhysicableJoinSnapshotSubsystem.h"
+#include "PhysicableSendScheduler.h"
+#include "PhysicableStateCaptureSubsystem.h"
+#include "PhysicsActivationSubsystem.h"
+#include "PhysicsReplicationTrace.h"
 
+#include "Engine/NetConnection.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
 #include "Net/UnrealNetwork.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicable, Log, All);
+
+bool FPhysicsStateActor::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	PHYSICS_NET_BIT_COUNTER(Ar, Map, "FPhysicsStateActor");
+
+	FVector Location = Transform.GetLocation();
+	bOutSuccess &= SerializePackedVector<100, 30>(Location, Ar);
+	PHYSICS_NET_BIT_FIELD("Location");
+
+	FRotator Rotation = Transform.Rotator();
+	Rotation.SerializeCompressedShort(Ar);
+	PHYSICS_NET_BIT_FIELD("Rotation");
+
+	uint8 bHasScale = Transform.GetScale3D().Equals(FVector::OneVector) ? 0 : 1;
+	Ar.SerializeBits(&bHasScale, 1);
+
+	FVector Scale = Transform.GetScale3D();
+	if (bHasScale)
+	{
+		Ar << Scale;
+	}
+	PHYSICS_NET_BIT_FIELD("Scale");
+
+	bOutSuccess &= SerializePackedVector<10, 24>(Velocity, Ar);
+	PHYSICS_NET_BIT_FIELD("Velocity");
+
+	Ar << ServerDeltaTime;
+	PHYSICS_NET_BIT_FIELD("ServerDeltaTime");
+
+	uint8 bInIsland = IsInIsland() ? 1 : 0;
+	Ar.SerializeBits(&bInIsland, 1);
+
+	if (bInIsland)
+	{
+		Ar << IslandId;
+		Ar << IslandSize;
+		Ar << ServerTimeStamp;
+	}
+	else
+	{
+		// Milliseconds, wrapped to 16 bits. The receiver unwraps it against its estimate of the server time.
+		uint16 WrappedTimeStamp = Ar.IsSaving() ? GetWrappedTimeStamp() : 0;
+		Ar << WrappedTimeStamp;
+
+		if (Ar.IsLoading())
+		{
+			IslandId = 0;
+			IslandSize = 1;
+			ServerTimeStamp = WrappedTimeStamp / 1000.f;
+		}
+	}
+	PHYSICS_NET_BIT_FIELD("Island");
+
+	if (Ar.IsLoading())
+	{
+		Transform = FTransform(Rotation, Location, bHasScale ? Scale : FVector::OneVector);
+	}
+
+	return true;
+}
+
+uint32 FPhysicsStateActor::GetQuantizedHash() const
+{
+	const FVector Location = Transform.GetLocation();
+	const FRotator Rotation = Transform.Rotator();
+
+	// Same rounding as SerializePackedVector<100, 30> and FRotator::SerializeCompressedShort.
+	const int32 Quantized[] =
+	{
+		FMath::RoundToInt(Location.X * 100.f),
+		FMath::RoundToInt(Location.Y * 100.f),
+		FMath::RoundToInt(Location.Z * 100.f),
+		FRotator::CompressAxisToShort(Rotation.Pitch),
+		FRotator::CompressAxisToShort(Rotation.Yaw),
+		FRotator::CompressAxisToShort(Rotation.Roll),
+	};
+
+	return FCrc::MemCrc32(Quantized, sizeof(Quantized));
+}
+
+void FPhysicableInterpolator::OnStateReceived(const FPhysicsStateActor& NewState, const FTransform& CurrentTransform, const FVector& InStartVelocity)
+{
+	// Server time between the two states when both are stamped, free of the jitter in their arrival times.
+	const float ServerInterval = NewState.ServerTimeStamp - TargetState.ServerTimeStamp;
+	TimeBetweenLastUpdates = (TargetState.ServerTimeStamp > 0.f && ServerInterval > 0.f) ? ServerInterval : TimeSinceUpdate;
+	TimeSinceUpdate = 0;
+
+	StartTransform.SetLocation(CurrentTransform.GetLocation());
+	StartTransform.SetRotation(CurrentTransform.GetRotation());
+
+	StartVelocity = InStartVelocity;
+	TargetState = NewState;
+}
+
+bool FPhysicableInterpolator::Tick(float DeltaTime, FTransform& OutTransform)
+{
+	TimeSinceUpdate += DeltaTime;
+
+	if (TimeBetweenLastUpdates < KINDA_SMALL_NUMBER) return false;
+
+	const float LerpRatio = GetLerpRatio();
+
+	OutTransform.SetLocation(CreateSpline().InterpolateLocation(LerpRatio));
+	OutTransform.SetRotation(InterpolateRotation(LerpRatio));
+	return true;
+}
+
+FHermiteCubicSpline FPhysicableInterpolator::CreateSpline() const
+{
+	FHermiteCubicSpline Spline;
+	Spline.StartLocation = StartTransform.GetLocation();
+	Spline.TargetLocation = TargetState.Transform.GetLocation();
+	Spline.StartDerivative = StartVelocity * VelocityToDerivative();
+	Spline.TargetDerivative = TargetState.Velocity * VelocityToDerivative();
+	return Spline;
+}
+
+FQuat FPhysicableInterpolator::InterpolateRotation(const float& LerpRatio) const
+{
+	return FQuat::Slerp(StartTransform.GetRotation(), TargetState.Transform.GetRotation(), LerpRatio);
+}
+
+float FPhysicableInterpolator::VelocityToDerivative() const
+{
+	return TimeBetweenLastUpdates * 100;
+}
+
 APhysicable::APhysicable()
 {
 	PrimaryActorTick.bCanEverTick = true;
@@ -20,33 +163,136 @@ APhysicable::APhysicable()
 
 	bReplicates = true;
 	SetReplicateMovement(false);
+
+	// States are pushed with ForceNetUpdate(). Set on the class default, the replication graph derives its period from it.
+	NetUpdateFrequency = 1;
 }
 
 void APhysicable::BeginPlay()
 {
 	Super::BeginPlay();
 
+	UPhysicableJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UPhysicableJoinSnapshotSubsystem>();
+	if (bUseJoinSnapshot && IsNetStartupActor() && JoinSnapshot)
+	{
+		JoinSnapshot->Register(this);
+		bInJoinSnapshot = true;
+
+		if (HasAuthority())
+		{
+			SetNetDormancy(DORM_Initial);
+		}
+	}
+
 	if (GetLocalRole() < ROLE_Authority)
 	{
 		// Physics are NOT replicated. We will need to have actor orientation
 		// replicated to us. We need to turn off physics simulation for clients.
 		Mesh->SetSimulatePhysics(false);
 		Mesh->SetEnableGravity(false);
+
+		UPhysicableInstanceRenderer* InstanceRenderer = GetWorld()->GetSubsystem<UPhysicableInstanceRenderer>();
+		if (bRenderAsInstance && InstanceRenderer)
+		{
+			InstanceTransform = Mesh->GetComponentTransform();
+			bRenderedAsInstance = InstanceRenderer->Add(this, Mesh, InstanceTransform);
+		}
+
+		if (bRenderedAsInstance)
+		{
+			// The renderer interpolates and draws us from now on.
+			Mesh->SetVisibility(false);
+			Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			SetActorTickEnabled(false);
+		}
+
+		UpdateContactEventSimulation();
 	}
 	else
 	{
-		NetUpdateFrequency = 1;
 		Mesh->SetSimulatePhysics(true);
 		Mesh->SetEnableGravity(true);
+
+		// Contacts feed the island detection.
+		BaseNetPriority = NetPriority;
+		Mesh->SetNotifyRigidBodyCollision(true);
+		Mesh->OnComponentHit.AddDynamic(this, &APhysicable::OnMeshHit);
+
+		if (UPhysicableStateCaptureSubsystem* StateCapture = GetWorld()->GetSubsystem<UPhysicableStateCaptureSubsystem>())
+		{
+			bStateCapturedAfterStep = StateCapture->Register(this, Mesh->GetBodyInstance());
+		}
+
+		if (UPhysicsActivationSubsystem* Activation = GetWorld()->GetSubsystem<UPhysicsActivationSubsystem>())
+		{
+			Activation->Register(Mesh);
+		}
+
+		if (UPhysicableSendScheduler* SendScheduler = GetWorld()->GetSubsystem<UPhysicableSendScheduler>())
+		{
+			SendScheduler->Register(this);
+			bSendScheduled = true;
+		}
+	}
+}
+
+void APhysicable::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRenderedAsInstance)
+	{
+		if (UPhysicableInstanceRenderer* InstanceRenderer = GetWorld()->GetSubsystem<UPhysicableInstanceRenderer>())
+		{
+			InstanceRenderer->Remove(this);
+		}
+		bRenderedAsInstance = false;
+	}
+
+	if (HasAuthority())
+	{
+		if (UPhysicsActivationSubsystem* Activation = GetWorld()->GetSubsystem<UPhysicsActivationSubsystem>())
+		{
+			Activation->Unregister(Mesh);
+		}
+	}
+
+	if (bSendScheduled)
+	{
+		if (UPhysicableSendScheduler* SendScheduler = GetWorld()->GetSubsystem<UPhysicableSendScheduler>())
+		{
+			SendScheduler->Unregister(this);
+		}
+		bSendScheduled = false;
 	}
+
+	if (bInJoinSnapshot)
+	{
+		if (UPhysicableJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UPhysicableJoinSnapshotSubsystem>())
+		{
+			JoinSnapshot->Unregister(this);
+		}
+		bInJoinSnapshot = false;
+	}
+
+	if (bStateCapturedAfterStep)
+	{
+		if (UPhysicableStateCaptureSubsystem* StateCapture = GetWorld()->GetSubsystem<UPhysicableStateCaptureSubsystem>())
+		{
+			StateCapture->Unregister(this);
+		}
+		bStateCapturedAfterStep = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void APhysicable::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	DOREPLIFETIME(APhysicable, PhysicsState);
-	DOREPLIFETIME(APhysicable, LastVelocity);
-	DOREPLIFETIME(APhysicable, VelocityDifference);
+	// A client simulating the physicable already has a newer state than the one it uploaded.
+	DOREPLIFETIME_CONDITION(APhysicable, PhysicsState, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(APhysicable, LastVelocity, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(APhysicable, VelocityDifference, COND_SkipOwner);
+	DOREPLIFETIME(APhysicable, bStreamingTransforms);
 }
 
 void APhysicable::Tick(float DeltaTime)
@@ -57,17 +303,51 @@ void APhysicable::Tick(float DeltaTime)
 			
 	if (GetWorld()->GetNetMode() != NM_Client)
 	{
-		if(Mesh->GetPhysicsLinearVelocity().SizeSquared() > 10.f)
+		FlushContactEvent();
+
+		// The simulated mesh detaches from Scene. Keep the actor on it, the replication graph spatializes by actor location.
+		if (Mesh->GetAttachParent() != Scene)
 		{
-			VelocityDifference = LastVelocity - Mesh->GetPhysicsLinearVelocity();
-			LastVelocity = Mesh->GetPhysicsLinearVelocity();
-			ServerTick(DeltaTime);
+			Scene->SetWorldLocation(Mesh->GetComponentLocation());
+		}
+
+		if (IsClientAuthoritative())
+		{
+			// Driven by ServerUploadPhysicsState() until the simulating player lets go.
+			if (!IsValid(SimulatingController) || GetWorld()->GetTimeSeconds() - LastContactTime > ClientAuthorityContactTimeout)
+			{
+				RevokeClientAuthority();
+			}
+			UpdateDormancy(true, DeltaTime);
+			return;
+		}
+
+		const bool bIsMoving = IsMoving();
+		if(bIsMoving)
+		{
+			// Otherwise sampled after the physics step, see ApplyCapturedState().
+			if (!bStateCapturedAfterStep)
+			{
+				// Replicated, so only changed with the keyframes when sending contact events.
+				if (!IsSendingContactEvents())
+				{
+					VelocityDifference = LastVelocity - Mesh->GetPhysicsLinearVelocity();
+					LastVelocity = Mesh->GetPhysicsLinearVelocity();
+				}
+
+				// Island members are sent together by UPhysicableIslandSubsystem.
+				if (!IsIslandMember())
+				{
+					ServerTick(DeltaTime);
+				}
+			}
 		}
 		else
 		{
 			VelocityDifference = FVector::ZeroVector;
 			LastVelocity = FVector::ZeroVector;
 		}
+		UpdateDormancy(bIsMoving || IsIslandMember(), DeltaTime);
 		/////////////////////////////////
 		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red,
 			FString::Printf(TEXT("Server %s"), *PhysicsState.Transform.GetLocation().ToString())
@@ -81,22 +361,74 @@ void APhysicable::Tick(float DeltaTime)
 			FString::Printf(TEXT("Server %s"), *GetActorLocation().ToString())
 			);
 		/////////////////////////////////
-		ClientTick(DeltaTime);
+		if (bSimulatingLocally)
+		{
+			ClientAuthorityTick(DeltaTime);
+		}
+		else if (!bSimulatingContactEvents)
+		{
+			ClientTick(DeltaTime);
+		}
 	}
 }
 
 void APhysicable::ServerTick(float DeltaTime)
 {
+	if (IsSendingContactEvents())
+	{
+		TimeSinceKeyframe += DeltaTime;
+		if (TimeSinceKeyframe < KeyframeInterval)
+		{
+			return;
+		}
+
+		DeltaTime = TimeSinceKeyframe;
+		TimeSinceKeyframe = 0;
+
+		// Clients extrapolate the keyframe with it.
+		VelocityDifference = FVector::ZeroVector;
+		LastVelocity = Mesh->GetPhysicsLinearVelocity();
+
+		if (!bSendScheduled)
+		{
+			UpdatePhysicsState(DeltaTime);
+			ForceNetUpdate();
+			return;
+		}
+	}
+
+	if (bSendScheduled)
+	{
+		ScheduledSendDeltaTime += DeltaTime;
+		GetWorld()->GetSubsystem<UPhysicableSendScheduler>()->RequestSend(this);
+		return;
+	}
+
 	UpdatePhysicsState(DeltaTime);
 }
 
+void APhysicable::SendScheduledState()
+{
+	// Joined an island, handed to a client or went to rest while waiting; those send their states themselves.
+	if (IsIslandMember() || IsClientAuthoritative() || NetDormancy > DORM_Awake)
+	{
+		ScheduledSendDeltaTime = 0;
+		return;
+	}
+
+	// Scheduled at the end of the frame, after the physics step and the captured states.
+	UpdatePhysicsState(ScheduledSendDeltaTime);
+	ScheduledSendDeltaTime = 0;
+	ForceNetUpdate();
+}
+
 void APhysicable::ClientTick(float DeltaTime)
 {
-	ClientTimeSinceUpdate += DeltaTime;
+	Interpolator.TimeSinceUpdate += DeltaTime;
 
-	if (ClientTimeBetweenLastUpdates < KINDA_SMALL_NUMBER) return;
+	if (Interpolator.TimeBetweenLastUpdates < KINDA_SMALL_NUMBER) return;
 
-	const float LerpRatio = ClientTimeSinceUpdate / ClientTimeBetweenLastUpdates;
+	const float LerpRatio = Interpolator.GetLerpRatio();
 
 	const FHermiteCubicSpline Spline = CreateSpline();
 
@@ -105,22 +437,374 @@ void APhysicable::ClientTick(float DeltaTime)
 	InterpolateRotation(LerpRatio);
 }
 
+const FTransform& APhysicable::TickInstance(float DeltaTime)
+{
+	if (Interpolator.Tick(DeltaTime, InstanceTransform) && Interpolator.GetLerpRatio() < 1.f)
+	{
+		return InstanceTransform;
+	}
+
+	// Held on the target instead of extrapolating the spline until the next state, so the renderer can leave the instance alone.
+	if (Interpolator.TimeBetweenLastUpdates >= KINDA_SMALL_NUMBER)
+	{
+		InstanceTransform.SetLocation(Interpolator.TargetState.Transform.GetLocation());
+		InstanceTransform.SetRotation(Interpolator.TargetState.Transform.GetRotation());
+	}
+
+	bInstanceMoving = false;
+	InstanceStopTime = GetWorld()->GetTimeSeconds();
+	return InstanceTransform;
+}
+
 void APhysicable::UpdatePhysicsState(float DeltaTime)
 {
-	PhysicsState.Transform  = Mesh->GetComponentTransform();
+	UpdatePhysicsState(Mesh->GetComponentTransform(), DeltaTime);
+}
+
+void APhysicable::UpdatePhysicsState(const FTransform& Transform, float DeltaTime)
+{
+	PhysicsState.Transform  = FTransform(Transform.GetRotation(), Transform.GetLocation(), Mesh->GetComponentScale());
 	PhysicsState.Velocity	= VelocityDifference;
 	PhysicsState.ServerDeltaTime	= DeltaTime;
+	PhysicsState.ServerTimeStamp	= GetWorld()->GetTimeSeconds();
+
+	FPhysicsTraceRecorder& Recorder = FPhysicsTraceRecorder::Get();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordState(this, EPhysicsTraceSource::Server, PhysicsState, VelocityDifference);
+	}
+
 	OnRep_PhysicsState();
 }
 
+void APhysicable::ApplyCapturedState(const FTransform& Transform, const FVector& LinearVelocity, float DeltaTime)
+{
+	// Uploaded by the simulating client instead.
+	if (IsClientAuthoritative() || LinearVelocity.SizeSquared() <= 10.f)
+	{
+		return;
+	}
+
+	// Island members are sent together by UPhysicableIslandSubsystem.
+	if (IsIslandMember())
+	{
+		VelocityDifference = LastVelocity - LinearVelocity;
+		LastVelocity = LinearVelocity;
+		return;
+	}
+
+	// Keyframes only, see ServerTick().
+	if (IsSendingContactEvents())
+	{
+		ServerTick(DeltaTime);
+		return;
+	}
+
+	VelocityDifference = LastVelocity - LinearVelocity;
+	LastVelocity = LinearVelocity;
+
+	if (bSendScheduled)
+	{
+		ServerTick(DeltaTime);
+		return;
+	}
+
+	UpdatePhysicsState(Transform, DeltaTime);
+}
+
+bool APhysicable::IsMoving() const
+{
+	return Mesh->GetPhysicsLinearVelocity().SizeSquared() > 10.f;
+}
+
+bool APhysicable::GetClientStateHash(uint16& OutTimeStamp, uint32& OutHash) const
+{
+	if (bSimulatingLocally || bSimulatingContactEvents || Interpolator.TargetState.ServerTimeStamp <= 0.f)
+	{
+		return false;
+	}
+
+	// Still on its way to the state: what it shows is not comparable with anything the server sent.
+	if (Interpolator.TimeBetweenLastUpdates >= KINDA_SMALL_NUMBER && Interpolator.GetLerpRatio() < 1.f)
+	{
+		return false;
+	}
+
+	// What is shown, which drifts from the received state once the spline is extrapolated past it.
+	FPhysicsStateActor Shown = Interpolator.TargetState;
+	Shown.Transform = bRenderedAsInstance ? InstanceTransform : Mesh->GetComponentTransform();
+
+	OutTimeStamp = Interpolator.TargetState.GetWrappedTimeStamp();
+	OutHash = Shown.GetQuantizedHash();
+	return true;
+}
+
+EPhysicsStateHashCheck APhysicable::CheckClientStateHash(uint16 TimeStamp, uint32 Hash) const
+{
+	// The owner simulates it, the others get its uploads.
+	if (IsClientAuthoritative())
+	{
+		return EPhysicsStateHashCheck::Unknown;
+	}
+
+	if (TimeStamp == PhysicsState.GetWrappedTimeStamp() && Hash == PhysicsState.GetQuantizedHash())
+	{
+		return EPhysicsStateHashCheck::Match;
+	}
+
+	// The next state corrects a moving physicable anyway.
+	return IsMoving() ? EPhysicsStateHashCheck::Unknown : EPhysicsStateHashCheck::Mismatch;
+}
+
+void APhysicable::ApplySnapshotState(const FPhysicsStateActor& State)
+{
+	// Built when the client joined; a state replicated since then is newer.
+	const float ServerTimeStamp = State.IsInIsland() ? State.ServerTimeStamp : UPhysicsClockSyncComponent::UnwrapServerTime(State.ServerTimeStamp, UPhysicsClockSyncComponent::GetServerTime(this));
+	if (ServerTimeStamp < PhysicsState.ServerTimeStamp)
+	{
+		return;
+	}
+
+	SnapToState(State);
+}
+
+void APhysicable::ApplyResentState(const FPhysicsStateActor& State)
+{
+	// Replaying it through OnRep_PhysicsState() would interpolate from a state with the same time stamp, over a stale interval.
+	SnapToState(State);
+}
+
+void APhysicable::SnapToState(const FPhysicsStateActor& State)
+{
+	PhysicsState = State;
+	if (!PhysicsState.IsInIsland())
+	{
+		PhysicsState.ServerTimeStamp = UPhysicsClockSyncComponent::UnwrapServerTime(State.ServerTimeStamp, UPhysicsClockSyncComponent::GetServerTime(this));
+	}
+	VelocityDifference = FVector::ZeroVector;
+
+	// Hold still on the state until the next one, if it ever moves again.
+	Interpolator.TargetState = PhysicsState;
+	Interpolator.StartTransform = PhysicsState.Transform;
+	Interpolator.StartVelocity = FVector::ZeroVector;
+	Interpolator.TimeSinceUpdate = 0;
+	Interpolator.TimeBetweenLastUpdates = 0;
+
+	if (bRenderedAsInstance)
+	{
+		InstanceTransform = PhysicsState.Transform;
+		bInstanceMoving = true;
+		return;
+	}
+
+	Mesh->SetWorldTransform(PhysicsState.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void APhysicable::JoinIsland(float SharedNetPriority)
+{
+	bIslandMember = true;
+	NetPriority = SharedNetPriority;
+}
+
+void APhysicable::SendIslandState(uint16 IslandId, uint8 IslandSize, float ServerTimeStamp, float SharedNetPriority, float DeltaTime)
+{
+	PhysicsState.IslandId = IslandId;
+	PhysicsState.IslandSize = IslandSize;
+	NetPriority = SharedNetPriority;
+
+	if (NetDormancy > DORM_Awake)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	UpdatePhysicsState(DeltaTime);
+	PhysicsState.ServerTimeStamp = ServerTimeStamp;
+
+	ForceNetUpdate();
+}
+
+void APhysicable::LeaveIsland()
+{
+	bIslandMember = false;
+	PhysicsState.IslandId = 0;
+	PhysicsState.IslandSize = 1;
+	NetPriority = BaseNetPriority;
+}
+
+void APhysicable::GrantClientAuthority(APlayerController* PlayerController)
+{
+	SimulatingController = PlayerController;
+	SetOwner(PlayerController);
+	LastClientStateTime = GetWorld()->GetTimeSeconds();
+
+	// Held in place between uploads. Bodies simulated by the server still collide with it.
+	Mesh->SetSimulatePhysics(false);
+
+	if (NetDormancy > DORM_Awake)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+	ForceNetUpdate();
+}
+
+void APhysicable::RevokeClientAuthority()
+{
+	SimulatingController = nullptr;
+	SetOwner(nullptr);
+
+	Mesh->SetSimulatePhysics(true);
+	Mesh->SetPhysicsLinearVelocity(LastVelocity);
+
+	TimeAtRest = 0;
+	ForceNetUpdate();
+}
+
+bool APhysicable::RouteClientAuthorityImpulse(const FVector& Impulse, const FVector& Location, const AController* Instigator)
+{
+	if (Instigator != nullptr && Instigator == SimulatingController)
+	{
+		ClientApplyImpulse(Impulse, Location);
+		return true;
+	}
+
+	// Another player's shot contests the simulation, as a contact from another player does.
+	UE_LOG(LogPhysicable, Verbose, TEXT("%s: hit by %s while simulated by %s, taking the simulation back"), *GetName(), *GetNameSafe(Instigator), *GetNameSafe(SimulatingController));
+	RevokeClientAuthority();
+	return false;
+}
+
+void APhysicable::ClientApplyImpulse_Implementation(FVector_NetQuantize10 Impulse, FVector_NetQuantize Location)
+{
+	if (bSimulatingLocally)
+	{
+		Mesh->AddImpulseAtLocation(Impulse, Location);
+	}
+}
+
+void APhysicable::ClientAuthorityTick(float DeltaTime)
+{
+	TimeSinceStateUpload += DeltaTime;
+	if (TimeSinceStateUpload < 1.f / ClientAuthoritySendRate)
+	{
+		return;
+	}
+
+	// Built like the server's states, so the other clients interpolate it the same way.
+	const FVector LinearVelocity = Mesh->GetPhysicsLinearVelocity();
+
+	FPhysicsStateActor State;
+	State.Transform			= Mesh->GetComponentTransform();
+	State.Velocity			= LastVelocity - LinearVelocity;
+	State.ServerDeltaTime	= TimeSinceStateUpload;
+
+	LastVelocity = LinearVelocity;
+	TimeSinceStateUpload = 0;
+
+	ServerUploadPhysicsState(State, LinearVelocity);
+}
+
+void APhysicable::ServerUploadPhysicsState_Implementation(const FPhysicsStateActor& State, FVector_NetQuantize10 LinearVelocity)
+{
+	// Late upload from a player that lost the authority.
+	if (SimulatingController == nullptr)
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (!IsPlausibleClientState(State, LinearVelocity, Now - LastClientStateTime))
+	{
+		UE_LOG(LogPhysicable, Warning, TEXT("%s: implausible state from %s, taking the simulation back"), *GetName(), *GetNameSafe(SimulatingController));
+		RevokeClientAuthority();
+		return;
+	}
+
+	LastClientStateTime = Now;
+
+	Mesh->SetWorldTransform(State.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	VelocityDifference = State.Velocity;
+	LastVelocity = LinearVelocity;
+
+	UpdatePhysicsState(State.ServerDeltaTime);
+	ForceNetUpdate();
+}
+
+bool APhysicable::IsPlausibleClientState(const FPhysicsStateActor& State, const FVector& LinearVelocity, float ElapsedTime) const
+{
+	if (State.Transform.ContainsNaN() || LinearVelocity.ContainsNaN() || !State.Transform.GetScale3D().Equals(Mesh->GetComponentScale()))
+	{
+		return false;
+	}
+
+	if (LinearVelocity.SizeSquared() > FMath::Square(ClientAuthorityMaxSpeed))
+	{
+		return false;
+	}
+
+	const float MaxDistance = ClientAuthorityMaxSpeed * ElapsedTime + ClientAuthorityLocationTolerance;
+	return FVector::DistSquared(State.Transform.GetLocation(), Mesh->GetComponentLocation()) <= FMath::Square(MaxDistance);
+}
+
+void APhysicable::OnPlayerContact(APlayerController* PlayerController)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	const bool bContested = LastContactController.IsValid() && LastContactController.Get() != PlayerController && Now - LastContactTime < ClientAuthorityContactTimeout;
+
+	LastContactController = PlayerController;
+	LastContactTime = Now;
+
+	if (bContested)
+	{
+		// Several players interacting, only the server can settle it.
+		if (IsClientAuthoritative())
+		{
+			RevokeClientAuthority();
+		}
+		return;
+	}
+
+	// Listen server hosts already see the server simulation without lag. Islands are simulated as a whole by the server.
+	if (!IsClientAuthoritative() && bAllowClientAuthority && !bRenderAsInstance && !PlayerController->IsLocalController() && !IsIslandMember()
+		&& !IsSendingContactEvents())
+	{
+		GrantClientAuthority(PlayerController);
+	}
+}
+
+void APhysicable::UpdateDormancy(bool bIsMoving, float DeltaTime)
+{
+	if (bIsMoving)
+	{
+		TimeAtRest = 0;
+		if (NetDormancy > DORM_Awake)
+		{
+			SetNetDormancy(DORM_Awake);
+		}
+		return;
+	}
+
+	TimeAtRest += DeltaTime;
+
+	if (RestTimeBeforeDormancy > 0 && TimeAtRest >= RestTimeBeforeDormancy && NetDormancy == DORM_Awake)
+	{
+		// Send the resting transform once more, clients keep it while we are dormant. Late joiners get it from the join snapshot.
+		UpdatePhysicsState(DeltaTime);
+
+		// At rest the clients agree with us again, the next movement starts with contact events.
+		if (bStreamingTransforms)
+		{
+			bStreamingTransforms = false;
+			KeyframeErrorEstimates.Reset();
+			TimeSinceKeyframe = 0;
+		}
+
+		SetNetDormancy(bInJoinSnapshot ? DORM_Initial : DORM_DormantAll);
+	}
+}
+
 FHermiteCubicSpline APhysicable::CreateSpline() const
 {
-	FHermiteCubicSpline Spline;
-	Spline.StartLocation = ClientTransform.GetLocation();
-	Spline.TargetLocation = PhysicsState.Transform.GetLocation();
-	Spline.StartDerivative = ClientStartVelocity * VelocityToDerivative();
-	Spline.TargetDerivative = PhysicsState.Velocity * VelocityToDerivative();
-	return Spline;
+	return Interpolator.CreateSpline();
 }
 
 void APhysicable::InterpolateLocation(const FHermiteCubicSpline& Spline, const float& LerpRatio) const
@@ -137,34 +821,296 @@ void APhysicable::InterpolateVelocity(const FHermiteCubicSpline& Spline, const f
 
 void APhysicable::InterpolateRotation(const float& LerpRatio) const
 {
-	const FQuat TargetRotation = PhysicsState.Transform.GetRotation();
-	const FQuat StartRotation = ClientTransform.GetRotation();
-	const FQuat NewRotation = FQuat::Slerp(StartRotation, TargetRotation, LerpRatio);
-	Mesh->SetWorldRotation(NewRotation);
+	Mesh->SetWorldRotation(Interpolator.InterpolateRotation(LerpRatio));
 }
 
 float APhysicable::VelocityToDerivative() const
 {
-	return ClientTimeBetweenLastUpdates * 100;
+	return Interpolator.VelocityToDerivative();
+}
+
+void APhysicable::OnMeshHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	// Clients simulate contacts between bodies replicated with contact events themselves.
+	APhysicable* OtherPhysicable = Cast<APhysicable>(OtherActor);
+	UPhysicableIslandSubsystem* IslandSubsystem = GetWorld()->GetSubsystem<UPhysicableIslandSubsystem>();
+	if (OtherPhysicable && IslandSubsystem && !IsSendingContactEvents() && !OtherPhysicable->IsSendingContactEvents())
+	{
+		IslandSubsystem->ReportContact(this, OtherPhysicable);
+	}
+
+	// So do they with the level, but pawns and other kinematic movers do not push their bodies the way they push ours.
+	if (IsSendingContactEvents() && OtherComp && !OtherComp->IsSimulatingPhysics() && OtherComp->Mobility == EComponentMobility::Movable)
+	{
+		// Pointing away from the contact.
+		FVector Impulse = NormalImpulse;
+		if ((Impulse | (Mesh->GetCenterOfMass() - Hit.ImpactPoint)) < 0.f)
+		{
+			Impulse = -Impulse;
+		}
+		AddContactEvent(Impulse, Hit.ImpactPoint, OtherActor);
+	}
+
+	const APawn* Pawn = Cast<APawn>(OtherActor);
+	if (APlayerController* PlayerController = Pawn ? Cast<APlayerController>(Pawn->GetController()) : nullptr)
+	{
+		OnPlayerContact(PlayerController);
+	}
+}
+
+void APhysicable::OnRep_Owner()
+{
+	Super::OnRep_Owner();
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	const bool bSimulate = PlayerController && PlayerController->IsLocalController();
+	if (bSimulate == bSimulatingLocally)
+	{
+		return;
+	}
+
+	bSimulatingLocally = bSimulate;
+	Mesh->SetSimulatePhysics(bSimulate);
+	Mesh->SetEnableGravity(bSimulate);
+
+	if (bSimulate)
+	{
+		// Continue from where the interpolation showed it.
+		Mesh->SetPhysicsLinearVelocity(LastVelocity);
+		TimeSinceStateUpload = 0;
+	}
+	else
+	{
+		// Hold still until the server's next state, instead of replaying the segment from before the handoff.
+		Interpolator.TimeSinceUpdate = 0;
+		Interpolator.TimeBetweenLastUpdates = 0;
+	}
+}
+
+void APhysicable::AddContactEvent(const FVector& Impulse, const FVector& Location, AActor* Source)
+{
+	if (!bHasPendingContactEvent)
+	{
+		PendingContactEvent.ServerTimeStamp = GetWorld()->GetTimeSeconds();
+		PendingContactEvent.Impulse = Impulse;
+		PendingContactEvent.Location = Location;
+		PendingContactEvent.Source = Source;
+		bHasPendingContactEvent = true;
+		return;
+	}
+
+	// Weighted by impulse, so the merged event keeps roughly the same torque.
+	const float PendingSize = PendingContactEvent.Impulse.Size();
+	const float Size = Impulse.Size();
+	if (PendingSize + Size > KINDA_SMALL_NUMBER)
+	{
+		PendingContactEvent.Location = (PendingContactEvent.Location * PendingSize + Location * Size) / (PendingSize + Size);
+	}
+	PendingContactEvent.Impulse += Impulse;
+
+	if (PendingContactEvent.Source != Source)
+	{
+		PendingContactEvent.Source = nullptr;
+	}
+}
+
+void APhysicable::FlushContactEvent()
+{
+	if (!bHasPendingContactEvent)
+	{
+		return;
+	}
+	bHasPendingContactEvent = false;
+
+	if (!IsSendingContactEvents())
+	{
+		return;
+	}
+
+	// Dormant actors drop multicasts.
+	if (NetDormancy > DORM_Awake)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	MulticastContactEvent(PendingContactEvent);
+	ForceNetUpdate();
+}
+
+void APhysicable::MulticastContactEvent_Implementation(const FPhysicsContactEvent& Event)
+{
+	if (GetWorld()->GetNetMode() != NM_Client || !bSimulatingContactEvents)
+	{
+		return;
+	}
+
+	// Our own pawn already pushed the local simulation.
+	const APawn* SourcePawn = Cast<APawn>(Event.Source);
+	if (SourcePawn && SourcePawn->IsLocallyControlled())
+	{
+		return;
+	}
+
+	Mesh->AddImpulseAtLocation(Event.Impulse, Event.Location);
+
+	// The server applied it a moment ago, move on by what it added since.
+	const float Lateness = FMath::Clamp(UPhysicsClockSyncComponent::GetServerTime(this) - Event.ServerTimeStamp, 0.f, MaxContactEventLateness);
+	const float Mass = Mesh->GetMass();
+	if (Lateness > 0.f && Mass > KINDA_SMALL_NUMBER)
+	{
+		Mesh->SetWorldLocation(Mesh->GetComponentLocation() + Event.Impulse / Mass * Lateness, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+}
+
+bool APhysicable::ConsumeKeyframeError(float& OutError)
+{
+	if (!bKeyframeErrorPending)
+	{
+		return false;
+	}
+
+	bKeyframeErrorPending = false;
+	OutError = KeyframeError;
+	return true;
+}
+
+void APhysicable::ReportKeyframeError(UNetConnection* Connection, float Error)
+{
+	if (!IsSendingContactEvents() || Connection == nullptr)
+	{
+		return;
+	}
+
+	// Smoothed, so one lost event does not end the contact events.
+	float& Estimate = KeyframeErrorEstimates.FindOrAdd(Connection);
+	Estimate += (Error - Estimate) * 0.5f;
+
+	TArray<float, TInlineAllocator<8>> Estimates;
+	for (auto It = KeyframeErrorEstimates.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		Estimates.Add(It.Value());
+	}
+
+	// Lower median: with two clients both have to drift.
+	Estimates.Sort();
+	const float MedianError = Estimates[(Estimates.Num() - 1) / 2];
+	if (MedianError <= ContactEventFallbackError)
+	{
+		return;
+	}
+
+	UE_LOG(LogPhysicable, Verbose, TEXT("%s: keyframe error %.1f cm, streaming transforms until it comes to rest"), *GetName(), MedianError);
+
+	bStreamingTransforms = true;
+	VelocityDifference = FVector::ZeroVector;
+	LastVelocity = Mesh->GetPhysicsLinearVelocity();
+	UpdatePhysicsState(TimeSinceKeyframe);
+	TimeSinceKeyframe = 0;
+	ForceNetUpdate();
+}
+
+void APhysicable::OnRep_StreamingTransforms()
+{
+	UpdateContactEventSimulation();
+}
+
+void APhysicable::UpdateContactEventSimulation()
+{
+	const bool bSimulate = bReplicateContactEvents && !bStreamingTransforms && !bRenderAsInstance;
+	if (bSimulate == bSimulatingContactEvents)
+	{
+		return;
+	}
+
+	bSimulatingContactEvents = bSimulate;
+	Mesh->SetSimulatePhysics(bSimulate);
+	Mesh->SetEnableGravity(bSimulate);
+
+	if (bSimulate)
+	{
+		Mesh->SetPhysicsLinearVelocity(LastVelocity);
+	}
+	else
+	{
+		// Hold still until the server's next state.
+		Interpolator.TimeSinceUpdate = 0;
+		Interpolator.TimeBetweenLastUpdates = 0;
+	}
+}
+
+void APhysicable::ApplyKeyframe()
+{
+	// The keyframe is from ServerTimeStamp, the local simulation is already at the current server time.
+	const float Lateness = FMath::Clamp(UPhysicsClockSyncComponent::GetServerTime(this) - PhysicsState.ServerTimeStamp, 0.f, MaxContactEventLateness);
+	const FVector Location = PhysicsState.Transform.GetLocation() + LastVelocity * Lateness;
+
+	KeyframeError = FVector::Dist(Mesh->GetComponentLocation(), Location);
+	bKeyframeErrorPending = true;
+
+	if (KeyframeError <= KeyframeTolerance)
+	{
+		return;
+	}
+
+	Mesh->SetWorldTransform(FTransform(PhysicsState.Transform.GetRotation(), Location, PhysicsState.Transform.GetScale3D()), false, nullptr, ETeleportType::TeleportPhysics);
+	Mesh->SetPhysicsLinearVelocity(LastVelocity);
 }
 
 void APhysicable::OnRep_PhysicsState()
 {
 	if (GetWorld()->GetNetMode() == NM_Client)
 	{
-		SimulatedProxy_PhysicsState();
+		if (!PhysicsState.IsInIsland())
+		{
+			PhysicsState.ServerTimeStamp = UPhysicsClockSyncComponent::UnwrapServerTime(PhysicsState.ServerTimeStamp, UPhysicsClockSyncComponent::GetServerTime(this));
+		}
+
+		if (bSimulatingContactEvents)
+		{
+			ApplyKeyframe();
+			return;
+		}
+
+		// Island members wait for the rest of their island so the whole group moves on the same frame.
+		UPhysicableIslandSubsystem* IslandSubsystem = GetWorld()->GetSubsystem<UPhysicableIslandSubsystem>();
+		if (PhysicsState.IsInIsland() && IslandSubsystem)
+		{
+			IslandSubsystem->BufferIslandState(this);
+		}
+		else
+		{
+			SimulatedProxy_PhysicsState();
+		}
 	}
 }
 
 void APhysicable::SimulatedProxy_PhysicsState()
 {
-	ClientTimeBetweenLastUpdates = ClientTimeSinceUpdate;
-	ClientTimeSinceUpdate = 0;
+	FPhysicsTraceRecorder& Recorder = FPhysicsTraceRecorder::Get();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordState(this, EPhysicsTraceSource::ClientReceived, PhysicsState, VelocityDifference);
+	}
 
-	ClientTransform.SetLocation(Mesh->GetComponentLocation());
-	ClientTransform.SetRotation(Mesh->GetComponentQuat());
-	
-	ClientStartVelocity = VelocityDifference;
+	if (bRenderedAsInstance)
+	{
+		if (!bInstanceMoving)
+		{
+			Interpolator.TimeSinceUpdate += GetWorld()->GetTimeSeconds() - InstanceStopTime;
+		}
+
+		// Picked up by the next UPhysicableInstanceRenderer tick.
+		Interpolator.OnStateReceived(PhysicsState, InstanceTransform, VelocityDifference);
+		bInstanceMoving = true;
+		return;
+	}
+
+	Interpolator.OnStateReceived(PhysicsState, Mesh->GetComponentTransform(), VelocityDifference);
 
 	Mesh->SetWorldLocation(PhysicsState.Transform.GetLocation());
 	Mesh->SetWorldRotation(PhysicsState.Transform.GetRotation());
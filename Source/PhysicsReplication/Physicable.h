@@ -6,6 +6,8 @@
 #include "GameFramework/Actor.h"
 #include "Physicable.generated.h"
 
+class UNetConnection;
+
 USTRUCT()
 struct FPhysicsStateActor
 {
@@ -20,12 +22,88 @@ struct FPhysicsStateActor
 	UPROPERTY()
 	float	ServerDeltaTime;
 
+	/** Server world time of the state. Shared by every member of a contact island, sent as wrapped milliseconds otherwise. */
+	UPROPERTY()
+	float	ServerTimeStamp;
+
+	/** Contact island this state was sent with (see UPhysicableIslandSubsystem). Only meaningful when IslandSize > 1. */
+	UPROPERTY()
+	uint16	IslandId;
+
+	UPROPERTY()
+	uint8	IslandSize;
+
 	FPhysicsStateActor()
 	{
 		Transform		= FTransform::Identity;
 		Velocity		= FVector::ZeroVector;
 		ServerDeltaTime		= 0.f;
+		ServerTimeStamp		= 0.f;
+		IslandId		= 0;
+		IslandSize		= 1;
 	}
+
+	bool IsInIsland() const { return IslandSize > 1; }
+
+	/** ServerTimeStamp in milliseconds, wrapped to 16 bits, as sent for states outside islands. */
+	uint16 GetWrappedTimeStamp() const { return (uint16)(FMath::RoundToInt(ServerTimeStamp * 1000.f) & 0xFFFF); }
+
+	/** Hash of the transform as quantized by NetSerialize. Equal on both sides when the client shows exactly what the server sent. */
+	uint32 GetQuantizedHash() const;
+
+	/**
+	 * Location is sent with 2 decimal places, rotation as compressed shorts, velocity with 1 decimal place.
+	 * Scale is only sent when it is not one. Island id, size and the full time stamp are only sent for island members,
+	 * other states carry the time stamp in 16 bits (see UPhysicsClockSyncComponent::UnwrapServerTime).
+	 */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+/** Impulse the server applied to a physicable replicated with contact events, see APhysicable::bReplicateContactEvents. */
+USTRUCT()
+struct FPhysicsContactEvent
+{
+	GENERATED_BODY()
+
+	/** Server world time the impulse was applied at. */
+	UPROPERTY()
+	float	ServerTimeStamp;
+
+	UPROPERTY()
+	FVector_NetQuantize10	Impulse;
+
+	/** World location the impulse was applied at. */
+	UPROPERTY()
+	FVector_NetQuantize	Location;
+
+	/** Pawn or mover that pushed the physicable, if all impulses of the frame came from the same one. */
+	UPROPERTY()
+	AActor*	Source;
+
+	FPhysicsContactEvent()
+	{
+		ServerTimeStamp		= 0.f;
+		Impulse			= FVector::ZeroVector;
+		Location		= FVector::ZeroVector;
+		Source			= nullptr;
+	}
+};
+
+/** Outcome of comparing a client's state hash with the server state, see APhysicable::CheckClientStateHash(). */
+enum class EPhysicsStateHashCheck : uint8
+{
+	Unknown,	// Nothing to compare with, e.g. a newer state is already on its way
+	Match,
+	Mismatch,
+};
+
+template<>
+struct TStructOpsTypeTraits<FPhysicsStateActor> : public TStructOpsTypeTraitsBase2<FPhysicsStateActor>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
 };
 
 struct FHermiteCubicSpline
@@ -43,6 +121,40 @@ struct FHermiteCubicSpline
 	}
 };
 
+/**
+ * Client side interpolation between the last two received physics states.
+ * Kept free of actor and component access so it can be driven offline, e.g. by FPhysicsTracePlayer.
+ */
+struct PHYSICSREPLICATION_API FPhysicableInterpolator
+{
+	float					TimeSinceUpdate { 0 };
+
+	float					TimeBetweenLastUpdates { 0 };
+
+	FTransform				StartTransform { FTransform::Identity };
+
+	FVector					StartVelocity { FVector::ZeroVector };
+
+	FPhysicsStateActor		TargetState;
+
+	/**
+	 * Start a new segment from CurrentTransform towards NewState. The server time between the two states becomes the segment duration,
+	 * or the time since the previous state arrived when they are not stamped.
+	 */
+	void					OnStateReceived(const FPhysicsStateActor& NewState, const FTransform& CurrentTransform, const FVector& InStartVelocity);
+
+	/** Advance by DeltaTime. Returns false if there is not enough data to interpolate yet. */
+	bool					Tick(float DeltaTime, FTransform& OutTransform);
+
+	float					GetLerpRatio() const { return TimeSinceUpdate / TimeBetweenLastUpdates; }
+
+	FHermiteCubicSpline		CreateSpline() const;
+
+	FQuat					InterpolateRotation(const float& LerpRatio) const;
+
+	float					VelocityToDerivative() const;
+};
+
 UCLASS()
 class PHYSICSREPLICATION_API APhysicable : public AActor
 {
@@ -55,6 +167,8 @@ public:
 protected:
 
 	virtual void			BeginPlay() override;
+
+	virtual void			EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 		
 public:		
 		
@@ -67,6 +181,24 @@ public:
 	void					ClientTick(float DeltaTime);
 		
 	void					UpdatePhysicsState(float DeltaTime);
+
+	/** Set PhysicsState from Transform, with the scale of the mesh, and VelocityDifference. */
+	void					UpdatePhysicsState(const FTransform& Transform, float DeltaTime);
+
+	/**
+	 * Client. Advance the interpolation of a physicable drawn by UPhysicableInstanceRenderer and return its instance transform.
+	 * The instance stops moving on the last received state, see IsInstanceMoving().
+	 */
+	const FTransform&		TickInstance(float DeltaTime);
+
+	/** Client. The instance has a state it has not reached yet, and UPhysicableInstanceRenderer has to tick it. */
+	bool					IsInstanceMoving() const { return bInstanceMoving; }
+
+	/** Server only. Send the state of this frame, at the time UPhysicableSendScheduler picked for it. */
+	void					SendScheduledState();
+
+	/** Server only. State of the body right after the physics step, from UPhysicableStateCaptureSubsystem. */
+	void					ApplyCapturedState(const FTransform& Transform, const FVector& LinearVelocity, float DeltaTime);
 		
 	void 					InterpolateLocation(const FHermiteCubicSpline& Spline, const float& LerpRatio) const;
 		
@@ -80,32 +212,274 @@ public:
 	
 	FHermiteCubicSpline		CreateSpline() const;
 
+	bool					IsMoving() const;
+
+	/**
+	 * Client. Wrapped time stamp of the last state received and the quantized hash of the transform shown for it, which the server
+	 * compares with the hash of the state it sent. False before the first state, while simulated locally, or until the interpolation
+	 * reached the state.
+	 */
+	bool					GetClientStateHash(uint16& OutTimeStamp, uint32& OutHash) const;
+
+	/**
+	 * Server only. Compare what a client reports to show with the last state sent. A client on an older state, or showing something
+	 * else, only mismatches once the physicable stopped moving; while it moves the next state fixes it anyway.
+	 */
+	EPhysicsStateHashCheck	CheckClientStateHash(uint16 TimeStamp, uint32 Hash) const;
+
+	/** Client. Resting state from the join snapshot: moved there at once, without interpolating. Ignored when older than the last state received. */
+	void					ApplySnapshotState(const FPhysicsStateActor& State);
+
+	/** Client. Full state resent to this client only, after its state hash did not match. Moved there at once, like a snapshot state. */
+	void					ApplyResentState(const FPhysicsStateActor& State);
+
+	float					GetBaseNetPriority() const { return BaseNetPriority; }
+
+	/** The simulated body. Detached from the actor on the server, so its location is the body's. */
+	UStaticMeshComponent*	GetMesh() const { return Mesh; }
+
+	/** Server only. Impulses and pushes are replicated as events and states only sent as keyframes, see bReplicateContactEvents. */
+	bool					IsSendingContactEvents() const { return bReplicateContactEvents && !bStreamingTransforms && !bRenderAsInstance; }
+
+	/** Server only. Replicate Impulse at Location to the clients simulating this physicable. Impulses of the same frame are sent as one event. */
+	void					AddContactEvent(const FVector& Impulse, const FVector& Location, AActor* Source = nullptr);
+
+	/** Client. Distance between the local simulation and the last keyframe, once per keyframe. False if there is no new one. */
+	bool					ConsumeKeyframeError(float& OutError);
+
+	/**
+	 * Server only. Keyframe error of the client on Connection, smoothed per connection. We go back to streaming transforms when the
+	 * median over the reporting clients stays above ContactEventFallbackError, so one lossy client does not decide for the others.
+	 */
+	void					ReportKeyframeError(UNetConnection* Connection, float Error);
+
+	/** Server only. Touching other physicables: sent with them by UPhysicableIslandSubsystem from now on, not on its own. */
+	void					JoinIsland(float SharedNetPriority);
+
+	/** Server only. Send the current state as a member of a contact island, in the same frame as the other members. */
+	void					SendIslandState(uint16 IslandId, uint8 IslandSize, float ServerTimeStamp, float SharedNetPriority, float DeltaTime);
+
+	/** Server only. Back to being replicated on its own. */
+	void					LeaveIsland();
+
+	/** Server only. Between JoinIsland() and LeaveIsland(), also before its first island state is sent. */
+	bool					IsIslandMember() const { return bIslandMember; }
+
+	/** True on the server and on the owning client while a client simulates this physicable. */
+	bool					IsClientAuthoritative() const { return SimulatingController != nullptr || bSimulatingLocally; }
+
+	/** Server only. Hand the simulation to PlayerController's client, which streams its state back with ServerUploadPhysicsState(). */
+	void					GrantClientAuthority(APlayerController* PlayerController);
+
+	/** Server only. Take the simulation back, continuing from the last state the client uploaded. */
+	void					RevokeClientAuthority();
+
+	/**
+	 * Server only. An impulse from a shot of Instigator while a client simulates this physicable, and the server holds it kinematic.
+	 * The simulating player's own shots are applied on its client and true is returned. Anyone else's shot takes the simulation back,
+	 * and returns false for the server to apply the impulse itself.
+	 */
+	bool					RouteClientAuthorityImpulse(const FVector& Impulse, const FVector& Location, const AController* Instigator);
+
+	/** Owning client. Simulate locally and upload the state at ClientAuthoritySendRate. */
+	void					ClientAuthorityTick(float DeltaTime);
+
+	/** Server only. Puts the physicable to sleep for replication once it has been at rest for RestTimeBeforeDormancy, and wakes it up when it moves again. */
+	void					UpdateDormancy(bool bIsMoving, float DeltaTime);
+
 	UFUNCTION()
-	void					OnRep_PhysicsState();	/** The object orientation on the server */
-	
+	void					OnRep_PhysicsState();
+
+	UFUNCTION()
+	void					OnRep_StreamingTransforms();
+
+	/** The simulating player is the owner, so its client starts and stops simulating when the owner replicates. */
+	virtual void			OnRep_Owner() override;
+
+	/** State simulated by the owning client. Checked against IsPlausibleClientState(), then rebroadcast to the other clients. */
+	UFUNCTION(Server, Unreliable)
+	void					ServerUploadPhysicsState(const FPhysicsStateActor& State, FVector_NetQuantize10 LinearVelocity);
+
+	/** Impulse from the simulating player's own shot, applied to the local simulation. */
+	UFUNCTION(Client, Reliable)
+	void					ClientApplyImpulse(FVector_NetQuantize10 Impulse, FVector_NetQuantize Location);
+
+	/** Unreliable: a lost event is corrected by the next keyframe. */
+	UFUNCTION(NetMulticast, Unreliable)
+	void					MulticastContactEvent(const FPhysicsContactEvent& Event);
+
+	UFUNCTION()
+	void					OnMeshHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	/** The object orientation on the server */
 	UPROPERTY(ReplicatedUsing = OnRep_PhysicsState)
 	FPhysicsStateActor			PhysicsState;
 	
 private:
 
+	/** Server only. A player's pawn touched us: hand over, keep, or take back the simulation. */
+	void					OnPlayerContact(APlayerController* PlayerController);
+
+	bool					IsPlausibleClientState(const FPhysicsStateActor& State, const FVector& LinearVelocity, float ElapsedTime) const;
+
+	/** Server only. Send the contact event gathered since the last tick. */
+	void					FlushContactEvent();
+
+	/** Client. Simulate locally while the server sends contact events, interpolate its states otherwise. */
+	void					UpdateContactEventSimulation();
+
+	/** Client. Correct the local simulation towards the keyframe in PhysicsState, extrapolated to the current server time. */
+	void					ApplyKeyframe();
+
+	/** Client. Move to State at once and hold still there until the next one. */
+	void					SnapToState(const FPhysicsStateActor& State);
+
 	TArray<FPhysicsStateActor>	UnacknowledgedPhysicsStates;
 
 	
 	float 					ClientSimulatedTime { 0 };
-					
-	float 					ClientTimeSinceUpdate { 0 };
-					
-	float 					ClientTimeBetweenLastUpdates { 0 };
 
-	FTransform				ClientTransform { FTransform::Identity };
-	
-	FVector					ClientStartVelocity { FVector::ZeroVector };
+	FPhysicableInterpolator	Interpolator;
 
 	UPROPERTY(Replicated)
 	FVector					LastVelocity { FVector::ZeroVector };
 
 	UPROPERTY(Replicated)
 	FVector					VelocityDifference { FVector::ZeroVector };
+
+	/** Seconds at rest before the physicable goes dormant. Zero or less keeps it awake. */
+	UPROPERTY(EditAnywhere, Category="Replication")
+	float					RestTimeBeforeDormancy { 1.f };
+
+	float					TimeAtRest { 0 };
+
+	/**
+	 * Level placed only. Rest in DORM_Initial, so joining clients do not open a channel for this physicable, and get its resting
+	 * state from the join snapshot instead (see UPhysicableJoinSnapshotSubsystem).
+	 */
+	UPROPERTY(EditAnywhere, Category="Replication")
+	bool					bUseJoinSnapshot { true };
+
+	/** Registered with UPhysicableJoinSnapshotSubsystem. */
+	bool					bInJoinSnapshot { false };
+
+	/** Server only. States come from ApplyCapturedState() instead of the tick. */
+	bool					bStateCapturedAfterStep { false };
+
+	/** Server only. States are sent when UPhysicableSendScheduler says so, see SendScheduledState(). */
+	bool					bSendScheduled { false };
+
+	/** Server only. Time since the last state, while waiting for the scheduler. */
+	float					ScheduledSendDeltaTime { 0 };
+
+	/**
+	 * Clients draw this physicable as an instance of a shared instanced mesh, without collision and without ticking.
+	 * Meant for small debris nobody interacts with; such physicables are never handed to a client either.
+	 */
+	UPROPERTY(EditAnywhere, Category="Replication|Client")
+	bool					bRenderAsInstance { false };
+
+	/**
+	 * Meant for simple bodies in stable scenes. Clients simulate this physicable themselves; the server sends the impulses it applies
+	 * and the pushes from pawns and movers as time stamped events, and its state every KeyframeInterval only to correct the drift.
+	 * Contacts with the level and other bodies are left to the client simulation. Falls back to streaming transforms while the
+	 * clients' keyframe errors stay above ContactEventFallbackError, until it comes to rest. Not used when rendered as an instance.
+	 */
+	UPROPERTY(EditAnywhere, Category="Replication|Contact Events")
+	bool					bReplicateContactEvents { false };
+
+	/** Seconds between two keyframes while moving. */
+	UPROPERTY(EditAnywhere, Category="Replication|Contact Events", meta=(ClampMin="0.05"))
+	float					KeyframeInterval { 1.f };
+
+	/** Clients leave their simulation alone when it is closer than this to the keyframe, in cm. */
+	UPROPERTY(EditAnywhere, Category="Replication|Contact Events", meta=(ClampMin="0"))
+	float					KeyframeTolerance { 5.f };
+
+	/** Smoothed keyframe error above which the server streams transforms instead, in cm. */
+	UPROPERTY(EditAnywhere, Category="Replication|Contact Events", meta=(ClampMin="0"))
+	float					ContactEventFallbackError { 50.f };
+
+	/** Events and keyframes older than this are only extrapolated this far, in seconds. */
+	UPROPERTY(EditAnywhere, Category="Replication|Contact Events", meta=(ClampMin="0"))
+	float					MaxContactEventLateness { 0.25f };
+
+	/** Set by the server while the keyframe error is too large for contact events. */
+	UPROPERTY(ReplicatedUsing = OnRep_StreamingTransforms)
+	bool					bStreamingTransforms { false };
+
+	/** Server only. Impulses of this frame not sent yet. */
+	FPhysicsContactEvent	PendingContactEvent;
+
+	bool					bHasPendingContactEvent { false };
+
+	float					TimeSinceKeyframe { 0 };
+
+	/** Server only. Keyframe error reported by each client, smoothed. */
+	TMap<TWeakObjectPtr<UNetConnection>, float>	KeyframeErrorEstimates;
+
+	/** Client. Simulating locally from contact events. */
+	bool					bSimulatingContactEvents { false };
+
+	/** Client. Error at the last keyframe, until reported. */
+	float					KeyframeError { 0 };
+
+	bool					bKeyframeErrorPending { false };
+
+	/** Server only. See IsIslandMember(). */
+	bool					bIslandMember { false };
+
+	/** Client. Drawn by UPhysicableInstanceRenderer. */
+	bool					bRenderedAsInstance { false };
+
+	/** Client. Current transform of the instance. */
+	FTransform				InstanceTransform { FTransform::Identity };
+
+	/** Client. See IsInstanceMoving(). */
+	bool					bInstanceMoving { false };
+
+	/** Client. World time the instance stopped at, which the interpolator did not count while it was not ticked. */
+	float					InstanceStopTime { 0 };
+
+	/** Let the only player touching this physicable simulate it on its client. */
+	UPROPERTY(EditAnywhere, Category="Replication|Client Authority")
+	bool					bAllowClientAuthority { true };
+
+	/** Seconds without a contact from the simulating player, or since another player's contact, before the server takes the simulation back. */
+	UPROPERTY(EditAnywhere, Category="Replication|Client Authority", meta=(ClampMin="0"))
+	float					ClientAuthorityContactTimeout { 0.5f };
+
+	/** States uploaded by the simulating client per second. */
+	UPROPERTY(EditAnywhere, Category="Replication|Client Authority", meta=(ClampMin="1"))
+	float					ClientAuthoritySendRate { 30.f };
+
+	/** Fastest speed a client may report. Faster states, or states further than this speed allows since the last one, revoke the authority. */
+	UPROPERTY(EditAnywhere, Category="Replication|Client Authority", meta=(ClampMin="0"))
+	float					ClientAuthorityMaxSpeed { 3000.f };
+
+	/** Distance allowed on top of ClientAuthorityMaxSpeed, for latency and the state the client started from. */
+	UPROPERTY(EditAnywhere, Category="Replication|Client Authority", meta=(ClampMin="0"))
+	float					ClientAuthorityLocationTolerance { 100.f };
+
+	/** Server only. Player whose client simulates this physicable, also set as the owner. */
+	UPROPERTY(Transient)
+	APlayerController*		SimulatingController { nullptr };
+
+	/** Server only. Last player pawn contact, to tell a single player from several. */
+	TWeakObjectPtr<APlayerController>	LastContactController;
+
+	float					LastContactTime { 0 };
+
+	/** Server only. Time the last plausible client state arrived. */
+	float					LastClientStateTime { 0 };
+
+	/** Owning client. Simulating locally. */
+	bool					bSimulatingLocally { false };
+
+	float					TimeSinceStateUpload { 0 };
+
+	/** NetPriority outside of islands. */
+	float					BaseNetPriority { 1.f };
 	
 	UPROPERTY(EditAnywhere)
 	USceneComponent* Scene { nullptr };
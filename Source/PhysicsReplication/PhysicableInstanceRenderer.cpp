@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableInstanceRenderer.h"
+#include "Physicable.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+bool UPhysicableInstanceRenderer::Add(APhysicable* Physicable, const UStaticMeshComponent* Mesh, const FTransform& Transform)
+{
+	UStaticMesh* StaticMesh = Mesh ? Mesh->GetStaticMesh() : nullptr;
+	if (StaticMesh == nullptr)
+	{
+		return false;
+	}
+
+	UMaterialInterface* Material = Mesh->GetMaterial(0);
+
+	FPhysicableInstanceGroup* Group = Groups.FindByPredicate([StaticMesh, Material](const FPhysicableInstanceGroup& Candidate)
+	{
+		return Candidate.StaticMesh == StaticMesh && Candidate.Material == Material;
+	});
+
+	if (Group == nullptr)
+	{
+		UInstancedStaticMeshComponent* Component = CreateComponent(StaticMesh, Material);
+		if (Component == nullptr)
+		{
+			return false;
+		}
+
+		Group = &Groups.AddDefaulted_GetRef();
+		Group->StaticMesh = StaticMesh;
+		Group->Material = Material;
+		Group->Component = Component;
+	}
+
+	Group->Component->AddInstanceWorldSpace(Transform);
+	Group->Members.Add(Physicable);
+	return true;
+}
+
+void UPhysicableInstanceRenderer::Remove(APhysicable* Physicable)
+{
+	for (FPhysicableInstanceGroup& Group : Groups)
+	{
+		const int32 Index = Group.Members.IndexOfByKey(Physicable);
+		if (Index != INDEX_NONE)
+		{
+			// RemoveInstance() keeps the order of the remaining instances, so do the same with the members.
+			Group.Component->RemoveInstance(Index);
+			Group.Members.RemoveAt(Index);
+			return;
+		}
+	}
+}
+
+void UPhysicableInstanceRenderer::Tick(float DeltaTime)
+{
+	for (FPhysicableInstanceGroup& Group : Groups)
+	{
+		if (Group.Members.Num() == 0 || Group.Component == nullptr)
+		{
+			continue;
+		}
+
+		// Only instances that received a state or are still interpolating one move, in runs of consecutive indices.
+		bool bUpdated = false;
+		int32 RunStart = INDEX_NONE;
+		Group.Transforms.Reset();
+
+		for (int32 Index = 0; Index <= Group.Members.Num(); Index++)
+		{
+			APhysicable* Physicable = Index < Group.Members.Num() ? Group.Members[Index].Get() : nullptr;
+			if (Physicable && Physicable->IsInstanceMoving())
+			{
+				if (RunStart == INDEX_NONE)
+				{
+					RunStart = Index;
+				}
+				Group.Transforms.Add(Physicable->TickInstance(DeltaTime));
+			}
+			else if (RunStart != INDEX_NONE)
+			{
+				Group.Component->BatchUpdateInstancesTransforms(RunStart, Group.Transforms, true, false, true);
+				Group.Transforms.Reset();
+				RunStart = INDEX_NONE;
+				bUpdated = true;
+			}
+		}
+
+		if (bUpdated)
+		{
+			Group.Component->MarkRenderStateDirty();
+		}
+	}
+}
+
+bool UPhysicableInstanceRenderer::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return !IsTemplate() && World && World->IsGameWorld() && Groups.Num() > 0;
+}
+
+TStatId UPhysicableInstanceRenderer::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicableInstanceRenderer, STATGROUP_Tickables);
+}
+
+UWorld* UPhysicableInstanceRenderer::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+UInstancedStaticMeshComponent* UPhysicableInstanceRenderer::CreateComponent(UStaticMesh* StaticMesh, UMaterialInterface* Material)
+{
+	if (ComponentOwner == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		ComponentOwner = GetWorld()->SpawnActor<AActor>(SpawnParams);
+		if (ComponentOwner == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(ComponentOwner);
+	Component->SetMobility(EComponentMobility::Movable);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetStaticMesh(StaticMesh);
+	Component->SetMaterial(0, Material);
+
+	if (ComponentOwner->GetRootComponent() == nullptr)
+	{
+		ComponentOwner->SetRootComponent(Component);
+	}
+	Component->RegisterComponent();
+
+	return Component;
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PhysicableInstanceRenderer.generated.h"
+
+class APhysicable;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+class UStaticMeshComponent;
+
+/** Physicables sharing a mesh and material, drawn by one instanced component. Instance i belongs to Members[i]. */
+USTRUCT()
+struct FPhysicableInstanceGroup
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMesh*						StaticMesh { nullptr };
+
+	UPROPERTY()
+	UMaterialInterface*					Material { nullptr };
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent*		Component { nullptr };
+
+	TArray<TWeakObjectPtr<APhysicable>>	Members;
+
+	/** Scratch array for the bulk update of a run of consecutive moving instances. */
+	TArray<FTransform>					Transforms;
+};
+
+/**
+ * Client. Draws physicables with bRenderAsInstance as instances of a shared instanced static mesh component instead of their own mesh.
+ *
+ * Those physicables do not tick: the renderer advances the interpolation of the ones that are moving once per frame, and writes
+ * each run of consecutive moving instances of a group with one BatchUpdateInstancesTransforms() call. Instances at rest on their
+ * last state cost nothing. Their own mesh stays hidden and without collision.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicableInstanceRenderer : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Draw Physicable as an instance of Mesh's static mesh. Returns false if Mesh has nothing to instance. */
+	bool					Add(APhysicable* Physicable, const UStaticMeshComponent* Mesh, const FTransform& Transform);
+
+	void					Remove(APhysicable* Physicable);
+
+	virtual void			Tick(float DeltaTime) override;
+
+	virtual bool			IsTickable() const override;
+
+	virtual TStatId			GetStatId() const override;
+
+	/** Tick with the world, so instances move with the frame the world renders. */
+	virtual UWorld*			GetTickableGameObjectWorld() const override;
+
+private:
+
+	UInstancedStaticMeshComponent*	CreateComponent(UStaticMesh* StaticMesh, UMaterialInterface* Material);
+
+	UPROPERTY()
+	TArray<FPhysicableInstanceGroup>	Groups;
+
+	/** Owns the instanced components. */
+	UPROPERTY()
+	AActor*					ComponentOwner { nullptr };
+};
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableIslandSubsystem.h"
+#include "Physicable.h"
+#include "PhysicableSendScheduler.h"
+
+void UPhysicableIslandSubsystem::ReportContact(APhysicable* A, APhysicable* B)
+{
+	if (A == B)
+	{
+		return;
+	}
+
+	if (B < A)
+	{
+		Swap(A, B);
+	}
+
+	Contacts.Add(TPair<TWeakObjectPtr<APhysicable>, TWeakObjectPtr<APhysicable>>(A, B), GetWorld()->GetTimeSeconds());
+}
+
+void UPhysicableIslandSubsystem::BufferIslandState(APhysicable* Physicable)
+{
+	const FPhysicsStateActor& State = Physicable->PhysicsState;
+
+	// A newer state replaces whatever this physicable was still waiting with.
+	for (FPendingIsland& Island : PendingIslands)
+	{
+		Island.Members.Remove(Physicable);
+	}
+
+	FPendingIsland* Island = PendingIslands.FindByPredicate([&State](const FPendingIsland& Pending)
+	{
+		return Pending.IslandId == State.IslandId && Pending.ServerTimeStamp == State.ServerTimeStamp;
+	});
+
+	if (Island == nullptr)
+	{
+		Island = &PendingIslands.AddDefaulted_GetRef();
+		Island->IslandId = State.IslandId;
+		Island->ServerTimeStamp = State.ServerTimeStamp;
+		Island->IslandSize = State.IslandSize;
+		Island->FirstReceivedTime = GetWorld()->GetTimeSeconds();
+	}
+
+	Island->Members.Add(Physicable);
+
+	if (Island->Members.Num() >= Island->IslandSize)
+	{
+		const FPendingIsland CompleteIsland = MoveTemp(*Island);
+		PendingIslands.RemoveAtSwap(Island - PendingIslands.GetData());
+		ApplyIsland(CompleteIsland);
+	}
+}
+
+void UPhysicableIslandSubsystem::Tick(float DeltaTime)
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		ClientTick();
+	}
+	else
+	{
+		ServerTick();
+	}
+}
+
+bool UPhysicableIslandSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return !IsTemplate() && World && World->IsGameWorld() && World->GetNetMode() != NM_Standalone;
+}
+
+TStatId UPhysicableIslandSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicableIslandSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UPhysicableIslandSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+const TArray<TWeakObjectPtr<APhysicable>>* UPhysicableIslandSubsystem::GetIslandMembers(const APhysicable* Lead) const
+{
+	const FServerIsland* Island = ServerIslands.Find(Lead);
+	return Island ? &Island->Members : nullptr;
+}
+
+void UPhysicableIslandSubsystem::SendIsland(APhysicable* Lead)
+{
+	FServerIsland* Island = ServerIslands.Find(Lead);
+	if (Island == nullptr)
+	{
+		return;
+	}
+
+	TArray<APhysicable*, TInlineAllocator<16>> Members;
+	for (const TWeakObjectPtr<APhysicable>& Member : Island->Members)
+	{
+		if (APhysicable* Physicable = Member.Get())
+		{
+			Members.Add(Physicable);
+		}
+	}
+
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+	const float DeltaTime = Island->LastSendTime > 0.f ? CurrentTime - Island->LastSendTime : GetWorld()->GetDeltaSeconds();
+	Island->LastSendTime = CurrentTime;
+
+	NextIslandId = (NextIslandId == MAX_uint16) ? 1 : NextIslandId + 1;
+	const uint8 IslandSize = (uint8)FMath::Min(Members.Num(), (int32)MAX_uint8);
+
+	for (APhysicable* Member : Members)
+	{
+		Member->SendIslandState(NextIslandId, IslandSize, CurrentTime, Island->SharedNetPriority, DeltaTime);
+	}
+}
+
+void UPhysicableIslandSubsystem::ServerTick()
+{
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// Union-find over the live contacts.
+	TMap<APhysicable*, int32> BodyIndices;
+	TArray<APhysicable*> Bodies;
+	TArray<int32> Parents;
+
+	auto FindRoot = [&Parents](int32 Index)
+	{
+		while (Parents[Index] != Index)
+		{
+			Parents[Index] = Parents[Parents[Index]];
+			Index = Parents[Index];
+		}
+		return Index;
+	};
+
+	auto GetBodyIndex = [&](APhysicable* Body)
+	{
+		if (const int32* Index = BodyIndices.Find(Body))
+		{
+			return *Index;
+		}
+		const int32 Index = Bodies.Add(Body);
+		Parents.Add(Index);
+		BodyIndices.Add(Body, Index);
+		return Index;
+	};
+
+	for (auto It = Contacts.CreateIterator(); It; ++It)
+	{
+		APhysicable* A = It.Key().Key.Get();
+		APhysicable* B = It.Key().Value.Get();
+
+		if (A == nullptr || B == nullptr || CurrentTime - It.Value() > ContactLifetime)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const int32 RootA = FindRoot(GetBodyIndex(A));
+		const int32 RootB = FindRoot(GetBodyIndex(B));
+		if (RootA != RootB)
+		{
+			Parents[RootB] = RootA;
+		}
+	}
+
+	TMap<int32, TArray<APhysicable*>> Islands;
+	for (int32 Index = 0; Index < Bodies.Num(); Index++)
+	{
+		Islands.FindOrAdd(FindRoot(Index)).Add(Bodies[Index]);
+	}
+
+	TSet<TWeakObjectPtr<APhysicable>> NewIslandMembers;
+	TMap<TWeakObjectPtr<APhysicable>, FServerIsland> NewServerIslands;
+	UPhysicableSendScheduler* SendScheduler = GetWorld()->GetSubsystem<UPhysicableSendScheduler>();
+
+	for (TPair<int32, TArray<APhysicable*>>& Island : Islands)
+	{
+		const TArray<APhysicable*>& Members = Island.Value;
+
+		bool bAnyMoving = false;
+		float SharedNetPriority = 0.f;
+		APhysicable* Lead = Members[0];
+		for (APhysicable* Member : Members)
+		{
+			bAnyMoving |= Member->IsMoving();
+			SharedNetPriority = FMath::Max(SharedNetPriority, Member->GetBaseNetPriority());
+			Lead = FMath::Min(Lead, Member);
+		}
+
+		// A resting pile has nothing new to send.
+		if (!bAnyMoving)
+		{
+			continue;
+		}
+
+		FServerIsland& ServerIsland = NewServerIslands.Add(Lead);
+		ServerIsland.SharedNetPriority = SharedNetPriority;
+		if (const FServerIsland* LastIsland = ServerIslands.Find(Lead))
+		{
+			ServerIsland.LastSendTime = LastIsland->LastSendTime;
+		}
+
+		for (APhysicable* Member : Members)
+		{
+			Member->JoinIsland(SharedNetPriority);
+			ServerIsland.Members.Add(Member);
+			NewIslandMembers.Add(Member);
+		}
+	}
+
+	ServerIslands = MoveTemp(NewServerIslands);
+
+	// Sent as one unit once its phase is due and the budget allows, see SendIsland().
+	for (const TPair<TWeakObjectPtr<APhysicable>, FServerIsland>& Island : ServerIslands)
+	{
+		if (SendScheduler)
+		{
+			SendScheduler->RequestIslandSend(Island.Key.Get());
+		}
+	}
+
+	for (const TWeakObjectPtr<APhysicable>& FormerMember : IslandMembers)
+	{
+		if (FormerMember.IsValid() && !NewIslandMembers.Contains(FormerMember))
+		{
+			FormerMember->LeaveIsland();
+		}
+	}
+
+	IslandMembers = MoveTemp(NewIslandMembers);
+}
+
+void UPhysicableIslandSubsystem::ClientTick()
+{
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+
+	for (int32 Index = PendingIslands.Num() - 1; Index >= 0; Index--)
+	{
+		if (CurrentTime - PendingIslands[Index].FirstReceivedTime >= IslandApplyTimeout)
+		{
+			const FPendingIsland Island = MoveTemp(PendingIslands[Index]);
+			PendingIslands.RemoveAtSwap(Index);
+			ApplyIsland(Island);
+		}
+	}
+}
+
+void UPhysicableIslandSubsystem::ApplyIsland(const FPendingIsland& Island)
+{
+	for (const TWeakObjectPtr<APhysicable>& Member : Island.Members)
+	{
+		if (APhysicable* Physicable = Member.Get())
+		{
+			Physicable->SimulatedProxy_PhysicsState();
+		}
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PhysicableIslandSubsystem.generated.h"
+
+class APhysicable;
+
+/**
+ * Replicates touching physicables as one unit.
+ *
+ * Server: contacts reported from the physics scene hit events are merged into islands with a union-find every frame. An island that
+ * has a moving body is queued with UPhysicableSendScheduler as one unit, on the phase of its lead member and against the bytes of
+ * all its members, and its members are then sent in the same frame, with one shared time stamp, island id and net priority.
+ *
+ * Client: island member states are buffered until every member of the island arrived (or IslandApplyTimeout passed), then applied
+ * together, so stacks and piles never show bodies from different server frames.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicableIslandSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Server. Record that A and B touched this frame. */
+	void					ReportContact(APhysicable* A, APhysicable* B);
+
+	/** Server. Members of the island Lead leads, or null if it does not lead one since the last pass. */
+	const TArray<TWeakObjectPtr<APhysicable>>*	GetIslandMembers(const APhysicable* Lead) const;
+
+	/** Server. Send the states of every member of the island Lead leads, when UPhysicableSendScheduler says so. */
+	void					SendIsland(APhysicable* Lead);
+
+	/** Client. Hold the state Physicable just received until the rest of its island is there. */
+	void					BufferIslandState(APhysicable* Physicable);
+
+	virtual void			Tick(float DeltaTime) override;
+
+	virtual bool			IsTickable() const override;
+
+	virtual TStatId			GetStatId() const override;
+
+	/** Tick with the world, before its net driver flushes. */
+	virtual UWorld*			GetTickableGameObjectWorld() const override;
+
+	/** Contacts not reported again within this time are dropped. Hit events stop once bodies fall asleep. */
+	float					ContactLifetime { 0.2f };
+
+	/** Apply an incomplete island after this long, so a lost member does not hold the others back. */
+	float					IslandApplyTimeout { 0.1f };
+
+private:
+
+	struct FPendingIsland
+	{
+		uint16								IslandId { 0 };
+		float								ServerTimeStamp { 0 };
+		uint8								IslandSize { 0 };
+		float								FirstReceivedTime { 0 };
+		TArray<TWeakObjectPtr<APhysicable>>	Members;
+	};
+
+	struct FServerIsland
+	{
+		TArray<TWeakObjectPtr<APhysicable>>	Members;
+		float								SharedNetPriority { 0 };
+
+		/** Server time the island was last sent, carried over as long as it keeps its lead. */
+		float								LastSendTime { 0 };
+	};
+
+	void					ServerTick();
+
+	void					ClientTick();
+
+	void					ApplyIsland(const FPendingIsland& Island);
+
+	/** Contact pairs, ordered by pointer, with the time they were last reported. */
+	TMap<TPair<TWeakObjectPtr<APhysicable>, TWeakObjectPtr<APhysicable>>, float>	Contacts;
+
+	/** Physicables that were island members after the last pass. */
+	TSet<TWeakObjectPtr<APhysicable>>	IslandMembers;
+
+	/** Islands with a moving member after the last pass, by lead: the member with the lowest address, stable while the island lasts. */
+	TMap<TWeakObjectPtr<APhysicable>, FServerIsland>	ServerIslands;
+
+	uint16					NextIslandId { 0 };
+
+	TArray<FPendingIsland>	PendingIslands;
+};
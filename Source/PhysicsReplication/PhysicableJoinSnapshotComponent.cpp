@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableJoinSnapshotComponent.h"
+#include "PhysicableJoinSnapshotSubsystem.h"
+
+#include "GameFramework/PlayerController.h"
+
+UPhysicableJoinSnapshotComponent::UPhysicableJoinSnapshotComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UPhysicableJoinSnapshotComponent::SendSnapshot()
+{
+	// Remote players only: a listen server host already has every state.
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	if (PlayerController == nullptr || !PlayerController->HasAuthority() || PlayerController->IsLocalController())
+	{
+		return;
+	}
+
+	UPhysicableJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UPhysicableJoinSnapshotSubsystem>();
+	int32 UncompressedSize = 0;
+	int32 NumBits = 0;
+	if (JoinSnapshot && JoinSnapshot->BuildSnapshot(Snapshot, UncompressedSize, NumBits))
+	{
+		ClientBeginSnapshot(Snapshot.Num(), UncompressedSize, NumBits);
+		SentBytes = 0;
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UPhysicableJoinSnapshotComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	for (int32 Chunk = 0; Chunk < ChunksPerTick && SentBytes < Snapshot.Num(); Chunk++)
+	{
+		const int32 ChunkBytes = FMath::Min(MaxChunkBytes, Snapshot.Num() - SentBytes);
+		ClientReceiveSnapshotChunk(TArray<uint8>(Snapshot.GetData() + SentBytes, ChunkBytes));
+		SentBytes += ChunkBytes;
+	}
+
+	if (SentBytes >= Snapshot.Num())
+	{
+		Snapshot.Empty();
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UPhysicableJoinSnapshotComponent::ClientBeginSnapshot_Implementation(int32 CompressedSize, int32 UncompressedSize, int32 NumBits)
+{
+	Snapshot.Reset(CompressedSize);
+	ExpectedBytes = CompressedSize;
+	UncompressedBytes = UncompressedSize;
+	SnapshotBits = NumBits;
+}
+
+void UPhysicableJoinSnapshotComponent::ClientReceiveSnapshotChunk_Implementation(const TArray<uint8>& Chunk)
+{
+	// Reliable and in order, so chunks only need to be appended.
+	Snapshot.Append(Chunk);
+	if (Snapshot.Num() < ExpectedBytes)
+	{
+		return;
+	}
+
+	if (UPhysicableJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UPhysicableJoinSnapshotSubsystem>())
+	{
+		JoinSnapshot->ApplySnapshot(Snapshot, UncompressedBytes, SnapshotBits);
+	}
+
+	Snapshot.Empty();
+	ExpectedBytes = 0;
+}
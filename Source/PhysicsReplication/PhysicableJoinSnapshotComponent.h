@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PhysicableJoinSnapshotComponent.generated.h"
+
+/**
+ * Streams the UPhysicableJoinSnapshotSubsystem snapshot to the owning client after it logged in (see APhysicsReplicationGameMode::PostLogin).
+ * The compressed blob goes in chunks of at most MaxChunkBytes, ChunksPerTick per frame, so a big level does not flood the
+ * connection in the frame the player joins.
+ */
+UCLASS(ClassGroup=(Physics), meta=(BlueprintSpawnableComponent))
+class PHYSICSREPLICATION_API UPhysicableJoinSnapshotComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicableJoinSnapshotComponent();
+
+	virtual void		TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Server only. Build the snapshot and start streaming it. */
+	void				SendSnapshot();
+
+protected:
+
+	UPROPERTY(EditDefaultsOnly, Category="Join Snapshot", meta=(ClampMin="64", ClampMax="16384"))
+	int32				MaxChunkBytes { 1024 };
+
+	UPROPERTY(EditDefaultsOnly, Category="Join Snapshot", meta=(ClampMin="1"))
+	int32				ChunksPerTick { 2 };
+
+private:
+
+	UFUNCTION(Client, Reliable)
+	void				ClientBeginSnapshot(int32 CompressedSize, int32 UncompressedSize, int32 NumBits);
+
+	UFUNCTION(Client, Reliable)
+	void				ClientReceiveSnapshotChunk(const TArray<uint8>& Chunk);
+
+	/** Server: the blob left to send. Client: the blob received so far. */
+	TArray<uint8>		Snapshot;
+
+	/** Server: bytes of Snapshot already sent. */
+	int32				SentBytes { 0 };
+
+	/** Client. Sizes announced by ClientBeginSnapshot(). */
+	int32				ExpectedBytes { 0 };
+	int32				UncompressedBytes { 0 };
+	int32				SnapshotBits { 0 };
+};
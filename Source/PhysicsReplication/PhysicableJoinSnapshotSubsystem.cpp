@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableJoinSnapshotSubsystem.h"
+#include "Physicable.h"
+#include "PhysicsNetBitProfiler.h"
+
+#include "Misc/Compression.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicableJoinSnapshot, Log, All);
+
+void UPhysicableJoinSnapshotSubsystem::Register(APhysicable* Physicable)
+{
+	Physicables.AddUnique(Physicable);
+	bSorted = false;
+}
+
+void UPhysicableJoinSnapshotSubsystem::Unregister(APhysicable* Physicable)
+{
+	Physicables.Remove(Physicable);
+}
+
+bool UPhysicableJoinSnapshotSubsystem::BuildSnapshot(TArray<uint8>& OutData, int32& OutUncompressedSize, int32& OutNumBits)
+{
+	SortPhysicables();
+
+	// Sent compressed, the states' own bit costs are not what goes on the wire.
+	PHYSICS_NET_BIT_SUPPRESS();
+
+	FNetBitWriter Writer(nullptr, 0);
+	Writer.SetAllowResize(true);
+
+	uint32 NamesChecksum = GetNamesChecksum();
+	Writer << NamesChecksum;
+
+	// Indices are sent as the difference to the previous one.
+	int32 PreviousIndex = -1;
+	int32 NumStates = 0;
+	for (int32 Index = 0; Index < Physicables.Num(); Index++)
+	{
+		APhysicable* Physicable = Physicables[Index].Get();
+
+		// Still where the level put it, or moving and replicated through its channel.
+		if (Physicable == nullptr || Physicable->PhysicsState.ServerTimeStamp <= 0.f || Physicable->NetDormancy <= DORM_Awake)
+		{
+			continue;
+		}
+
+		uint32 IndexDelta = Index - PreviousIndex;
+		Writer.SerializeIntPacked(IndexDelta);
+		PreviousIndex = Index;
+
+		bool bSuccess = true;
+		Physicable->PhysicsState.NetSerialize(Writer, nullptr, bSuccess);
+		NumStates++;
+	}
+
+	if (NumStates == 0)
+	{
+		return false;
+	}
+
+	OutNumBits = (int32)Writer.GetNumBits();
+	OutUncompressedSize = Writer.GetNumBytes();
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, OutUncompressedSize);
+	OutData.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, OutData.GetData(), CompressedSize, Writer.GetData(), OutUncompressedSize))
+	{
+		UE_LOG(LogPhysicableJoinSnapshot, Warning, TEXT("Could not compress the join snapshot"));
+		return false;
+	}
+	OutData.SetNum(CompressedSize);
+
+	UE_LOG(LogPhysicableJoinSnapshot, Verbose, TEXT("Join snapshot of %d states: %d bytes, %d compressed"), NumStates, OutUncompressedSize, CompressedSize);
+	return true;
+}
+
+void UPhysicableJoinSnapshotSubsystem::ApplySnapshot(const TArray<uint8>& Data, int32 UncompressedSize, int32 NumBits)
+{
+	if (UncompressedSize <= 0 || NumBits > UncompressedSize * 8)
+	{
+		return;
+	}
+
+	TArray<uint8> Uncompressed;
+	Uncompressed.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(NAME_Zlib, Uncompressed.GetData(), UncompressedSize, Data.GetData(), Data.Num()))
+	{
+		UE_LOG(LogPhysicableJoinSnapshot, Warning, TEXT("Could not uncompress the join snapshot"));
+		return;
+	}
+
+	SortPhysicables();
+
+	PHYSICS_NET_BIT_SUPPRESS();
+
+	FNetBitReader Reader(nullptr, Uncompressed.GetData(), NumBits);
+
+	uint32 NamesChecksum = 0;
+	Reader << NamesChecksum;
+	if (NamesChecksum != GetNamesChecksum())
+	{
+		UE_LOG(LogPhysicableJoinSnapshot, Warning, TEXT("Join snapshot ignored, the level placed physicables differ from the server's"));
+		return;
+	}
+
+	int32 Index = -1;
+	while (Reader.GetBitsLeft() > 0 && !Reader.IsError())
+	{
+		uint32 IndexDelta = 0;
+		Reader.SerializeIntPacked(IndexDelta);
+		Index += (int32)IndexDelta;
+
+		FPhysicsStateActor State;
+		bool bSuccess = true;
+		State.NetSerialize(Reader, nullptr, bSuccess);
+
+		if (Reader.IsError() || !Physicables.IsValidIndex(Index))
+		{
+			break;
+		}
+
+		if (APhysicable* Physicable = Physicables[Index].Get())
+		{
+			Physicable->ApplySnapshotState(State);
+		}
+	}
+}
+
+void UPhysicableJoinSnapshotSubsystem::SortPhysicables()
+{
+	if (bSorted)
+	{
+		return;
+	}
+
+	Physicables.RemoveAll([](const TWeakObjectPtr<APhysicable>& Physicable) { return !Physicable.IsValid(); });
+	Physicables.Sort([](const TWeakObjectPtr<APhysicable>& A, const TWeakObjectPtr<APhysicable>& B)
+		{
+			// Same order on every machine, also for physicables of the same name in different levels.
+			return A->GetPathName() < B->GetPathName();
+		});
+
+	bSorted = true;
+}
+
+uint32 UPhysicableJoinSnapshotSubsystem::GetNamesChecksum() const
+{
+	uint32 Checksum = 0;
+	for (const TWeakObjectPtr<APhysicable>& Physicable : Physicables)
+	{
+		Checksum = FCrc::StrCrc32(*Physicable->GetName(), Checksum);
+	}
+	return Checksum;
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicableJoinSnapshotSubsystem.generated.h"
+
+class APhysicable;
+
+/**
+ * States of the level placed physicables at rest, packed into one compressed blob for clients that join late.
+ *
+ * Level placed physicables exist on every client from the map, so they are identified by their index in the list of registered
+ * physicables sorted by name instead of by a net GUID. Those at rest sit in DORM_Initial and never open a channel on join; the
+ * snapshot moves them straight to where they came to rest. Physicables that move, or were spawned, replicate as usual.
+ *
+ * UPhysicableJoinSnapshotComponent streams the blob to each joining client in chunks.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicableJoinSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Level placed physicables register on both sides at BeginPlay. */
+	void				Register(APhysicable* Physicable);
+
+	void				Unregister(APhysicable* Physicable);
+
+	/** Server only. Compressed states of the resting physicables that moved since the level loaded. False if there are none. */
+	bool				BuildSnapshot(TArray<uint8>& OutData, int32& OutUncompressedSize, int32& OutNumBits);
+
+	/** Client. Apply a snapshot built by BuildSnapshot(). */
+	void				ApplySnapshot(const TArray<uint8>& Data, int32 UncompressedSize, int32 NumBits);
+
+private:
+
+	/** Sort by name so both sides agree on the indices. */
+	void				SortPhysicables();
+
+	/** Checksum of the sorted names, a client with different level content rejects the snapshot. */
+	uint32				GetNamesChecksum() const;
+
+	TArray<TWeakObjectPtr<APhysicable>>	Physicables;
+
+	bool				bSorted { true };
+};
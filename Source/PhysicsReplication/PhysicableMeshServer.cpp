@@ -2,6 +2,7 @@
 
 
 #include "PhysicableMeshServer.h"
+#include "PhysicsActivationSubsystem.h"
 
 APhysicableMeshServer::APhysicableMeshServer()
 {
@@ -30,9 +31,27 @@ void APhysicableMeshServer::BeginPlay()
 	{
 		Mesh->SetSimulatePhysics(true);
 		Mesh->SetEnableGravity(true);
+
+		if (UPhysicsActivationSubsystem* Activation = GetWorld()->GetSubsystem<UPhysicsActivationSubsystem>())
+		{
+			Activation->Register(Mesh);
+		}
 	}
 }
 
+void APhysicableMeshServer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (HasAuthority())
+	{
+		if (UPhysicsActivationSubsystem* Activation = GetWorld()->GetSubsystem<UPhysicsActivationSubsystem>())
+		{
+			Activation->Unregister(Mesh);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void APhysicableMeshServer::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
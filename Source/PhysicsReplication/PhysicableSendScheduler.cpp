@@ -0,0 +1,326 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableSendScheduler.h"
+#include "Physicable.h"
+#include "PhysicableIslandSubsystem.h"
+#include "PhysicsNetBitProfiler.h"
+#include "PhysicsReplicationGraph.h"
+
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicableSendScheduler, Log, All);
+
+UPhysicableSendScheduler::UPhysicableSendScheduler()
+{
+	SendPeriodFrames = 2;
+	MaxBytesPerConnectionPerFrame = 1000;
+	StateOverheadBytes = 4;
+	RelevantRadius = 0.f;
+}
+
+void UPhysicableSendScheduler::Deinitialize()
+{
+	Scheduled.Empty();
+	Pending.Empty();
+	Connections.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPhysicableSendScheduler::Register(APhysicable* Physicable)
+{
+	if (Physicable == nullptr || Scheduled.Contains(Physicable))
+	{
+		return;
+	}
+
+	FScheduledPhysicable& Entry = Scheduled.Add(Physicable);
+	Entry.Phase = NextPhase;
+	NextPhase = (NextPhase + 1) % FMath::Max(SendPeriodFrames, 1);
+}
+
+void UPhysicableSendScheduler::Unregister(APhysicable* Physicable)
+{
+	if (Scheduled.Remove(Physicable) > 0)
+	{
+		Pending.RemoveAll([Physicable](const FPendingSend& Send) { return Send.Physicable == Physicable; });
+	}
+}
+
+void UPhysicableSendScheduler::RequestSend(APhysicable* Physicable)
+{
+	AddRequest(Physicable, false);
+}
+
+void UPhysicableSendScheduler::RequestIslandSend(APhysicable* Lead)
+{
+	AddRequest(Lead, true);
+}
+
+void UPhysicableSendScheduler::AddRequest(APhysicable* Physicable, bool bIsland)
+{
+	FScheduledPhysicable* Entry = Scheduled.Find(Physicable);
+	if (Entry == nullptr)
+	{
+		return;
+	}
+
+	if (Entry->bPending)
+	{
+		// A state of its own still waiting goes out with its island instead, keeping its place in the queue.
+		if (bIsland)
+		{
+			if (FPendingSend* Send = Pending.FindByPredicate([Physicable](const FPendingSend& Request) { return Request.Physicable == Physicable; }))
+			{
+				Send->bIsland = true;
+			}
+		}
+		return;
+	}
+
+	Entry->bPending = true;
+
+	FPendingSend& Send = Pending.AddDefaulted_GetRef();
+	Send.Physicable = Physicable;
+	Send.RequestFrame = GFrameCounter;
+	Send.bIsland = bIsland;
+}
+
+void UPhysicableSendScheduler::Tick(float DeltaTime)
+{
+	GatherConnections();
+
+	const uint64 Frame = GFrameCounter;
+	const uint64 Period = (uint64)FMath::Max(SendPeriodFrames, 1);
+	const float RelevantRadiusSquared = FMath::Square(GetRelevantRadius());
+
+	UPhysicableIslandSubsystem* IslandSubsystem = GetWorld()->GetSubsystem<UPhysicableIslandSubsystem>();
+
+	TArray<int32, TInlineAllocator<8>> RelevantConnections;
+	TArray<APhysicable*, TInlineAllocator<16>> SendMembers;
+	TArray<FPendingSend> Carried;
+	for (const FPendingSend& Send : Pending)
+	{
+		APhysicable* Physicable = Send.Physicable.Get();
+		FScheduledPhysicable* Entry = Physicable ? Scheduled.Find(Physicable) : nullptr;
+		if (Entry == nullptr)
+		{
+			continue;
+		}
+
+		// Requests that already waited a full period were held back by the budget, they go before their phase comes again.
+		const bool bDue = Frame % Period == (uint64)Entry->Phase || Frame - Send.RequestFrame >= Period;
+		if (!bDue)
+		{
+			Carried.Add(Send);
+			continue;
+		}
+
+		// The physicable alone, or every member of its island.
+		SendMembers.Reset();
+		if (Send.bIsland)
+		{
+			const TArray<TWeakObjectPtr<APhysicable>>* IslandMembers = IslandSubsystem ? IslandSubsystem->GetIslandMembers(Physicable) : nullptr;
+			if (IslandMembers == nullptr)
+			{
+				// Came to rest, split up or is led by another member now, which asks for its own send.
+				Entry->bPending = false;
+				continue;
+			}
+
+			for (const TWeakObjectPtr<APhysicable>& Member : *IslandMembers)
+			{
+				if (APhysicable* MemberPhysicable = Member.Get())
+				{
+					SendMembers.Add(MemberPhysicable);
+				}
+			}
+		}
+		else
+		{
+			SendMembers.Add(Physicable);
+		}
+
+		// The previous states' sizes, measured when they were sent, stand in for these.
+		int32 StateBytes = 0;
+		for (APhysicable* Member : SendMembers)
+		{
+			StateBytes += GetStateBytes(Member);
+		}
+
+		// The actor only follows the simulated mesh on its tick.
+		const FVector Location = Physicable->GetMesh()->GetComponentLocation();
+
+		// A connection that has not been sent anything this frame takes a state of any size, so nothing waits forever.
+		bool bFits = true;
+		RelevantConnections.Reset();
+		for (int32 Index = 0; Index < Connections.Num(); Index++)
+		{
+			const FConnectionBudget& Budget = Connections[Index];
+			if (FVector::DistSquared(Location, Budget.ViewLocation) > RelevantRadiusSquared)
+			{
+				continue;
+			}
+
+			RelevantConnections.Add(Index);
+			if (Budget.BytesLeft < StateBytes && Budget.BytesLeft < MaxBytesPerConnectionPerFrame)
+			{
+				bFits = false;
+			}
+		}
+
+		if (!bFits)
+		{
+			Carried.Add(Send);
+			NumCarried++;
+			continue;
+		}
+
+		for (int32 Index : RelevantConnections)
+		{
+			Connections[Index].BytesLeft -= StateBytes;
+		}
+
+		Entry->bPending = false;
+		if (Send.bIsland)
+		{
+			IslandSubsystem->SendIsland(Physicable);
+		}
+		else
+		{
+			Physicable->SendScheduledState();
+		}
+
+		for (APhysicable* Member : SendMembers)
+		{
+			if (FScheduledPhysicable* MemberEntry = Scheduled.Find(Member))
+			{
+				MemberEntry->StateBytes = MeasureStateBytes(Member);
+			}
+		}
+		NumSent++;
+	}
+
+	Pending = MoveTemp(Carried);
+
+	for (const FConnectionBudget& Budget : Connections)
+	{
+		PeakConnectionBytes = FMath::Max(PeakConnectionBytes, MaxBytesPerConnectionPerFrame - Budget.BytesLeft);
+	}
+}
+
+bool UPhysicableSendScheduler::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return !IsTemplate() && World && World->IsGameWorld() && World->GetNetMode() != NM_Client && Pending.Num() > 0;
+}
+
+TStatId UPhysicableSendScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicableSendScheduler, STATGROUP_Tickables);
+}
+
+UWorld* UPhysicableSendScheduler::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UPhysicableSendScheduler::GatherConnections()
+{
+	Connections.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		UNetConnection* Connection = PlayerController ? PlayerController->GetNetConnection() : nullptr;
+
+		// The listen server's own player is not sent anything.
+		if (Connection == nullptr || PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FConnectionBudget& Budget = Connections.AddDefaulted_GetRef();
+		Budget.Connection = Connection;
+		Budget.BytesLeft = MaxBytesPerConnectionPerFrame;
+
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(Budget.ViewLocation, ViewRotation);
+	}
+}
+
+int32 UPhysicableSendScheduler::GetStateBytes(APhysicable* Physicable)
+{
+	FScheduledPhysicable* Entry = Scheduled.Find(Physicable);
+	if (Entry == nullptr)
+	{
+		return MeasureStateBytes(Physicable);
+	}
+
+	if (Entry->StateBytes == 0)
+	{
+		Entry->StateBytes = MeasureStateBytes(Physicable);
+	}
+	return Entry->StateBytes;
+}
+
+int32 UPhysicableSendScheduler::MeasureStateBytes(const APhysicable* Physicable) const
+{
+	// Measured only, not sent.
+	PHYSICS_NET_BIT_SUPPRESS();
+
+	FNetBitWriter Writer(nullptr, 0);
+	Writer.SetAllowResize(true);
+
+	FPhysicsStateActor State = Physicable->PhysicsState;
+	bool bSuccess = true;
+	State.NetSerialize(Writer, nullptr, bSuccess);
+
+	return Writer.GetNumBytes() + StateOverheadBytes;
+}
+
+float UPhysicableSendScheduler::GetRelevantRadius() const
+{
+	return RelevantRadius > 0.f ? RelevantRadius : GetDefault<UPhysicsReplicationGraph>()->PhysicableCullDistance;
+}
+
+static FAutoConsoleCommand CmdPhysicableSendSchedulerDump(
+	TEXT("PhysicableSendScheduler.Dump"),
+	TEXT("Log the scheduled physicable sends, carried over requests and the peak bytes per connection, per world."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			const UWorld* World = Context.World();
+			const UPhysicableSendScheduler* Scheduler = World ? World->GetSubsystem<UPhysicableSendScheduler>() : nullptr;
+			if (Scheduler == nullptr || World->GetNetMode() == NM_Client)
+			{
+				continue;
+			}
+
+			UE_LOG(LogPhysicableSendScheduler, Display, TEXT("%s: %d physicables over %d frames, %d pending, %lld sent, %lld carried over, peak %d/%d bytes per connection"),
+				*World->GetName(), Scheduler->GetNumPhysicables(), FMath::Max(Scheduler->SendPeriodFrames, 1), Scheduler->GetNumPending(),
+				Scheduler->NumSent, Scheduler->NumCarried, Scheduler->PeakConnectionBytes, Scheduler->MaxBytesPerConnectionPerFrame);
+		}
+	}));
+
+static FAutoConsoleCommand CmdPhysicableSendSchedulerReset(
+	TEXT("PhysicableSendScheduler.Reset"),
+	TEXT("Reset the counters of PhysicableSendScheduler.Dump."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			UWorld* World = Context.World();
+			if (UPhysicableSendScheduler* Scheduler = World ? World->GetSubsystem<UPhysicableSendScheduler>() : nullptr)
+			{
+				Scheduler->NumSent = 0;
+				Scheduler->NumCarried = 0;
+				Scheduler->PeakConnectionBytes = 0;
+			}
+		}
+	}));
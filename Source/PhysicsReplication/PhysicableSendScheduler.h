@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PhysicableSendScheduler.generated.h"
+
+class APhysicable;
+class UNetConnection;
+
+/**
+ * Server. Spreads the states of moving physicables evenly over the net frames, instead of sending them all on the frames they
+ * happen to become due, e.g. when one explosion wakes up hundreds of them at once.
+ *
+ * Every registered physicable gets a phase, round robin, and is only sent on the frames matching its phase, every SendPeriodFrames.
+ * A physicable that moved asks for a send with RequestSend(), a contact island with RequestIslandSend() as one unit on the phase
+ * of its lead member. The scheduler sends due requests at the end of the frame until the estimated bytes of any connection that
+ * sees them reach MaxBytesPerConnectionPerFrame. The rest is carried to the next frame, ahead of the newer requests.
+ */
+UCLASS(config=Game)
+class PHYSICSREPLICATION_API UPhysicableSendScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicableSendScheduler();
+
+	virtual void			Deinitialize() override;
+
+	/** Give Physicable the next phase. Its states are sent by the scheduler from now on. */
+	void					Register(APhysicable* Physicable);
+
+	void					Unregister(APhysicable* Physicable);
+
+	/** Physicable has a new state to send. Sent by APhysicable::SendScheduledState() once its phase is due and the budget allows. */
+	void					RequestSend(APhysicable* Physicable);
+
+	/**
+	 * The island led by Lead has new states, see UPhysicableIslandSubsystem. Due on the phase of Lead and paid for with the bytes of
+	 * every member at once, then sent by UPhysicableIslandSubsystem::SendIsland().
+	 */
+	void					RequestIslandSend(APhysicable* Lead);
+
+	virtual void			Tick(float DeltaTime) override;
+
+	virtual bool			IsTickable() const override;
+
+	virtual TStatId			GetStatId() const override;
+
+	/** Tick with the world: states sent after it flushes the net driver would wait a whole frame. */
+	virtual UWorld*			GetTickableGameObjectWorld() const override;
+
+	int32					GetNumPhysicables() const { return Scheduled.Num(); }
+
+	int32					GetNumPending() const { return Pending.Num(); }
+
+	/** Sends and carried over requests since the last reset. */
+	int64					NumSent { 0 };
+
+	int64					NumCarried { 0 };
+
+	/** Largest estimated bytes sent to one connection in a frame since the last reset. */
+	int32					PeakConnectionBytes { 0 };
+
+	/** Frames between two states of the same physicable. At one every physicable is due every frame and only the byte budget spreads them. */
+	UPROPERTY(Config)
+	int32					SendPeriodFrames;
+
+	/** Estimated bytes of physicable states sent to one connection per frame. */
+	UPROPERTY(Config)
+	int32					MaxBytesPerConnectionPerFrame;
+
+	/** Added to the size of each state for the property and bunch headers, in bytes. */
+	UPROPERTY(Config)
+	int32					StateOverheadBytes;
+
+	/** Connections further than this from a physicable do not pay for it, in cm. Zero or less uses the replication graph's cull distance. */
+	UPROPERTY(Config)
+	float					RelevantRadius;
+
+private:
+
+	struct FConnectionBudget
+	{
+		UNetConnection*		Connection { nullptr };
+		FVector				ViewLocation { FVector::ZeroVector };
+		int32				BytesLeft { 0 };
+	};
+
+	struct FScheduledPhysicable
+	{
+		int32				Phase { 0 };
+		bool				bPending { false };
+
+		/** Bytes of the last state sent, with StateOverheadBytes. Zero until measured. */
+		int32				StateBytes { 0 };
+	};
+
+	struct FPendingSend
+	{
+		TWeakObjectPtr<APhysicable>	Physicable;
+		uint64				RequestFrame { 0 };
+
+		/** Physicable leads an island, whose members are sent with it. */
+		bool				bIsland { false };
+	};
+
+	void					GatherConnections();
+
+	void					AddRequest(APhysicable* Physicable, bool bIsland);
+
+	/** Bytes of the last state Physicable sent, measured now if it has not sent one yet. */
+	int32					GetStateBytes(APhysicable* Physicable);
+
+	/** Serialized size of the current state of Physicable, with StateOverheadBytes. Once per send, the budget uses the last size. */
+	int32					MeasureStateBytes(const APhysicable* Physicable) const;
+
+	float					GetRelevantRadius() const;
+
+	TMap<TWeakObjectPtr<APhysicable>, FScheduledPhysicable>	Scheduled;
+
+	/** Oldest request first. */
+	TArray<FPendingSend>	Pending;
+
+	TArray<FConnectionBudget>	Connections;
+
+	int32					NextPhase { 0 };
+};
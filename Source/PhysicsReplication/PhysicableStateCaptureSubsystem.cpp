@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicableStateCaptureSubsystem.h"
+#include "Physicable.h"
+
+#include "Physics/PhysicsInterfaceCore.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicableStateCapture, Log, All);
+
+void UPhysicableStateCaptureSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Commands = MakeUnique<TCircularQueue<FCaptureCommand>>(CommandQueueSize);
+	Snapshots = MakeUnique<TCircularQueue<FPhysicableStateSnapshot>>(SnapshotQueueSize);
+}
+
+void UPhysicableStateCaptureSubsystem::Deinitialize()
+{
+	if (PostTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePreTick.Remove(PreTickHandle);
+			PhysScene->OnPhysScenePostTick.Remove(PostTickHandle);
+		}
+		PreTickHandle.Reset();
+		PostTickHandle.Reset();
+	}
+
+	CapturedBodies.Reset();
+	LatestSnapshots.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UPhysicableStateCaptureSubsystem::Register(APhysicable* Physicable, FBodyInstance* BodyInstance)
+{
+	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+	if (PhysScene == nullptr || BodyInstance == nullptr || !FPhysicsInterface::IsValid(BodyInstance->ActorHandle))
+	{
+		return false;
+	}
+
+	// The physics scene exists after the subsystem is initialized, so bind on first use.
+	if (!PostTickHandle.IsValid())
+	{
+		PreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UPhysicableStateCaptureSubsystem::OnPhysScenePreTick);
+		PostTickHandle = PhysScene->OnPhysScenePostTick.AddUObject(this, &UPhysicableStateCaptureSubsystem::OnPhysScenePostTick);
+	}
+
+	FCaptureCommand Command;
+	Command.Physicable = Physicable;
+	Command.BodyInstance = BodyInstance;
+	Command.bAdd = true;
+
+	if (!Commands->Enqueue(Command))
+	{
+		UE_LOG(LogPhysicableStateCapture, Warning, TEXT("Register: too many registrations in flight, %s keeps sampling in its tick"), *GetNameSafe(Physicable));
+		return false;
+	}
+
+	return true;
+}
+
+void UPhysicableStateCaptureSubsystem::Unregister(APhysicable* Physicable)
+{
+	FCaptureCommand Command;
+	Command.Physicable = Physicable;
+	Command.bAdd = false;
+
+	// A full queue means the capture side stopped running; the weak pointer keeps a stale entry harmless.
+	Commands->Enqueue(Command);
+
+	LatestSnapshots.Remove(Physicable);
+}
+
+void UPhysicableStateCaptureSubsystem::OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime)
+{
+	StepDeltaTime = DeltaTime;
+}
+
+void UPhysicableStateCaptureSubsystem::OnPhysScenePostTick(FPhysScene* PhysScene)
+{
+	FCaptureCommand Command;
+	while (Commands->Dequeue(Command))
+	{
+		const int32 Index = CapturedBodies.IndexOfByPredicate([&Command](const FCapturedBody& Body)
+		{
+			return Body.Physicable == Command.Physicable;
+		});
+
+		if (Command.bAdd && Index == INDEX_NONE)
+		{
+			CapturedBodies.Add({ Command.Physicable, Command.BodyInstance });
+		}
+		else if (!Command.bAdd && Index != INDEX_NONE)
+		{
+			CapturedBodies.RemoveAtSwap(Index);
+		}
+	}
+
+	// Simulated time rather than wall clock, so hitches and time dilation match what the bodies integrated.
+	const float DeltaTime = StepDeltaTime;
+	StepDeltaTime = 0;
+
+	for (const FCapturedBody& Body : CapturedBodies)
+	{
+		// Resolved on every capture: a body recreated since the last step has a new handle, and none while it is torn down.
+		const FPhysicsActorHandle& ActorHandle = Body.BodyInstance->ActorHandle;
+		if (!FPhysicsInterface::IsValid(ActorHandle))
+		{
+			continue;
+		}
+
+		FPhysicableStateSnapshot Snapshot;
+		Snapshot.Physicable = Body.Physicable;
+		Snapshot.DeltaTime = DeltaTime;
+
+		FPhysicsCommand::ExecuteRead(ActorHandle, [&Snapshot](const FPhysicsActorHandle& Actor)
+		{
+			Snapshot.Transform = FPhysicsInterface::GetGlobalPose_AssumesLocked(Actor);
+			Snapshot.LinearVelocity = FPhysicsInterface::GetLinearVelocity_AssumesLocked(Actor);
+		});
+
+		if (!Snapshots->Enqueue(Snapshot))
+		{
+			NumDroppedSnapshots++;
+		}
+	}
+}
+
+void UPhysicableStateCaptureSubsystem::Tick(float DeltaTime)
+{
+	FPhysicableStateSnapshot Snapshot;
+	while (Snapshots->Dequeue(Snapshot))
+	{
+		// Several steps in one frame: keep the newest state, covering the time of all of them.
+		FPhysicableStateSnapshot& Latest = LatestSnapshots.FindOrAdd(Snapshot.Physicable);
+		const float AccumulatedDeltaTime = Latest.Physicable.IsValid() ? Latest.DeltaTime : 0.f;
+		Latest = Snapshot;
+		Latest.DeltaTime += AccumulatedDeltaTime;
+	}
+
+	for (TPair<TWeakObjectPtr<APhysicable>, FPhysicableStateSnapshot>& Pair : LatestSnapshots)
+	{
+		if (APhysicable* Physicable = Pair.Key.Get())
+		{
+			Physicable->ApplyCapturedState(Pair.Value.Transform, Pair.Value.LinearVelocity, Pair.Value.DeltaTime);
+		}
+	}
+
+	LatestSnapshots.Reset();
+}
+
+bool UPhysicableStateCaptureSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return !IsTemplate() && World && World->IsGameWorld() && World->GetNetMode() != NM_Client && Snapshots.IsValid();
+}
+
+TStatId UPhysicableStateCaptureSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicableStateCaptureSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UPhysicableStateCaptureSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
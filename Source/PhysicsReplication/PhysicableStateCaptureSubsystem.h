@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "Physics/PhysicsInterfaceDeclares.h"
+#include "Physics/PhysicsInterfaceTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PhysicableStateCaptureSubsystem.generated.h"
+
+class APhysicable;
+
+/** Body state read right after a physics step. */
+struct FPhysicableStateSnapshot
+{
+	TWeakObjectPtr<APhysicable>	Physicable;
+	FTransform					Transform { FTransform::Identity };
+	FVector						LinearVelocity { FVector::ZeroVector };
+	float						DeltaTime { 0 };
+};
+
+/**
+ * Server. Captures physicable states at the end of each physics step and hands them to the game thread for replication.
+ *
+ * The capture runs from the physics scene post tick delegate, which can fire off the game thread, and only talks to the game
+ * thread through two single producer, single consumer lock free queues: registrations go in, snapshots come out. The game thread
+ * drains the snapshots once per frame, after the physics step and before the net driver sends, and passes the newest one of
+ * each physicable to APhysicable::ApplyCapturedState(). Replication then sends the post step state of the current frame instead
+ * of the pre step state a PrePhysics actor tick reads.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicableStateCaptureSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void			Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void			Deinitialize() override;
+
+	/** Capture Physicable's body after every step. Returns false if the world has no physics scene. */
+	bool					Register(APhysicable* Physicable, FBodyInstance* BodyInstance);
+
+	void					Unregister(APhysicable* Physicable);
+
+	virtual void			Tick(float DeltaTime) override;
+
+	virtual bool			IsTickable() const override;
+
+	virtual TStatId			GetStatId() const override;
+
+	/** Tick with the world, so the captured states go out in the net update of the same frame. */
+	virtual UWorld*			GetTickableGameObjectWorld() const override;
+
+	/** Snapshots that did not fit in the queue since the start. The game thread fell behind by a whole queue. */
+	int32					GetNumDroppedSnapshots() const { return NumDroppedSnapshots.Load(); }
+
+	/** Most registrations in flight and most snapshots waiting for the game thread. */
+	static constexpr uint32	CommandQueueSize = 256;
+	static constexpr uint32	SnapshotQueueSize = 4096;
+
+private:
+
+	struct FCaptureCommand
+	{
+		TWeakObjectPtr<APhysicable>	Physicable;
+		FBodyInstance*				BodyInstance { nullptr };
+		bool						bAdd { true };
+	};
+
+	/** Holds the body instance rather than its actor handle, which is replaced whenever the component recreates its physics state. */
+	struct FCapturedBody
+	{
+		TWeakObjectPtr<APhysicable>	Physicable;
+		FBodyInstance*				BodyInstance { nullptr };
+	};
+
+	/** Physics side. Runs before every step of the scene, with the time it simulates. */
+	void					OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime);
+
+	/** Physics side. Runs after every step of the scene. */
+	void					OnPhysScenePostTick(FPhysScene* PhysScene);
+
+	/** Game thread to capture. */
+	TUniquePtr<TCircularQueue<FCaptureCommand>>			Commands;
+
+	/** Capture to game thread. */
+	TUniquePtr<TCircularQueue<FPhysicableStateSnapshot>>	Snapshots;
+
+	/** Owned by the capture side. */
+	TArray<FCapturedBody>	CapturedBodies;
+
+	/** Capture side. Time simulated by the current step, for the snapshot delta time. */
+	float					StepDeltaTime { 0 };
+
+	/** Game thread. Newest snapshot per physicable, reused every frame. */
+	TMap<TWeakObjectPtr<APhysicable>, FPhysicableStateSnapshot>	LatestSnapshots;
+
+	TAtomic<int32>			NumDroppedSnapshots { 0 };
+
+	FDelegateHandle			PreTickHandle;
+
+	FDelegateHandle			PostTickHandle;
+};
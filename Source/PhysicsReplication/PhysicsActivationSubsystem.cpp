@@ -0,0 +1,334 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsActivationSubsystem.h"
+#include "Physicable.h"
+#include "PhysicsReplicationGraph.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Physics/PhysicsInterfaceCore.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsActivation, Log, All);
+
+UPhysicsActivationSubsystem::UPhysicsActivationSubsystem()
+{
+	RelevantRadius = 0.f;
+	LODHysteresis = 1000.f;
+	ActivationRadius = 20000.f;
+	DeactivationRadius = 24000.f;
+	UpdateInterval = 0.25f;
+	DeactivationMode = EPhysicsDeactivationMode::Sleep;
+	ReducedSolverIterations = 1;
+	ReducedTickInterval = 0.1f;
+}
+
+void UPhysicsActivationSubsystem::Deinitialize()
+{
+	Bodies.Empty();
+	BodyIndices.Empty();
+	Cells.Empty();
+	FMemory::Memzero(NumBodiesAtLOD);
+
+	Super::Deinitialize();
+}
+
+void UPhysicsActivationSubsystem::Register(UPrimitiveComponent* Component)
+{
+	if (Component == nullptr || BodyIndices.Contains(Component))
+	{
+		return;
+	}
+
+	FActivationBody Body;
+	Body.Component = Component;
+	Body.Cell = GetCell(Component->GetComponentLocation());
+	Body.bFullUseCCD = Component->BodyInstance.bUseCCD;
+	if (const AActor* Owner = Component->GetOwner())
+	{
+		Body.FullTickInterval = Owner->GetActorTickInterval();
+	}
+
+	const int32 BodyIndex = Bodies.Add(Body);
+	BodyIndices.Add(Component, BodyIndex);
+	Cells.FindOrAdd(Body.Cell).Add(BodyIndex);
+	NumBodiesAtLOD[(int32)EPhysicsBodyLOD::Full]++;
+}
+
+void UPhysicsActivationSubsystem::Unregister(UPrimitiveComponent* Component)
+{
+	int32 BodyIndex = INDEX_NONE;
+	if (!BodyIndices.RemoveAndCopyValue(Component, BodyIndex))
+	{
+		return;
+	}
+
+	// Only called as the body goes away, its simulation is left as it is.
+	NumBodiesAtLOD[(int32)Bodies[BodyIndex].LOD]--;
+
+	RemoveFromCell(BodyIndex);
+	Bodies.RemoveAt(BodyIndex);
+}
+
+void UPhysicsActivationSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < UpdateInterval)
+	{
+		return;
+	}
+	TimeSinceUpdate = 0;
+
+	UpdateActivation();
+}
+
+bool UPhysicsActivationSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return !IsTemplate() && World && World->IsGameWorld() && World->GetNetMode() != NM_Client && Bodies.Num() > 0;
+}
+
+TStatId UPhysicsActivationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPhysicsActivationSubsystem, STATGROUP_Tickables);
+}
+
+void UPhysicsActivationSubsystem::UpdateActivation()
+{
+	// Keep the cells current, also for frozen bodies a contact woke up. Gone ones are dropped here too.
+	TArray<int32, TInlineAllocator<16>> StaleBodies;
+	for (auto It = Bodies.CreateIterator(); It; ++It)
+	{
+		FActivationBody& Body = *It;
+		Body.NearestPlayerDistanceSquared = BIG_NUMBER;
+
+		const UPrimitiveComponent* Component = Body.Component.Get();
+		if (Component == nullptr)
+		{
+			StaleBodies.Add(It.GetIndex());
+			continue;
+		}
+
+		const FIntPoint Cell = GetCell(Component->GetComponentLocation());
+		if (Cell != Body.Cell)
+		{
+			RemoveFromCell(It.GetIndex());
+			Body.Cell = Cell;
+			Cells.FindOrAdd(Cell).Add(It.GetIndex());
+		}
+	}
+
+	for (int32 BodyIndex : StaleBodies)
+	{
+		RemoveFromCell(BodyIndex);
+		BodyIndices.Remove(Bodies[BodyIndex].Component);
+		NumBodiesAtLOD[(int32)Bodies[BodyIndex].LOD]--;
+		Bodies.RemoveAt(BodyIndex);
+	}
+
+	// Cells are as big as the deactivation radius, so the 3x3 cells around a player hold every body it keeps active.
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		const FIntPoint PlayerCell = GetCell(ViewLocation);
+		for (int32 X = -1; X <= 1; X++)
+		{
+			for (int32 Y = -1; Y <= 1; Y++)
+			{
+				const TArray<int32>* CellBodies = Cells.Find(PlayerCell + FIntPoint(X, Y));
+				if (CellBodies == nullptr)
+				{
+					continue;
+				}
+
+				for (int32 BodyIndex : *CellBodies)
+				{
+					FActivationBody& Body = Bodies[BodyIndex];
+					const float DistanceSquared = FVector::DistSquared(Body.Component->GetComponentLocation(), ViewLocation);
+					Body.NearestPlayerDistanceSquared = FMath::Min(Body.NearestPlayerDistanceSquared, DistanceSquared);
+				}
+			}
+		}
+	}
+
+	for (FActivationBody& Body : Bodies)
+	{
+		SetLOD(Body, GetTargetLOD(Body));
+	}
+}
+
+EPhysicsBodyLOD UPhysicsActivationSubsystem::GetTargetLOD(const FActivationBody& Body) const
+{
+	// The simulating client is right next to it anyway.
+	const APhysicable* Physicable = Cast<APhysicable>(Body.Component->GetOwner());
+	if (Physicable && Physicable->IsClientAuthoritative())
+	{
+		return EPhysicsBodyLOD::Full;
+	}
+
+	const float Distance = FMath::Sqrt(Body.NearestPlayerDistanceSquared);
+	const float FullRadius = GetRelevantRadius() + (Body.LOD == EPhysicsBodyLOD::Full ? LODHysteresis : 0.f);
+
+	if (Body.LOD == EPhysicsBodyLOD::Frozen && Distance > ActivationRadius)
+	{
+		return EPhysicsBodyLOD::Frozen;
+	}
+
+	if (Distance > FMath::Max(DeactivationRadius, ActivationRadius))
+	{
+		return EPhysicsBodyLOD::Frozen;
+	}
+
+	return Distance <= FullRadius ? EPhysicsBodyLOD::Full : EPhysicsBodyLOD::Reduced;
+}
+
+void UPhysicsActivationSubsystem::SetLOD(FActivationBody& Body, EPhysicsBodyLOD LOD)
+{
+	if (Body.LOD == LOD)
+	{
+		return;
+	}
+
+	UE_LOG(LogPhysicsActivation, VeryVerbose, TEXT("%s: LOD %d -> %d"), *GetNameSafe(Body.Component->GetOwner()), (int32)Body.LOD, (int32)LOD);
+
+	NumBodiesAtLOD[(int32)Body.LOD]--;
+	NumBodiesAtLOD[(int32)LOD]++;
+
+	if (Body.LOD == EPhysicsBodyLOD::Frozen)
+	{
+		Activate(Body);
+	}
+	else if (Body.LOD == EPhysicsBodyLOD::Reduced)
+	{
+		SetReducedSimulation(Body, false);
+	}
+
+	if (LOD == EPhysicsBodyLOD::Frozen)
+	{
+		Freeze(Body);
+	}
+	else if (LOD == EPhysicsBodyLOD::Reduced)
+	{
+		SetReducedSimulation(Body, true);
+	}
+
+	Body.LOD = LOD;
+}
+
+void UPhysicsActivationSubsystem::Freeze(FActivationBody& Body)
+{
+	UPrimitiveComponent* Component = Body.Component.Get();
+
+	Body.SavedLinearVelocity = Component->GetPhysicsLinearVelocity();
+	Body.SavedAngularVelocity = Component->GetPhysicsAngularVelocityInRadians();
+
+	if (DeactivationMode == EPhysicsDeactivationMode::Kinematic)
+	{
+		Component->SetSimulatePhysics(false);
+	}
+	else
+	{
+		Component->PutAllRigidBodiesToSleep();
+	}
+}
+
+void UPhysicsActivationSubsystem::Activate(FActivationBody& Body)
+{
+	UPrimitiveComponent* Component = Body.Component.Get();
+
+	if (!Component->IsSimulatingPhysics())
+	{
+		Component->SetSimulatePhysics(true);
+	}
+	else if (Component->RigidBodyIsAwake())
+	{
+		// Woken up by a contact in the meantime, its velocity is newer than the saved one.
+		return;
+	}
+	else
+	{
+		Component->WakeAllRigidBodies();
+	}
+
+	Component->SetPhysicsLinearVelocity(Body.SavedLinearVelocity);
+	Component->SetPhysicsAngularVelocityInRadians(Body.SavedAngularVelocity);
+}
+
+void UPhysicsActivationSubsystem::SetReducedSimulation(FActivationBody& Body, bool bReduced)
+{
+	UPrimitiveComponent* Component = Body.Component.Get();
+	FBodyInstance* BodyInstance = Component->GetBodyInstance();
+
+	if (BodyInstance && FPhysicsInterface::IsValid(BodyInstance->ActorHandle))
+	{
+		const uint32 PositionIterations = bReduced ? ReducedSolverIterations : BodyInstance->PositionSolverIterationCount;
+		const uint32 VelocityIterations = bReduced ? ReducedSolverIterations : BodyInstance->VelocitySolverIterationCount;
+
+		FPhysicsCommand::ExecuteWrite(BodyInstance->ActorHandle, [&](const FPhysicsActorHandle& Actor)
+			{
+				FPhysicsInterface::SetSolverPositionIterationCount_AssumesLocked(Actor, PositionIterations);
+				FPhysicsInterface::SetSolverVelocityIterationCount_AssumesLocked(Actor, VelocityIterations);
+			});
+
+		BodyInstance->SetUseCCD(!bReduced && Body.bFullUseCCD);
+	}
+
+	if (AActor* Owner = Component->GetOwner())
+	{
+		Owner->SetActorTickInterval(bReduced ? FMath::Max(ReducedTickInterval, Body.FullTickInterval) : Body.FullTickInterval);
+	}
+}
+
+float UPhysicsActivationSubsystem::GetRelevantRadius() const
+{
+	return RelevantRadius > 0.f ? RelevantRadius : GetDefault<UPhysicsReplicationGraph>()->PhysicableCullDistance;
+}
+
+FIntPoint UPhysicsActivationSubsystem::GetCell(const FVector& Location) const
+{
+	const float CellSize = FMath::Max3(DeactivationRadius, ActivationRadius, 1.f);
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UPhysicsActivationSubsystem::RemoveFromCell(int32 BodyIndex)
+{
+	const FIntPoint Cell = Bodies[BodyIndex].Cell;
+	if (TArray<int32>* CellBodies = Cells.Find(Cell))
+	{
+		CellBodies->RemoveSwap(BodyIndex);
+		if (CellBodies->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+static FAutoConsoleCommand CmdPhysicsActivationDump(
+	TEXT("PhysicsActivation.Dump"),
+	TEXT("Log how many server bodies are simulated in full, reduced or frozen, per world."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			const UWorld* World = Context.World();
+			const UPhysicsActivationSubsystem* Activation = World ? World->GetSubsystem<UPhysicsActivationSubsystem>() : nullptr;
+			if (Activation == nullptr || World->GetNetMode() == NM_Client)
+			{
+				continue;
+			}
+
+			UE_LOG(LogPhysicsActivation, Display, TEXT("%s: %d bodies, %d full, %d reduced, %d frozen"), *World->GetName(), Activation->GetNumBodies(),
+				Activation->GetNumBodiesAtLOD(EPhysicsBodyLOD::Full), Activation->GetNumBodiesAtLOD(EPhysicsBodyLOD::Reduced),
+				Activation->GetNumBodiesAtLOD(EPhysicsBodyLOD::Frozen));
+		}
+	}));
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PhysicsActivationSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+/** What happens to a body no player is near. */
+UENUM()
+enum class EPhysicsDeactivationMode : uint8
+{
+	Sleep,		// Put to sleep, other bodies can still wake it up
+	Kinematic,	// Stop simulating, nothing moves it until it is activated again
+};
+
+/** How much simulation a body gets on the server. */
+enum class EPhysicsBodyLOD : uint8
+{
+	Full,		// Relevant to at least one client
+	Reduced,	// Simulated, but no client sees it: fewer solver iterations, no CCD, lower tick rate
+	Frozen,		// No player near, see EPhysicsDeactivationMode
+	Num
+};
+
+/**
+ * Server. Picks the level of simulation of every registered body from its distance to the players.
+ *
+ * Bodies are kept in a 2D grid. Every UpdateInterval only the cells around each player are visited:
+ * - bodies within RelevantRadius of a player (the replication cull distance) are simulated in full,
+ * - other bodies within ActivationRadius are simulated with ReducedSolverIterations and their actor ticks every ReducedTickInterval,
+ * - bodies further than DeactivationRadius from every player are frozen with their velocities saved.
+ * Each boundary has a margin (LODHysteresis, and the gap between the activation radii) so bodies on the edge do not switch every
+ * update. Activated bodies continue with the velocities they were frozen with.
+ */
+UCLASS(config=Game)
+class PHYSICSREPLICATION_API UPhysicsActivationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsActivationSubsystem();
+
+	virtual void			Deinitialize() override;
+
+	/** Manage Component, a simulated body. Starts at full simulation. */
+	void					Register(UPrimitiveComponent* Component);
+
+	/** Stop managing Component, as it goes away. Its simulation is left as it is. */
+	void					Unregister(UPrimitiveComponent* Component);
+
+	virtual void			Tick(float DeltaTime) override;
+
+	virtual bool			IsTickable() const override;
+
+	virtual TStatId			GetStatId() const override;
+
+	int32					GetNumBodies() const { return Bodies.Num(); }
+
+	int32					GetNumBodiesAtLOD(EPhysicsBodyLOD LOD) const { return NumBodiesAtLOD[(int32)LOD]; }
+
+	/** Bodies closer than this to a player are simulated in full, in cm. Zero or less uses the replication graph's cull distance. */
+	UPROPERTY(Config)
+	float					RelevantRadius;
+
+	/** Margin around RelevantRadius before a body goes back to reduced simulation, in cm. */
+	UPROPERTY(Config)
+	float					LODHysteresis;
+
+	/** Players activate bodies closer than this, in cm. */
+	UPROPERTY(Config)
+	float					ActivationRadius;
+
+	/** Bodies further than this from every player are frozen, in cm. At least ActivationRadius. */
+	UPROPERTY(Config)
+	float					DeactivationRadius;
+
+	/** Seconds between two updates. */
+	UPROPERTY(Config)
+	float					UpdateInterval;
+
+	UPROPERTY(Config)
+	EPhysicsDeactivationMode	DeactivationMode;
+
+	/** Position and velocity solver iterations of bodies at reduced simulation. */
+	UPROPERTY(Config)
+	int32					ReducedSolverIterations;
+
+	/** Tick interval of the actors of bodies at reduced simulation, in seconds. */
+	UPROPERTY(Config)
+	float					ReducedTickInterval;
+
+private:
+
+	struct FActivationBody
+	{
+		TWeakObjectPtr<UPrimitiveComponent>	Component;
+		FIntPoint							Cell { 0, 0 };
+		EPhysicsBodyLOD						LOD { EPhysicsBodyLOD::Full };
+		FVector								SavedLinearVelocity { FVector::ZeroVector };
+		FVector								SavedAngularVelocity { FVector::ZeroVector };
+
+		/** Settings of the body and its actor at full simulation. */
+		float								FullTickInterval { 0 };
+		bool								bFullUseCCD { false };
+
+		/** Scratch, set while visiting the cells around the players. */
+		float								NearestPlayerDistanceSquared { 0 };
+	};
+
+	void					UpdateActivation();
+
+	/** LOD the body should move to, given its current one and its distance to the nearest player. */
+	EPhysicsBodyLOD			GetTargetLOD(const FActivationBody& Body) const;
+
+	void					SetLOD(FActivationBody& Body, EPhysicsBodyLOD LOD);
+
+	void					Freeze(FActivationBody& Body);
+
+	void					Activate(FActivationBody& Body);
+
+	void					SetReducedSimulation(FActivationBody& Body, bool bReduced);
+
+	float					GetRelevantRadius() const;
+
+	FIntPoint				GetCell(const FVector& Location) const;
+
+	void					RemoveFromCell(int32 BodyIndex);
+
+	TSparseArray<FActivationBody>	Bodies;
+
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, int32>	BodyIndices;
+
+	/** Cell to the bodies in it. Bodies are moved between cells every update, frozen ones too: a contact may wake them up. */
+	TMap<FIntPoint, TArray<int32>>	Cells;
+
+	int32					NumBodiesAtLOD[(int32)EPhysicsBodyLOD::Num] = { 0, 0, 0 };
+
+	float					TimeSinceUpdate { 0 };
+};
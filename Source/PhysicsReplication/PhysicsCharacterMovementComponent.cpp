@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsCharacterMovementComponent.h"
+#include "PhysicsNetBitProfiler.h"
+
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsCharacterMovement, Log, All);
+
+namespace PhysicsInputEvents
+{
+	// Event count goes in 4 bits, see UPhysicsCharacterMovementComponent::MaxInputEventsPerMove.
+	static const uint32 MaxEventsPerMove = 15;
+
+	/** The move data containers, and so the events in them, are only sent by the packed move RPCs. */
+	static bool UsePackedMovementRPCs()
+	{
+		static const IConsoleVariable* CVarUsePackedMovementRPCs = IConsoleManager::Get().FindConsoleVariable(TEXT("p.NetUsePackedMovementRPCs"));
+		return CVarUsePackedMovementRPCs == nullptr || CVarUsePackedMovementRPCs->GetInt() != 0;
+	}
+}
+
+bool FPhysicsCharacterNetworkMoveDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!FCharacterNetworkMoveDataContainer::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicsCharacterNetworkMoveDataContainer");
+
+	uint32 NumEvents = InputEvents.Num();
+	Ar.SerializeInt(NumEvents, PhysicsInputEvents::MaxEventsPerMove + 1);
+
+	if (Ar.IsLoading())
+	{
+		InputEvents.SetNum(NumEvents, false);
+	}
+
+	if (NumEvents > 0)
+	{
+		// Sequences are consecutive, only the first one is sent.
+		uint16 FirstSequence = InputEvents[0].Sequence;
+		Ar << FirstSequence;
+
+		for (uint32 Index = 0; Index < NumEvents; Index++)
+		{
+			FPhysicsInputEvent& InputEvent = InputEvents[Index];
+			InputEvent.Sequence = FirstSequence + Index;
+
+			uint8 Type = (uint8)InputEvent.Type;
+			Ar << Type;
+			InputEvent.Type = (EPhysicsInputEvent)Type;
+		}
+	}
+	PHYSICS_NET_BIT_FIELD("InputEvents");
+
+	return !Ar.IsError();
+}
+
+void FPhysicsCharacterMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	FCharacterMoveResponseDataContainer::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const UPhysicsCharacterMovementComponent& PhysicsMovement = static_cast<const UPhysicsCharacterMovementComponent&>(CharacterMovement);
+	bHasInputEventAck = PhysicsMovement.bHasProcessedInputEvent;
+	AckedInputEventSequence = PhysicsMovement.LastProcessedInputEventSequence;
+}
+
+bool FPhysicsCharacterMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!FCharacterMoveResponseDataContainer::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicsCharacterMoveResponseDataContainer");
+
+	Ar.SerializeBits(&bHasInputEventAck, 1);
+	if (bHasInputEventAck)
+	{
+		Ar << AckedInputEventSequence;
+	}
+	PHYSICS_NET_BIT_FIELD("InputEventAck");
+
+	return !Ar.IsError();
+}
+
+UPhysicsCharacterMovementComponent::UPhysicsCharacterMovementComponent()
+{
+	MaxInputEventsPerMove = 4;
+	MaxPendingInputEvents = 32;
+
+	// Only used by the packed move RPCs (p.NetUsePackedMovementRPCs, on by default).
+	SetNetworkMoveDataContainer(PhysicsNetworkMoveDataContainer);
+	SetMoveResponseDataContainer(PhysicsMoveResponseDataContainer);
+}
+
+void UPhysicsCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetNetMode() != NM_Standalone && !PhysicsInputEvents::UsePackedMovementRPCs())
+	{
+		UE_LOG(LogPhysicsCharacterMovement, Warning, TEXT("%s: p.NetUsePackedMovementRPCs is off, input events are sent as reliable RPCs"), *GetPathName());
+	}
+}
+
+void UPhysicsCharacterMovementComponent::QueueInputEvent(EPhysicsInputEvent Event)
+{
+	if (CharacterOwner == nullptr)
+	{
+		return;
+	}
+
+	if (CharacterOwner->GetLocalRole() == ROLE_Authority)
+	{
+		OnServerInputEvent.Broadcast(Event);
+		return;
+	}
+
+	if (CharacterOwner->GetLocalRole() != ROLE_AutonomousProxy)
+	{
+		return;
+	}
+
+	if (!PhysicsInputEvents::UsePackedMovementRPCs())
+	{
+		ServerInputEvent(Event);
+		return;
+	}
+
+	if (PendingInputEvents.Num() >= MaxPendingInputEvents)
+	{
+		UE_LOG(LogPhysicsCharacterMovement, Warning, TEXT("QueueInputEvent: %d events waiting for an ack, dropping the oldest one"), PendingInputEvents.Num());
+		PendingInputEvents.RemoveAt(0);
+	}
+
+	FPhysicsInputEvent& InputEvent = PendingInputEvents.AddDefaulted_GetRef();
+	InputEvent.Sequence = NextInputEventSequence++;
+	InputEvent.Type = Event;
+
+	NumUnsentInputEvents++;
+}
+
+bool UPhysicsCharacterMovementComponent::CanDelaySendingMove(const FSavedMovePtr& NewMove)
+{
+	// Send new events with this frame's move rather than waiting for the move to combine.
+	if (NumUnsentInputEvents > 0)
+	{
+		return false;
+	}
+
+	return Super::CanDelaySendingMove(NewMove);
+}
+
+void UPhysicsCharacterMovementComponent::CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove)
+{
+	// Oldest first, so the server never sees a gap in the sequences.
+	const int32 NumEvents = FMath::Min3(PendingInputEvents.Num(), MaxInputEventsPerMove, (int32)PhysicsInputEvents::MaxEventsPerMove);
+	PhysicsNetworkMoveDataContainer.InputEvents.Reset();
+	PhysicsNetworkMoveDataContainer.InputEvents.Append(PendingInputEvents.GetData(), NumEvents);
+	NumUnsentInputEvents = 0;
+
+	Super::CallServerMovePacked(NewMove, PendingMove, OldMove);
+}
+
+void UPhysicsCharacterMovementComponent::ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer)
+{
+	Super::ServerMove_HandleMoveData(MoveDataContainer);
+
+	// Moves first, so events run from the state the client was in when it sent them.
+	ServerProcessInputEvents(static_cast<const FPhysicsCharacterNetworkMoveDataContainer&>(MoveDataContainer).InputEvents);
+}
+
+void UPhysicsCharacterMovementComponent::ServerInputEvent_Implementation(EPhysicsInputEvent Event)
+{
+	OnServerInputEvent.Broadcast(Event);
+}
+
+void UPhysicsCharacterMovementComponent::ServerProcessInputEvents(const TArray<FPhysicsInputEvent, TInlineAllocator<8>>& InputEvents)
+{
+	for (const FPhysicsInputEvent& InputEvent : InputEvents)
+	{
+		// Already run from an earlier packet.
+		if (bHasProcessedInputEvent && !IsNewerSequence(InputEvent.Sequence, LastProcessedInputEventSequence))
+		{
+			continue;
+		}
+
+		LastProcessedInputEventSequence = InputEvent.Sequence;
+		bHasProcessedInputEvent = true;
+
+		OnServerInputEvent.Broadcast(InputEvent.Type);
+	}
+}
+
+void UPhysicsCharacterMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	const FPhysicsCharacterMoveResponseDataContainer& PhysicsMoveResponse = static_cast<const FPhysicsCharacterMoveResponseDataContainer&>(MoveResponse);
+	if (PhysicsMoveResponse.bHasInputEventAck)
+	{
+		ClientAckInputEvents(PhysicsMoveResponse.AckedInputEventSequence);
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+void UPhysicsCharacterMovementComponent::ClientAckInputEvents(uint16 Sequence)
+{
+	int32 NumAcked = 0;
+	while (NumAcked < PendingInputEvents.Num() && !IsNewerSequence(PendingInputEvents[NumAcked].Sequence, Sequence))
+	{
+		NumAcked++;
+	}
+
+	if (NumAcked > 0)
+	{
+		PendingInputEvents.RemoveAt(0, NumAcked, false);
+	}
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "PhysicsCharacterMovementComponent.generated.h"
+
+/** Discrete inputs carried in the client move stream. */
+UENUM()
+enum class EPhysicsInputEvent : uint8
+{
+	Fire,
+};
+
+struct PHYSICSREPLICATION_API FPhysicsInputEvent
+{
+	/** Increasing per client, wraps around. */
+	uint16				Sequence { 0 };
+
+	EPhysicsInputEvent	Type { EPhysicsInputEvent::Fire };
+};
+
+/** Move data container that also carries the oldest unacknowledged input events of the client. */
+struct PHYSICSREPLICATION_API FPhysicsCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	virtual bool		Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+	/** Consecutive sequences, oldest first. */
+	TArray<FPhysicsInputEvent, TInlineAllocator<8>>	InputEvents;
+};
+
+/** Move response container that also acks the newest input event the server processed. */
+struct PHYSICSREPLICATION_API FPhysicsCharacterMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	virtual void		ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+
+	virtual bool		Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+	bool				bHasInputEventAck { false };
+
+	uint16				AckedInputEventSequence { 0 };
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FPhysicsInputEventDelegate, EPhysicsInputEvent);
+
+/**
+ * Character movement that sends discrete inputs (fire, ...) as numbered events inside the unreliable move RPCs instead of reliable RPCs.
+ *
+ * Every move packet repeats up to MaxInputEventsPerMove events the server has not acked yet. The server runs each sequence once,
+ * in order, and acks the newest one in its move responses. A lost packet only delays an event until the next move instead of
+ * stalling the reliable channel. Only the packed move RPCs carry events; with p.NetUsePackedMovementRPCs off they fall back to
+ * ServerInputEvent().
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicsCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsCharacterMovementComponent();
+
+	virtual void		BeginPlay() override;
+
+	/**
+	 * Owning client: queue Event for the next move sent to the server.
+	 * Server: run it right away, for listen server hosts and bots.
+	 */
+	void				QueueInputEvent(EPhysicsInputEvent Event);
+
+	/** Server. Broadcast once per input event, in the order the client queued them. */
+	FPhysicsInputEventDelegate	OnServerInputEvent;
+
+	virtual bool		CanDelaySendingMove(const FSavedMovePtr& NewMove) override;
+
+	/** Most events sent in a single move. Older events wait for these to be acked. */
+	UPROPERTY(Category="Character Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="1", UIMin="1", ClampMax="15", UIMax="15"))
+	int32				MaxInputEventsPerMove;
+
+	/** Most events waiting for an ack. The oldest event is dropped when a new one does not fit. */
+	UPROPERTY(Category="Character Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="1", UIMin="1"))
+	int32				MaxPendingInputEvents;
+
+protected:
+
+	virtual void		CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove) override;
+
+	virtual void		ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer) override;
+
+	virtual void		ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+	/** Fallback when the packed move RPCs are off: the move stream does not carry input events then. */
+	UFUNCTION(Server, Reliable)
+	void				ServerInputEvent(EPhysicsInputEvent Event);
+
+	/** Server. Run the events of a move we have not run yet. */
+	void				ServerProcessInputEvents(const TArray<FPhysicsInputEvent, TInlineAllocator<8>>& InputEvents);
+
+	/** Owning client. Release the events up to and including Sequence. */
+	void				ClientAckInputEvents(uint16 Sequence);
+
+	/** True if sequence A is newer than B, across the wrap around. */
+	static bool			IsNewerSequence(uint16 A, uint16 B) { return (int16)(A - B) > 0; }
+
+	FPhysicsCharacterNetworkMoveDataContainer	PhysicsNetworkMoveDataContainer;
+
+	FPhysicsCharacterMoveResponseDataContainer	PhysicsMoveResponseDataContainer;
+
+	/** Owning client. Queued and not acked yet, oldest first. */
+	TArray<FPhysicsInputEvent>	PendingInputEvents;
+
+	/** Owning client. Events queued since the last move was sent. */
+	int32				NumUnsentInputEvents { 0 };
+
+	uint16				NextInputEventSequence { 1 };
+
+	/** Server. Newest sequence run so far. */
+	uint16				LastProcessedInputEventSequence { 0 };
+
+	bool				bHasProcessedInputEvent { false };
+
+	friend struct FPhysicsCharacterMoveResponseDataContainer;
+};
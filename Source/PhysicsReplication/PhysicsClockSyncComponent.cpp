@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsClockSyncComponent.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsClockSync, Log, All);
+
+UPhysicsClockSyncComponent::UPhysicsClockSyncComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UPhysicsClockSyncComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!IsLocalClient())
+	{
+		return;
+	}
+
+	if (NumSamplesReceived > 0)
+	{
+		const float MaxStep = MaxSlewRate * DeltaTime;
+		Offset += FMath::Clamp(TargetOffset - Offset, -MaxStep, MaxStep);
+	}
+
+	TimeSinceRequest += DeltaTime;
+	if (TimeSinceRequest >= (IsSynchronized() ? RequestInterval : SyncRequestInterval))
+	{
+		TimeSinceRequest = 0;
+		ServerRequestTime(GetWorld()->GetTimeSeconds());
+	}
+}
+
+float UPhysicsClockSyncComponent::GetServerTime() const
+{
+	return GetWorld()->GetTimeSeconds() + Offset;
+}
+
+bool UPhysicsClockSyncComponent::IsSynchronized() const
+{
+	return !IsLocalClient() || NumSamplesReceived >= SamplesToSynchronize;
+}
+
+float UPhysicsClockSyncComponent::GetServerTime(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr)
+	{
+		return 0.f;
+	}
+
+	if (World->GetNetMode() == NM_Client)
+	{
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		const UPhysicsClockSyncComponent* ClockSync = PlayerController ? PlayerController->FindComponentByClass<UPhysicsClockSyncComponent>() : nullptr;
+		if (ClockSync && ClockSync->IsSynchronized())
+		{
+			return ClockSync->GetServerTime();
+		}
+
+		if (const AGameStateBase* GameState = World->GetGameState())
+		{
+			return GameState->GetServerWorldTimeSeconds();
+		}
+	}
+
+	return World->GetTimeSeconds();
+}
+
+float UPhysicsClockSyncComponent::UnwrapServerTime(float WrappedTime, float ReferenceTime)
+{
+	const float HalfPeriod = ServerTimeWrapPeriod * 0.5f;
+
+	float Time = ReferenceTime - FMath::Fmod(ReferenceTime, ServerTimeWrapPeriod) + WrappedTime;
+	if (Time - ReferenceTime > HalfPeriod)
+	{
+		Time -= ServerTimeWrapPeriod;
+	}
+	else if (ReferenceTime - Time > HalfPeriod)
+	{
+		Time += ServerTimeWrapPeriod;
+	}
+
+	return FMath::Max(Time, 0.f);
+}
+
+void UPhysicsClockSyncComponent::ServerRequestTime_Implementation(float ClientTime)
+{
+	ClientReceiveTime(ClientTime, GetWorld()->GetTimeSeconds());
+}
+
+void UPhysicsClockSyncComponent::ClientReceiveTime_Implementation(float ClientTime, float ServerTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float SampleRoundTripTime = Now - ClientTime;
+
+	// Answer to a request from before a world time reset, or a broken one.
+	if (SampleRoundTripTime < 0.f)
+	{
+		return;
+	}
+
+	// Assume both directions take as long: the server time was read half a round trip ago.
+	AddSample(SampleRoundTripTime, ServerTime + SampleRoundTripTime * 0.5f - Now);
+}
+
+void UPhysicsClockSyncComponent::AddSample(float SampleRoundTripTime, float SampleOffset)
+{
+	FClockSample Sample;
+	Sample.RoundTripTime = SampleRoundTripTime;
+	Sample.Offset = SampleOffset;
+
+	if (Samples.Num() < MaxSamples)
+	{
+		Samples.Add(Sample);
+	}
+	else
+	{
+		Samples[NextSample] = Sample;
+	}
+	NextSample = (NextSample + 1) % MaxSamples;
+	NumSamplesReceived++;
+
+	UpdateTarget();
+
+	if (NumSamplesReceived == 1 || FMath::Abs(TargetOffset - Offset) > StepThreshold)
+	{
+		UE_LOG(LogPhysicsClockSync, Verbose, TEXT("%s: offset stepped from %.3f to %.3f (rtt %.3f)"), *GetNameSafe(GetOwner()), Offset, TargetOffset, RoundTripTime);
+		Offset = TargetOffset;
+	}
+}
+
+void UPhysicsClockSyncComponent::UpdateTarget()
+{
+	TArray<float, TInlineAllocator<64>> RoundTripTimes;
+	for (const FClockSample& Sample : Samples)
+	{
+		RoundTripTimes.Add(Sample.RoundTripTime);
+	}
+	RoundTripTimes.Sort();
+
+	const float MaxRoundTripTime = RoundTripTimes[RoundTripTimes.Num() / 2] * OutlierFactor + OutlierTolerance;
+
+	float OffsetSum = 0.f;
+	float RoundTripTimeSum = 0.f;
+	int32 NumAccepted = 0;
+	for (const FClockSample& Sample : Samples)
+	{
+		if (Sample.RoundTripTime <= MaxRoundTripTime)
+		{
+			OffsetSum += Sample.Offset;
+			RoundTripTimeSum += Sample.RoundTripTime;
+			NumAccepted++;
+		}
+	}
+
+	// The median always passes, so there is at least one.
+	TargetOffset = OffsetSum / NumAccepted;
+	RoundTripTime = RoundTripTimeSum / NumAccepted;
+}
+
+bool UPhysicsClockSyncComponent::IsLocalClient() const
+{
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	return PlayerController && PlayerController->IsLocalController() && GetNetMode() == NM_Client;
+}
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PhysicsClockSyncComponent.generated.h"
+
+/**
+ * Estimates the server world time on the owning client of a player controller.
+ *
+ * The client pings the server with its own time and gets the server time back. Each answer is a round trip time and clock offset
+ * sample. Samples whose round trip is far above the median of the recent window are rejected (they sat in a queue on the way),
+ * the offset target is the mean of the rest, and the offset in use slews towards it at MaxSlewRate so time never jumps backwards.
+ * Only errors above StepThreshold, like the first sample, are stepped.
+ *
+ * Use GetServerTime(WorldContextObject) for anything scheduled in server time: physicable interpolation, projectile catch-up, time stamps.
+ */
+UCLASS(ClassGroup=(Physics), meta=(BlueprintSpawnableComponent))
+class PHYSICSREPLICATION_API UPhysicsClockSyncComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsClockSyncComponent();
+
+	virtual void		TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Estimated server world time. The world time itself on the server. */
+	float				GetServerTime() const;
+
+	/** True once the client has enough samples for GetServerTime() to be trusted. Always true on the server. */
+	bool				IsSynchronized() const;
+
+	/** Filtered round trip time, in seconds. */
+	float				GetRoundTripTime() const { return RoundTripTime; }
+
+	/** Server time in WorldContextObject's world from the local player's clock sync, falling back to the game state's estimate. */
+	static float		GetServerTime(const UObject* WorldContextObject);
+
+	/** Time stamps sent as 16 bit milliseconds wrap around after this many seconds. */
+	static constexpr float ServerTimeWrapPeriod = 65.536f;
+
+	/** The time, congruent to WrappedTime modulo ServerTimeWrapPeriod, closest to ReferenceTime. */
+	static float		UnwrapServerTime(float WrappedTime, float ReferenceTime);
+
+protected:
+
+	/** Seconds between time requests once synchronized. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="0.05"))
+	float				RequestInterval { 1.f };
+
+	/** Seconds between time requests until the first SamplesToSynchronize answers are in. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="0.01"))
+	float				SyncRequestInterval { 0.1f };
+
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="1"))
+	int32				SamplesToSynchronize { 5 };
+
+	/** Samples kept for the filter. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="1", ClampMax="64"))
+	int32				MaxSamples { 16 };
+
+	/** Samples with a round trip above the median times this factor, plus OutlierTolerance, are ignored. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="1"))
+	float				OutlierFactor { 1.5f };
+
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="0"))
+	float				OutlierTolerance { 0.005f };
+
+	/** Seconds of offset correction per second. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="0"))
+	float				MaxSlewRate { 0.05f };
+
+	/** Offset errors above this, in seconds, are corrected at once. */
+	UPROPERTY(EditDefaultsOnly, Category="Clock Sync", meta=(ClampMin="0"))
+	float				StepThreshold { 0.25f };
+
+private:
+
+	UFUNCTION(Server, Unreliable)
+	void				ServerRequestTime(float ClientTime);
+
+	UFUNCTION(Client, Unreliable)
+	void				ClientReceiveTime(float ClientTime, float ServerTime);
+
+	void				AddSample(float SampleRoundTripTime, float SampleOffset);
+
+	/** Recompute TargetOffset and RoundTripTime from the samples that are not outliers. */
+	void				UpdateTarget();
+
+	bool				IsLocalClient() const;
+
+	struct FClockSample
+	{
+		float			RoundTripTime { 0 };
+		float			Offset { 0 };
+	};
+
+	/** Ring buffer of the last MaxSamples samples. */
+	TArray<FClockSample>	Samples;
+
+	int32				NextSample { 0 };
+
+	int32				NumSamplesReceived { 0 };
+
+	/** Server time minus local world time, as used by GetServerTime(). */
+	float				Offset { 0 };
+
+	float				TargetOffset { 0 };
+
+	float				RoundTripTime { 0 };
+
+	float				TimeSinceRequest { 0 };
+};
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsImpulseAggregator.h"
+#include "Physicable.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "PhysicsEngine/BodyInstance.h"
+
+void UPhysicsImpulseAggregator::Deinitialize()
+{
+	if (PreTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePreTick.Remove(PreTickHandle);
+		}
+		PreTickHandle.Reset();
+	}
+
+	if (PostTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePostTick.Remove(PostTickHandle);
+		}
+		PostTickHandle.Reset();
+	}
+
+	PendingImpulses.Reset();
+	PendingNetUpdates.Reset();
+
+	Super::Deinitialize();
+}
+
+void UPhysicsImpulseAggregator::AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName)
+{
+	const FBodyInstance* BodyInstance = Component ? Component->GetBodyInstance(BoneName) : nullptr;
+	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+
+	// Nothing to batch into, behave like the component would.
+	if (BodyInstance == nullptr || PhysScene == nullptr)
+	{
+		if (Component)
+		{
+			Component->AddImpulseAtLocation(Impulse, Location, BoneName);
+		}
+		return;
+	}
+
+	// Clients simulating the physicable apply the same impulse, see APhysicable::bReplicateContactEvents.
+	APhysicable* Physicable = Cast<APhysicable>(Component->GetOwner());
+	if (Physicable && Physicable->IsSendingContactEvents() && Component->IsSimulatingPhysics(BoneName))
+	{
+		Physicable->AddContactEvent(Impulse, Location);
+	}
+
+	// The physics scene exists after the subsystem is initialized, so bind on first use.
+	if (!PreTickHandle.IsValid())
+	{
+		PreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UPhysicsImpulseAggregator::OnPhysScenePreTick);
+		PostTickHandle = PhysScene->OnPhysScenePostTick.AddUObject(this, &UPhysicsImpulseAggregator::OnPhysScenePostTick);
+	}
+
+	FBodyImpulse* BodyImpulse = PendingImpulses.FindByPredicate([Component, BoneName](const FBodyImpulse& Pending)
+	{
+		return Pending.Component.Get() == Component && Pending.BoneName == BoneName;
+	});
+
+	if (BodyImpulse == nullptr)
+	{
+		BodyImpulse = &PendingImpulses.AddDefaulted_GetRef();
+		BodyImpulse->Component = Component;
+		BodyImpulse->BoneName = BoneName;
+	}
+
+	// An impulse at a point is the same impulse at the center of mass plus an angular impulse, so hits add up exactly.
+	const FVector CenterOfMass = BodyInstance->GetCOMPosition();
+	BodyImpulse->LinearImpulse += Impulse;
+	BodyImpulse->AngularImpulse += FVector::CrossProduct(Location - CenterOfMass, Impulse);
+}
+
+void UPhysicsImpulseAggregator::OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime)
+{
+	StepDeltaTime = DeltaTime;
+	Flush();
+}
+
+void UPhysicsImpulseAggregator::OnPhysScenePostTick(FPhysScene* PhysScene)
+{
+	FlushNetUpdates();
+}
+
+void UPhysicsImpulseAggregator::Flush()
+{
+	if (PendingImpulses.Num() == 0)
+	{
+		return;
+	}
+
+	for (const FBodyImpulse& BodyImpulse : PendingImpulses)
+	{
+		UPrimitiveComponent* Component = BodyImpulse.Component.Get();
+		if (Component == nullptr || !Component->IsSimulatingPhysics(BodyImpulse.BoneName))
+		{
+			continue;
+		}
+
+		Component->AddImpulse(BodyImpulse.LinearImpulse, BodyImpulse.BoneName);
+		Component->AddAngularImpulseInRadians(BodyImpulse.AngularImpulse, BodyImpulse.BoneName);
+
+		AActor* Owner = Component->GetOwner();
+		if (Owner && Owner->GetIsReplicated())
+		{
+			PendingNetUpdates.AddUnique(Owner);
+		}
+	}
+
+	PendingImpulses.Reset();
+}
+
+void UPhysicsImpulseAggregator::FlushNetUpdates()
+{
+	// One replication update per body, however many hits it took.
+	for (const TWeakObjectPtr<AActor>& WeakActor : PendingNetUpdates)
+	{
+		AActor* Actor = WeakActor.Get();
+		if (Actor == nullptr)
+		{
+			continue;
+		}
+
+		// Contact event bodies already sent the impulses, island members go with their island and client authoritative ones are sent by their client.
+		APhysicable* Physicable = Cast<APhysicable>(Actor);
+		if (Physicable && (Physicable->IsSendingContactEvents() || Physicable->IsIslandMember() || Physicable->IsClientAuthoritative()))
+		{
+			continue;
+		}
+
+		if (Physicable)
+		{
+			Physicable->UpdatePhysicsState(StepDeltaTime);
+		}
+
+		if (Actor->NetDormancy > DORM_Awake)
+		{
+			Actor->FlushNetDormancy();
+		}
+
+		Actor->ForceNetUpdate();
+	}
+
+	PendingNetUpdates.Reset();
+}
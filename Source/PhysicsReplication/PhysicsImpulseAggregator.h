@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Physics/PhysicsInterfaceDeclares.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicsImpulseAggregator.generated.h"
+
+class UPrimitiveComponent;
+
+/**
+ * Collects impulses applied during a frame and applies them in one batch right before the physics step.
+ *
+ * Impulses on the same body are merged into one linear and one angular impulse (about the body's center of mass), so a burst of
+ * hits wakes the body and dirties its state once instead of once per hit. Every actor touched gets one ForceNetUpdate after the step,
+ * so the state it sends already includes the impulses.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicsImpulseAggregator : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void		Deinitialize() override;
+
+	/** Queue Impulse at Location on Component (BoneName for skeletal bodies). Equivalent to UPrimitiveComponent::AddImpulseAtLocation() at the next physics step. */
+	void				AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None);
+
+private:
+
+	struct FBodyImpulse
+	{
+		TWeakObjectPtr<UPrimitiveComponent>	Component;
+		FName								BoneName;
+		FVector								LinearImpulse { FVector::ZeroVector };
+		FVector								AngularImpulse { FVector::ZeroVector };
+	};
+
+	void				OnPhysScenePreTick(FPhysScene* PhysScene, float DeltaTime);
+
+	void				OnPhysScenePostTick(FPhysScene* PhysScene);
+
+	void				Flush();
+
+	/** Wake and send the actors whose bodies were given impulses, now that the step integrated them. */
+	void				FlushNetUpdates();
+
+	/** One entry per body hit this frame. */
+	TArray<FBodyImpulse>	PendingImpulses;
+
+	/** Owners of the bodies flushed before the current step. */
+	TArray<TWeakObjectPtr<AActor>>	PendingNetUpdates;
+
+	float				StepDeltaTime { 0.f };
+
+	FDelegateHandle		PreTickHandle;
+
+	FDelegateHandle		PostTickHandle;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsKeyframeErrorComponent.h"
+#include "Physicable.h"
+
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+
+UPhysicsKeyframeErrorComponent::UPhysicsKeyframeErrorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UPhysicsKeyframeErrorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	if (PlayerController == nullptr || !PlayerController->IsLocalController() || GetNetMode() != NM_Client)
+	{
+		return;
+	}
+
+	TimeSinceReport += DeltaTime;
+	if (TimeSinceReport >= ReportInterval)
+	{
+		TimeSinceReport = 0;
+		SendReport();
+	}
+}
+
+void UPhysicsKeyframeErrorComponent::SendReport()
+{
+	TArray<FPhysicsKeyframeErrorReport> Reports;
+
+	for (TActorIterator<APhysicable> It(GetWorld()); It && Reports.Num() < MaxErrorsPerReport; ++It)
+	{
+		float Error = 0.f;
+		if (!It->ConsumeKeyframeError(Error))
+		{
+			continue;
+		}
+
+		FPhysicsKeyframeErrorReport& Report = Reports.AddDefaulted_GetRef();
+		Report.Physicable = *It;
+		Report.Error = (uint16)FMath::Clamp(FMath::RoundToInt(Error), 0, 0xFFFF);
+	}
+
+	if (Reports.Num() > 0)
+	{
+		ServerReportKeyframeErrors(Reports);
+	}
+}
+
+void UPhysicsKeyframeErrorComponent::ServerReportKeyframeErrors_Implementation(const TArray<FPhysicsKeyframeErrorReport>& Reports)
+{
+	UNetConnection* Connection = GetOwner()->GetNetConnection();
+
+	for (const FPhysicsKeyframeErrorReport& Report : Reports)
+	{
+		if (IsValid(Report.Physicable))
+		{
+			Report.Physicable->ReportKeyframeError(Connection, Report.Error);
+		}
+	}
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PhysicsKeyframeErrorComponent.generated.h"
+
+class APhysicable;
+
+/** Distance between a client's simulation of a physicable and a keyframe. */
+USTRUCT()
+struct FPhysicsKeyframeErrorReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APhysicable*	Physicable { nullptr };
+
+	/** In cm, clamped to 65535. */
+	UPROPERTY()
+	uint16			Error { 0 };
+};
+
+/**
+ * Reports how far the owning client's simulation of the physicables replicated with contact events was from their keyframes, so
+ * the server can fall back to streaming the transforms of those that drift too far (see APhysicable::ReportKeyframeError()).
+ */
+UCLASS(ClassGroup=(Physics), meta=(BlueprintSpawnableComponent))
+class PHYSICSREPLICATION_API UPhysicsKeyframeErrorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsKeyframeErrorComponent();
+
+	virtual void		TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+
+	/** Seconds between two reports. */
+	UPROPERTY(EditDefaultsOnly, Category="Keyframe Error", meta=(ClampMin="0.05"))
+	float				ReportInterval { 0.5f };
+
+	/** Physicables per report, the others wait for their next keyframe. */
+	UPROPERTY(EditDefaultsOnly, Category="Keyframe Error", meta=(ClampMin="1"))
+	int32				MaxErrorsPerReport { 32 };
+
+private:
+
+	UFUNCTION(Server, Unreliable)
+	void				ServerReportKeyframeErrors(const TArray<FPhysicsKeyframeErrorReport>& Reports);
+
+	void				SendReport();
+
+	float				TimeSinceReport { 0 };
+};
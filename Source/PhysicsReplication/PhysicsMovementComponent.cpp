@@ -2,10 +2,15 @@
 
 
 #include "PhysicsMovementComponent.h"
+#include "PhysicsNetBitProfiler.h"
 
 #include "PhysicsReplicationCharacter.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/NetConnection.h"
 #include "Net/UnrealNetwork.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsMovement, Log, All);
+
 void FSavedMove_Physics::Clear()
 {
 	TimeStamp = 0.f;
@@ -25,6 +30,8 @@ void FSavedMove_Physics::Clear()
 	SavedRotation = FRotator::ZeroRotator;
 	SavedRelativeLocation = FVector::ZeroVector;
 	SavedControlRotation = FRotator::ZeroRotator;
+	ReportedLocation = FVector::ZeroVector;
+	ReportedVelocity = FVector::ZeroVector;
 	Acceleration = FVector::ZeroVector;
 	MaxSpeed = 0.0f;
 	AccelMag = 0.0f;
@@ -219,6 +226,9 @@ void FSavedMove_Physics::PostUpdate(ACharacter* C, EPostUpdateMode PostUpdateMod
 	// Only save RootMotion params when initially recording
 	if (PostUpdateMode == PostUpdate_Record)
 	{
+		ReportedLocation = SavedLocation;
+		ReportedVelocity = SavedVelocity;
+
 		const FAnimMontageInstance* RootMotionMontageInstance = Character->GetRootMotionAnimMontageInstance();
 		if (RootMotionMontageInstance)
 		{
@@ -573,11 +583,415 @@ UPhysicsMovementComponent::UPhysicsMovementComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 	SetIsReplicated(true);
+
+	Velocity = FVector::ZeroVector;
+	Acceleration = FVector::ZeroVector;
+	MaxSpeed = 1200.f;
+
+	ServerGoodMoveAckInterval = 0.1f;
+	NetworkCorrectionTolerance = 3.f;
+	NetworkMinTimeBetweenClientAdjustments = 0.1f;
+	MinTimeBetweenTimeStampResets = 4.f * 60.f;
+	NetworkRedundantMoveCount = 3;
+	NetworkReplaySkipLocationTolerance = 1.f;
+	NetworkReplaySkipVelocityTolerance = 5.f;
+
+	NetworkSmoothingMode = ENetworkSmoothingMode::Exponential;
+	NetworkSmoothLocationTime = 0.1f;
+	NetworkMaxSmoothUpdateDistance = 256.f;
+	NetworkNoSmoothUpdateDistance = 384.f;
+
+	UpdatedPrimitive = nullptr;
+	SmoothedComponent = nullptr;
+	SmoothedComponentBaseLocation = FVector::ZeroVector;
+	ClientPredictionData = nullptr;
+	ServerPredictionData = nullptr;
+
+	MoveBitWriter = FNetBitWriter(nullptr, PHYSICS_SERIALIZATION_PACKEDBITS_RESERVED_SIZE);
+	MoveResponseBitWriter = FNetBitWriter(nullptr, PHYSICS_SERIALIZATION_PACKEDBITS_RESERVED_SIZE);
+}
+
+void UPhysicsMovementComponent::BeginDestroy()
+{
+	// Allocated by GetPredictionData_Client_Physics() and GetPredictionData_Server_Physics(), owned by the component.
+	ResetPredictionData_Client();
+	ResetPredictionData_Server();
+
+	Super::BeginDestroy();
+}
+
+void UPhysicsMovementComponent::ResetPredictionData_Client()
+{
+	if (ClientPredictionData)
+	{
+		delete ClientPredictionData;
+		ClientPredictionData = nullptr;
+	}
+}
+
+void UPhysicsMovementComponent::ResetPredictionData_Server()
+{
+	if (ServerPredictionData)
+	{
+		delete ServerPredictionData;
+		ServerPredictionData = nullptr;
+	}
+}
+
+void UPhysicsMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UpdatedPrimitive == nullptr)
+	{
+		UpdatedPrimitive = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent());
+	}
+}
+
+void UPhysicsMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (GetOwnerRole() == ROLE_AutonomousProxy)
+	{
+		FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+		if (ClientData->bUpdatePosition)
+		{
+			ClientUpdatePosition();
+		}
+
+		SmoothClientPosition(DeltaTime);
+	}
+	else if (GetOwnerRole() == ROLE_Authority && ServerPredictionData != nullptr)
+	{
+		SendClientAdjustment();
+	}
+}
+
+FNetworkPredictionData_Client_Physics* UPhysicsMovementComponent::GetPredictionData_Client_Physics() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		ClientPredictionData = new FNetworkPredictionData_Client_Physics(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+FNetworkPredictionData_Server_Physics* UPhysicsMovementComponent::GetPredictionData_Server_Physics() const
+{
+	if (ServerPredictionData == nullptr)
+	{
+		ServerPredictionData = new FNetworkPredictionData_Server_Physics(*this);
+	}
+
+	return ServerPredictionData;
+}
+
+void UPhysicsMovementComponent::ServerAckGoodMove(float TimeStamp)
+{
+	FNetworkPredictionData_Server_Physics* ServerData = GetPredictionData_Server_Physics();
+	FClientAdjustmentPhysic& PendingAdjustment = ServerData->PendingAdjustment;
+
+	// Don't overwrite a correction that has not been sent yet; it acks everything up to its own move anyway.
+	if (PendingAdjustment.TimeStamp > 0.f && !PendingAdjustment.bAckGoodMove)
+	{
+		return;
+	}
+
+	PendingAdjustment.TimeStamp = TimeStamp;
+	PendingAdjustment.bAckGoodMove = true;
+}
+
+void UPhysicsMovementComponent::ServerMovePacked_Implementation(const FPhysicServerMovePackedBits& PackedBits)
+{
+	MovePacked_ServerReceive(PackedBits);
+}
+
+void UPhysicsMovementComponent::MovePacked_ServerReceive(const FPhysicServerMovePackedBits& PackedBits)
+{
+	if (UpdatedPrimitive == nullptr)
+	{
+		return;
+	}
+
+	const int32 NumBits = PackedBits.DataBits.Num();
+
+	// Reuse bit reader to avoid allocating memory each time.
+	MoveBitReader.SetData((uint8*)PackedBits.DataBits.GetData(), NumBits);
+	MoveBitReader.PackageMap = PackedBits.GetPackageMap();
+
+	if (MoveBitReader.PackageMap == nullptr)
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MovePacked_ServerReceive: Failed to find a NetConnection/PackageMap for data serialization!"));
+		return;
+	}
+
+	if (!MoveDataContainer.Serialize(*this, MoveBitReader, MoveBitReader.PackageMap) || MoveBitReader.IsError())
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MovePacked_ServerReceive: Failed to serialize movement data!"));
+		return;
+	}
+
+	const bool bNewMove = ServerProcessMoves(MoveDataContainer, [this](const FPhysicNetworkMoveData& Move, float DeltaTime)
+	{
+		ServerSimulateMove(Move, DeltaTime);
+	});
+
+	if (bNewMove)
+	{
+		ServerMoveHandleClientError(*MoveDataContainer.GetNewMoveData(), UpdatedPrimitive->GetComponentLocation(), Velocity, GetWorld()->GetTimeSeconds());
+	}
+}
+
+bool UPhysicsMovementComponent::ServerProcessMoves(const FPhysicNetworkMoveDataContainer& MoveData, TFunctionRef<void(const FPhysicNetworkMoveData& Move, float DeltaTime)> SimulateMove)
+{
+	FNetworkPredictionData_Server_Physics* ServerData = GetPredictionData_Server_Physics();
+
+	auto ProcessMove = [this, ServerData, &SimulateMove](const FPhysicNetworkMoveData& Move)
+	{
+		ServerData->LastReceivedClientTimeStamp = Move.TimeStamp;
+
+		// Already simulated from an earlier packet, or older than it.
+		bool bTimeStampResetDetected = false;
+		if (!IsClientTimeStampValid(Move.TimeStamp, *ServerData, bTimeStampResetDetected))
+		{
+			return false;
+		}
+
+		if (bTimeStampResetDetected)
+		{
+			UE_LOG(LogPhysicsMovement, Log, TEXT("TimeStamp reset detected. CurrentTimeStamp: %f, new TimeStamp: %f"), ServerData->CurrentClientTimeStamp, Move.TimeStamp);
+			ServerData->CurrentClientTimeStamp -= MinTimeBetweenTimeStampResets;
+		}
+
+		const float DeltaTime = FMath::Min(Move.TimeStamp - ServerData->CurrentClientTimeStamp, ServerData->MaxMoveDeltaTime);
+		ServerData->CurrentClientTimeStamp = Move.TimeStamp;
+
+		SimulateMove(Move, DeltaTime);
+		return true;
+	};
+
+	// Redundant moves only fill in what lost packets left out, oldest first.
+	for (int32 Index = MoveData.GetNumRedundantMoves() - 1; Index >= 0; Index--)
+	{
+		ProcessMove(MoveData.GetRedundantMoveData(Index));
+	}
+
+	return ProcessMove(*MoveData.GetNewMoveData());
+}
+
+bool UPhysicsMovementComponent::IsClientTimeStampValid(float TimeStamp, const FNetworkPredictionData_Server_Physics& ServerData, bool& bTimeStampResetDetected) const
+{
+	if (TimeStamp <= 0.f || !FMath::IsFinite(TimeStamp))
+	{
+		return false;
+	}
+
+	// Very large deltas happen around a TimeStamp reset.
+	const float DeltaTimeStamp = TimeStamp - ServerData.CurrentClientTimeStamp;
+	if (FMath::Abs(DeltaTimeStamp) > MinTimeBetweenTimeStampResets * 0.5f)
+	{
+		// Client is resetting TimeStamp to increase accuracy.
+		bTimeStampResetDetected = true;
+
+		// A move from before the reset that arrived late is outdated.
+		return DeltaTimeStamp < 0.f;
+	}
+
+	// If TimeStamp is in the past, move is outdated, not valid.
+	return TimeStamp > ServerData.CurrentClientTimeStamp;
+}
+
+void UPhysicsMovementComponent::ServerSimulateMove(const FPhysicNetworkMoveData& Move, float DeltaTime)
+{
+	Acceleration = Move.Acceleration;
+	PerformMovement(DeltaTime);
+}
+
+void UPhysicsMovementComponent::ServerMoveHandleClientError(const FPhysicNetworkMoveData& Move, const FVector& ServerLocation, const FVector& ServerVelocity, float CurrentTime)
+{
+	FNetworkPredictionData_Server_Physics* ServerData = GetPredictionData_Server_Physics();
+
+	FVector ClientLocation = Move.Location;
+	if (Move.MovementBase != nullptr)
+	{
+		MovementBaseUtility::TransformLocationToWorld(Move.MovementBase, NAME_None, Move.Location, ClientLocation);
+	}
+
+	const bool bExceedsTolerance = FVector::DistSquared(ServerLocation, ClientLocation) > FMath::Square(NetworkCorrectionTolerance);
+	if (!bExceedsTolerance)
+	{
+		ServerAckGoodMove(Move.TimeStamp);
+		return;
+	}
+
+	// Too soon after the last correction. Not acked either, or the client would drop the move and keep its error;
+	// the next move out of tolerance after the window is corrected.
+	if ((CurrentTime - ServerData->LastUpdateTime) < NetworkMinTimeBetweenClientAdjustments)
+	{
+		return;
+	}
+
+	FClientAdjustmentPhysic& PendingAdjustment = ServerData->PendingAdjustment;
+	PendingAdjustment.TimeStamp = Move.TimeStamp;
+	PendingAdjustment.bAckGoodMove = false;
+	PendingAdjustment.NewLoc = ServerLocation;
+	PendingAdjustment.NewVel = ServerVelocity;
+	PendingAdjustment.NewBase = nullptr;
+	Move.ServerFillClientReference(PendingAdjustment);
+}
+
+void UPhysicsMovementComponent::SendClientAdjustment()
+{
+	FClientAdjustmentPhysic Adjustment;
+	if (ServerPopClientAdjustment(GetWorld()->GetTimeSeconds(), Adjustment))
+	{
+		MoveResponsePacked_ServerSend(Adjustment);
+	}
+}
+
+bool UPhysicsMovementComponent::ServerPopClientAdjustment(float CurrentTime, FClientAdjustmentPhysic& OutAdjustment)
+{
+	FNetworkPredictionData_Server_Physics* ServerData = GetPredictionData_Server_Physics();
+	FClientAdjustmentPhysic& PendingAdjustment = ServerData->PendingAdjustment;
+
+	if (PendingAdjustment.TimeStamp <= 0.f)
+	{
+		return false;
+	}
+
+	if (PendingAdjustment.bAckGoodMove && (CurrentTime - ServerData->LastResponseSendTime) < ServerGoodMoveAckInterval)
+	{
+		// Keep coalescing acks until the interval elapses or a correction comes in.
+		return false;
+	}
+
+	ServerData->LastResponseSendTime = CurrentTime;
+	if (!PendingAdjustment.bAckGoodMove)
+	{
+		ServerData->LastUpdateTime = CurrentTime;
+	}
+
+	OutAdjustment = PendingAdjustment;
+
+	PendingAdjustment.TimeStamp = 0.f;
+	PendingAdjustment.bAckGoodMove = false;
+	return true;
+}
+
+void UPhysicsMovementComponent::MoveResponsePacked_ServerSend(const FClientAdjustmentPhysic& PendingAdjustment)
+{
+	MoveResponseDataContainer.ServerFillResponseData(*this, PendingAdjustment);
+
+	// Reset bit writer without affecting allocations
+	FBitWriterMark BitWriterReset;
+	BitWriterReset.Pop(MoveResponseBitWriter);
+
+	UNetConnection* NetConnection = GetOwner()->GetNetConnection();
+	MoveResponseBitWriter.PackageMap = NetConnection ? NetConnection->PackageMap : nullptr;
+
+	if (MoveResponseBitWriter.PackageMap == nullptr)
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MoveResponsePacked_ServerSend: Failed to find a NetConnection/PackageMap for data serialization!"));
+		return;
+	}
+
+	if (!MoveResponseDataContainer.Serialize(*this, MoveResponseBitWriter, MoveResponseBitWriter.PackageMap) || MoveResponseBitWriter.IsError())
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MoveResponsePacked_ServerSend: Failed to serialize out response data!"));
+		return;
+	}
+
+	// 'static' to avoid reallocation each invocation
+	static FPhysicMoveResponsePackedBits PackedBits;
+	PackedBits.DataBits.SetNumUninitialized(MoveResponseBitWriter.GetNumBits());
+	FMemory::Memcpy(PackedBits.DataBits.GetData(), MoveResponseBitWriter.GetData(), MoveResponseBitWriter.GetNumBytes());
+
+	ClientMoveResponsePacked(PackedBits);
+}
+
+void UPhysicsMovementComponent::ClientMoveResponsePacked_Implementation(const FPhysicMoveResponsePackedBits& PackedBits)
+{
+	MoveResponsePacked_ClientReceive(PackedBits);
+}
+
+void UPhysicsMovementComponent::MoveResponsePacked_ClientReceive(const FPhysicMoveResponsePackedBits& PackedBits)
+{
+	const int32 NumBits = PackedBits.DataBits.Num();
+
+	// Reuse bit reader to avoid allocating memory each time.
+	MoveResponseBitReader.SetData((uint8*)PackedBits.DataBits.GetData(), NumBits);
+	MoveResponseBitReader.PackageMap = PackedBits.GetPackageMap();
+
+	if (MoveResponseBitReader.PackageMap == nullptr)
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MoveResponsePacked_ClientReceive: Failed to find a NetConnection/PackageMap for data serialization!"));
+		return;
+	}
+
+	if (!MoveResponseDataContainer.Serialize(*this, MoveResponseBitReader, MoveResponseBitReader.PackageMap) || MoveResponseBitReader.IsError())
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("MoveResponsePacked_ClientReceive: Failed to serialize response data!"));
+		return;
+	}
+
+	ClientHandleMoveResponse(MoveResponseDataContainer);
+}
+
+void UPhysicsMovementComponent::ClientHandleMoveResponse(const FPhysicMoveResponseDataContainer& MoveResponse)
+{
+	GetPredictionData_Client_Physics()->LastReceivedAckRealTime = GetWorld()->GetRealTimeSeconds();
+
+	if (MoveResponse.IsGoodMove())
+	{
+		ClientAckGoodMove(MoveResponse.ClientAdjustment.TimeStamp);
+	}
+	else
+	{
+		ClientAdjustPosition(MoveResponse.ClientAdjustment);
+	}
+}
+
+void UPhysicsMovementComponent::ClientAckGoodMove(float TimeStamp)
+{
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+
+	// AckMove() frees every move older than the acked one too, so a single range ack releases all of them at once.
+	ClientData->AckMove(ClientData->GetSavedMoveIndex(TimeStamp));
 }
 
 void UPhysicsMovementComponent::CallServerMovePacked(const FSavedMove_Physics* NewMove,
 	const FSavedMove_Physics* PendingMove, const FSavedMove_Physics* OldMove)
 {
+	MoveDataContainer.ClientFillNetworkMoveData(NewMove, PendingMove, OldMove);
+	MoveDataContainer.ClientFillRedundantMoves(GetPredictionData_Client_Physics()->SavedMoves, NewMove, NetworkRedundantMoveCount);
+
+	// Reset bit writer without affecting allocations
+	FBitWriterMark BitWriterReset;
+	BitWriterReset.Pop(MoveBitWriter);
+
+	UNetConnection* NetConnection = GetOwner()->GetNetConnection();
+	MoveBitWriter.PackageMap = NetConnection ? NetConnection->PackageMap : nullptr;
+
+	if (MoveBitWriter.PackageMap == nullptr)
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("CallServerMovePacked: Failed to find a NetConnection/PackageMap for data serialization!"));
+		return;
+	}
+
+	if (!MoveDataContainer.Serialize(*this, MoveBitWriter, MoveBitWriter.PackageMap) || MoveBitWriter.IsError())
+	{
+		UE_LOG(LogPhysicsMovement, Error, TEXT("CallServerMovePacked: Failed to serialize out movement data!"));
+		return;
+	}
+
+	// 'static' to avoid reallocation each invocation
+	static FPhysicServerMovePackedBits PackedBits;
+	PackedBits.DataBits.SetNumUninitialized(MoveBitWriter.GetNumBits());
+	FMemory::Memcpy(PackedBits.DataBits.GetData(), MoveBitWriter.GetData(), MoveBitWriter.GetNumBytes());
+
+	ServerMovePacked(PackedBits);
 }
 
 void UPhysicsMovementComponent::CombineWith(const FSavedMove_Physics* OldMove, const FVector& OldStartLocation)
@@ -595,6 +1009,406 @@ float UPhysicsMovementComponent::GetClientNetSendDeltaTime(const FNetworkPredict
 	return 0;
 }
 
+void UPhysicsMovementComponent::ClientAdjustPosition(const FClientAdjustmentPhysic& Adjustment)
+{
+	if (UpdatedPrimitive == nullptr)
+	{
+		return;
+	}
+
+	if (ClientAckCorrection(Adjustment) != EPhysicsCorrectionResult::Replay)
+	{
+		return;
+	}
+
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+
+	// Where we are showing the body now; smoothing starts from here once the replay has produced the corrected present.
+	ClientData->LastSmoothLocation = UpdatedPrimitive->GetComponentLocation();
+	ClientData->LastServerLocation = Adjustment.NewLoc;
+
+	// Snap to the corrected state. Only the moves after the corrected one remain in SavedMoves and get replayed from here.
+	UpdatedPrimitive->SetWorldLocation(Adjustment.NewLoc, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = Adjustment.NewVel;
+
+	ClientData->bUpdatePosition = (ClientData->SavedMoves.Num() > 0);
+	if (!ClientData->bUpdatePosition)
+	{
+		SmoothCorrection(ClientData->LastSmoothLocation, Adjustment.NewLoc);
+	}
+}
+
+EPhysicsCorrectionResult UPhysicsMovementComponent::ClientAckCorrection(const FClientAdjustmentPhysic& Adjustment)
+{
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+
+	const int32 MoveIndex = ClientData->GetSavedMoveIndex(Adjustment.TimeStamp);
+	if (MoveIndex == INDEX_NONE)
+	{
+		// Move was already acked or dropped, nothing to correct against.
+		UE_LOG(LogPhysicsMovement, Verbose, TEXT("ClientAckCorrection: no saved move for TimeStamp %f"), Adjustment.TimeStamp);
+		return EPhysicsCorrectionResult::NoSavedMove;
+	}
+
+	// Early out: our recorded result for this move already matches the server, so every later move is still valid and there is nothing to replay.
+	const bool bWithinTolerance = IsWithinReplayTolerance(*ClientData->SavedMoves[MoveIndex], Adjustment.NewLoc, Adjustment.NewVel);
+
+	ClientData->AckMove(MoveIndex);
+	return bWithinTolerance ? EPhysicsCorrectionResult::WithinTolerance : EPhysicsCorrectionResult::Replay;
+}
+
+int32 UPhysicsMovementComponent::ClientReplayIntermediateMoves(FVector& InOutLocation, FVector& InOutVelocity, TFunctionRef<void(FSavedMove_Physics& Move, FVector& InOutLocation, FVector& InOutVelocity)> StepMove)
+{
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+
+	const int32 LastMoveIndex = ClientData->SavedMoves.Num() - 1;
+	for (int32 MoveIndex = 0; MoveIndex < LastMoveIndex; MoveIndex++)
+	{
+		FSavedMove_Physics* const CurrentMove = ClientData->SavedMoves[MoveIndex].Get();
+		checkSlow(CurrentMove != nullptr);
+
+		StepMove(*CurrentMove, InOutLocation, InOutVelocity);
+
+		// Replay converged back onto what we recorded: the remaining moves would reproduce their recorded results.
+		if (IsWithinReplayTolerance(*CurrentMove, InOutLocation, InOutVelocity))
+		{
+			return MoveIndex;
+		}
+
+		CurrentMove->SavedLocation = InOutLocation;
+		CurrentMove->SavedVelocity = InOutVelocity;
+	}
+
+	return INDEX_NONE;
+}
+
+void UPhysicsMovementComponent::ClientUpdatePosition()
+{
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+	ClientData->bUpdatePosition = false;
+
+	if (UpdatedPrimitive == nullptr || ClientData->SavedMoves.Num() == 0)
+	{
+		return;
+	}
+
+	ACharacter* const CharacterOwner = Cast<ACharacter>(GetOwner());
+	const FVector SavedAcceleration = Acceleration;
+
+	const int32 LastMoveIndex = ClientData->SavedMoves.Num() - 1;
+	FVector ReplayLocation = UpdatedPrimitive->GetComponentLocation();
+
+	// Velocity is passed as the replayed velocity, PerformMovementSweepOnly() updates it in place.
+	const int32 ConvergedMoveIndex = ClientReplayIntermediateMoves(ReplayLocation, Velocity, [this, CharacterOwner](FSavedMove_Physics& Move, FVector& InOutLocation, FVector& InOutVelocity)
+	{
+		Move.PrepMoveFor(CharacterOwner);
+		Acceleration = Move.Acceleration;
+		PerformMovementSweepOnly(Move.DeltaTime, InOutLocation);
+	});
+
+	// The remaining moves would reproduce their recorded results, so jump to the newest one.
+	if (ConvergedMoveIndex != INDEX_NONE)
+	{
+		const FSavedMove_Physics* const NewestMove = ClientData->SavedMoves[LastMoveIndex].Get();
+		UpdatedPrimitive->SetWorldLocation(NewestMove->SavedLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		Velocity = NewestMove->SavedVelocity;
+		Acceleration = SavedAcceleration;
+		SmoothCorrection(ClientData->LastSmoothLocation, NewestMove->SavedLocation);
+		return;
+	}
+
+	// Only the newest move pays for a full component move.
+	UpdatedPrimitive->SetWorldLocation(ReplayLocation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	FSavedMove_Physics* const NewestMove = ClientData->SavedMoves[LastMoveIndex].Get();
+	NewestMove->PrepMoveFor(CharacterOwner);
+	Acceleration = NewestMove->Acceleration;
+	PerformMovement(NewestMove->DeltaTime);
+	NewestMove->PostUpdate(CharacterOwner, FSavedMove_Physics::PostUpdate_Replay);
+
+	Acceleration = SavedAcceleration;
+
+	SmoothCorrection(ClientData->LastSmoothLocation, UpdatedPrimitive->GetComponentLocation());
+}
+
+bool UPhysicsMovementComponent::IsWithinReplayTolerance(const FSavedMove_Physics& SavedMove, const FVector& Location, const FVector& InVelocity) const
+{
+	return FVector::DistSquared(SavedMove.SavedLocation, Location) <= FMath::Square(NetworkReplaySkipLocationTolerance)
+		&& FVector::DistSquared(SavedMove.SavedVelocity, InVelocity) <= FMath::Square(NetworkReplaySkipVelocityTolerance);
+}
+
+void UPhysicsMovementComponent::PerformMovement(float DeltaTime)
+{
+	if (UpdatedPrimitive == nullptr || DeltaTime <= 0.f)
+	{
+		return;
+	}
+
+	Velocity = (Velocity + Acceleration * DeltaTime).GetClampedToMaxSize(MaxSpeed);
+
+	FHitResult Hit;
+	UpdatedPrimitive->MoveComponent(Velocity * DeltaTime, UpdatedPrimitive->GetComponentQuat(), true, &Hit);
+
+	if (Hit.IsValidBlockingHit())
+	{
+		Velocity = FVector::VectorPlaneProject(Velocity, Hit.Normal);
+	}
+}
+
+void UPhysicsMovementComponent::PerformMovementSweepOnly(float DeltaTime, FVector& InOutLocation)
+{
+	if (UpdatedPrimitive == nullptr || DeltaTime <= 0.f)
+	{
+		return;
+	}
+
+	Velocity = (Velocity + Acceleration * DeltaTime).GetClampedToMaxSize(MaxSpeed);
+
+	const FVector End = InOutLocation + Velocity * DeltaTime;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(PhysicsMovementReplay), false, GetOwner());
+	FCollisionResponseParams ResponseParams;
+	UpdatedPrimitive->InitSweepCollisionParams(QueryParams, ResponseParams);
+
+	FHitResult Hit;
+	if (GetWorld()->SweepSingleByChannel(Hit, InOutLocation, End, UpdatedPrimitive->GetComponentQuat(), UpdatedPrimitive->GetCollisionObjectType(), UpdatedPrimitive->GetCollisionShape(), QueryParams, ResponseParams))
+	{
+		InOutLocation = Hit.Location;
+		Velocity = FVector::VectorPlaneProject(Velocity, Hit.Normal);
+	}
+	else
+	{
+		InOutLocation = End;
+	}
+}
+
+void UPhysicsMovementComponent::SetSmoothedComponent(USceneComponent* NewSmoothedComponent)
+{
+	if (SmoothedComponent != nullptr)
+	{
+		SmoothedComponent->SetRelativeLocation(SmoothedComponentBaseLocation);
+	}
+
+	SmoothedComponent = NewSmoothedComponent;
+
+	if (SmoothedComponent != nullptr)
+	{
+		SmoothedComponentBaseLocation = SmoothedComponent->GetRelativeLocation();
+	}
+
+	if (ClientPredictionData != nullptr)
+	{
+		ClientPredictionData->MeshTranslationOffset = FVector::ZeroVector;
+		ClientPredictionData->OriginalMeshTranslationOffset = FVector::ZeroVector;
+	}
+}
+
+void UPhysicsMovementComponent::SmoothCorrection(const FVector& OldLocation, const FVector& NewLocation)
+{
+	FNetworkPredictionData_Client_Physics* ClientData = GetPredictionData_Client_Physics();
+
+	if (SmoothedComponent == nullptr || (NetworkSmoothingMode != ENetworkSmoothingMode::Exponential && NetworkSmoothingMode != ENetworkSmoothingMode::Linear))
+	{
+		ClientData->MeshTranslationOffset = FVector::ZeroVector;
+		return;
+	}
+
+	const FVector Delta = OldLocation - NewLocation;
+	const float DistSq = Delta.SizeSquared();
+
+	if (DistSq > FMath::Square(ClientData->NoSmoothNetUpdateDist))
+	{
+		// Teleport, nothing to hide.
+		ClientData->MeshTranslationOffset = FVector::ZeroVector;
+	}
+	else if (DistSq > FMath::Square(ClientData->MaxSmoothNetUpdateDist))
+	{
+		ClientData->MeshTranslationOffset += ClientData->MaxSmoothNetUpdateDist * Delta.GetSafeNormal();
+	}
+	else
+	{
+		ClientData->MeshTranslationOffset += Delta;
+	}
+
+	// Linear smoothing removes the offset over the time it took the server to correct us again, so a steady stream of corrections stays continuous.
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+	ClientData->LastCorrectionDelta = CurrentTime - ClientData->LastCorrectionTime;
+	ClientData->LastCorrectionTime = CurrentTime;
+	ClientData->OriginalMeshTranslationOffset = ClientData->MeshTranslationOffset;
+}
+
+void UPhysicsMovementComponent::SmoothClientPosition(float DeltaTime)
+{
+	if (SmoothedComponent == nullptr || ClientPredictionData == nullptr)
+	{
+		return;
+	}
+
+	FNetworkPredictionData_Client_Physics* ClientData = ClientPredictionData;
+	if (ClientData->MeshTranslationOffset.IsZero() && SmoothedComponent->GetRelativeLocation().Equals(SmoothedComponentBaseLocation))
+	{
+		return;
+	}
+
+	if (NetworkSmoothingMode == ENetworkSmoothingMode::Linear)
+	{
+		const float SmoothTime = FMath::Min(ClientData->LastCorrectionDelta, ClientData->MaxClientSmoothingDeltaTime);
+		const float Elapsed = GetWorld()->GetTimeSeconds() - ClientData->LastCorrectionTime;
+		const float LerpAlpha = SmoothTime > KINDA_SMALL_NUMBER ? FMath::Clamp(Elapsed / SmoothTime, 0.f, 1.f) : 1.f;
+		ClientData->MeshTranslationOffset = ClientData->OriginalMeshTranslationOffset * (1.f - LerpAlpha);
+	}
+	else if (NetworkSmoothingMode == ENetworkSmoothingMode::Exponential && DeltaTime < ClientData->SmoothNetUpdateTime)
+	{
+		ClientData->MeshTranslationOffset *= (1.f - DeltaTime / ClientData->SmoothNetUpdateTime);
+	}
+	else
+	{
+		ClientData->MeshTranslationOffset = FVector::ZeroVector;
+	}
+
+	if (ClientData->MeshTranslationOffset.SizeSquared() < FMath::Square(KINDA_SMALL_NUMBER))
+	{
+		ClientData->MeshTranslationOffset = FVector::ZeroVector;
+	}
+
+	// The offset is in world space, the component lives in its parent's space.
+	const USceneComponent* SmoothedParent = SmoothedComponent->GetAttachParent();
+	const FVector RelativeOffset = SmoothedParent ? SmoothedParent->GetComponentTransform().InverseTransformVector(ClientData->MeshTranslationOffset) : ClientData->MeshTranslationOffset;
+	SmoothedComponent->SetRelativeLocation(SmoothedComponentBaseLocation + RelativeOffset);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FNetworkPredictionData_Server_Physics::FNetworkPredictionData_Server_Physics(const UPhysicsMovementComponent& ServerMovement)
+	: CurrentClientTimeStamp(0.f)
+	, LastReceivedClientTimeStamp(0.f)
+	, ServerAccumulatedClientTimeStamp(0.0)
+	, LastUpdateTime(0.f)
+	, LastResponseSendTime(0.f)
+	, ServerTimeStampLastServerMove(0.f)
+	, MaxMoveDeltaTime(0.125f)
+	, bForceClientUpdate(false)
+	, LifetimeRawTimeDiscrepancy(0.f)
+	, TimeDiscrepancy(0.f)
+	, bResolvingTimeDiscrepancy(false)
+	, TimeDiscrepancyResolutionMoveDeltaOverride(0.f)
+	, TimeDiscrepancyAccumulatedClientDeltasSinceLastServerTick(0.f)
+	, WorldCreationTime(0.f)
+{
+	if (const UWorld* World = ServerMovement.GetWorld())
+	{
+		WorldCreationTime = World->GetTimeSeconds();
+	}
+}
+
+FNetworkPredictionData_Server_Physics::~FNetworkPredictionData_Server_Physics()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FNetworkPredictionData_Client_Physics::FNetworkPredictionData_Client_Physics(const UPhysicsMovementComponent& ClientMovement)
+	: ClientUpdateTime(0.f)
+	, CurrentTimeStamp(0.f)
+	, LastReceivedAckRealTime(0.f)
+	, PendingMove(nullptr)
+	, LastAckedMove(nullptr)
+	, MaxFreeMoveCount(96)
+	, MaxSavedMoveCount(96)
+	, bUpdatePosition(false)
+	, OriginalMeshTranslationOffset(ForceInitToZero)
+	, MeshTranslationOffset(ForceInitToZero)
+	, OriginalMeshRotationOffset(FQuat::Identity)
+	, MeshRotationOffset(FQuat::Identity)
+	, MeshRotationTarget(FQuat::Identity)
+	, LastCorrectionDelta(0.f)
+	, LastCorrectionTime(0.f)
+	, MaxClientSmoothingDeltaTime(0.5f)
+	, SmoothingServerTimeStamp(0.f)
+	, SmoothingClientTimeStamp(0.f)
+	, MaxSmoothNetUpdateDist(0.f)
+	, NoSmoothNetUpdateDist(0.f)
+	, SmoothNetUpdateTime(0.f)
+	, SmoothNetUpdateRotationTime(0.f)
+	, MaxMoveDeltaTime(0.125f)
+	, LastSmoothLocation(FVector::ZeroVector)
+	, LastServerLocation(FVector::ZeroVector)
+	, SimulatedDebugDrawTime(0.f)
+	, DebugForcedPacketLossTimerStart(0.f)
+{
+	MaxSmoothNetUpdateDist = ClientMovement.NetworkMaxSmoothUpdateDistance;
+	NoSmoothNetUpdateDist = ClientMovement.NetworkNoSmoothUpdateDistance;
+	SmoothNetUpdateTime = ClientMovement.NetworkSmoothLocationTime;
+}
+
+FNetworkPredictionData_Client_Physics::~FNetworkPredictionData_Client_Physics()
+{
+	SavedMoves.Empty();
+	FreeMoves.Empty();
+	PendingMove = nullptr;
+	LastAckedMove = nullptr;
+}
+
+int32 FNetworkPredictionData_Client_Physics::GetSavedMoveIndex(float TimeStamp) const
+{
+	for (int32 Index = 0; Index < SavedMoves.Num(); Index++)
+	{
+		const FSavedMove_Physics* CurrentMove = SavedMoves[Index].Get();
+		checkSlow(CurrentMove != nullptr);
+		if (CurrentMove->TimeStamp == TimeStamp)
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FNetworkPredictionData_Client_Physics::AckMove(int32 AckedMoveIndex)
+{
+	// It is important that we know the move exists before we go deleting outdated moves.
+	// Timestamps are not guaranteed to be increasing order all the time, since they can be reset!
+	if (AckedMoveIndex != INDEX_NONE)
+	{
+		// Keep reference to LastAckedMove
+		const FSavedPhysicsMovePtr AckedMovePtr = SavedMoves[AckedMoveIndex];
+		if (LastAckedMove.IsValid())
+		{
+			FreeMove(LastAckedMove);
+		}
+		LastAckedMove = AckedMovePtr;
+
+		// Free expired moves.
+		for (int32 MoveIndex = 0; MoveIndex < AckedMoveIndex; MoveIndex++)
+		{
+			FreeMove(SavedMoves[MoveIndex]);
+		}
+
+		// And finally cull all of those, so only the unacknowledged moves remain in SavedMoves.
+		const bool bAllowShrinking = false;
+		SavedMoves.RemoveAt(0, AckedMoveIndex + 1, bAllowShrinking);
+	}
+}
+
+void FNetworkPredictionData_Client_Physics::FreeMove(const FSavedPhysicsMovePtr& Move)
+{
+	if (Move.IsValid())
+	{
+		// Only keep a pool of a limited number of moves.
+		if (FreeMoves.Num() < MaxFreeMoveCount)
+		{
+			FreeMoves.Push(Move);
+		}
+
+		// Shouldn't keep a reference to the move on the free list.
+		if (PendingMove == Move)
+		{
+			PendingMove = nullptr;
+		}
+		if (LastAckedMove == Move)
+		{
+			LastAckedMove = nullptr;
+		}
+	}
+}
+
 bool FPhysicNetworkSerializationPackedBits::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
 {
 	const bool bLocalSuccess = true;
@@ -630,14 +1444,16 @@ void FPhysicNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Physics&
 		// Determine if we send absolute or relative location
 		UPrimitiveComponent* ClientMovementBase = ClientMove.EndBase.Get();
 		const bool bDynamicBase = MovementBaseUtility::UseRelativeLocation(ClientMovementBase);
-		const FVector SendLocation = bDynamicBase ? ClientMove.SavedRelativeLocation : ClientMove.SavedLocation;
+		const FVector SendLocation = bDynamicBase ? ClientMove.SavedRelativeLocation : ClientMove.ReportedLocation;
 
 		Location = SendLocation;
+		Velocity = ClientMove.ReportedVelocity;
 		MovementBase = bDynamicBase ? ClientMovementBase : nullptr;
 	}
 	else
 	{
 		Location = ClientMove.SavedLocation;
+		Velocity = FVector::ZeroVector;
 		MovementBase = nullptr;
 	}
 }
@@ -649,32 +1465,147 @@ bool FPhysicNetworkMoveData::Serialize(UPhysicsMovementComponent& PhysicsMovemen
 	bool bLocalSuccess = true;
 	const bool bIsSaving = Ar.IsSaving();
 
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicNetworkMoveData");
+
 	Ar << TimeStamp;
+	PHYSICS_NET_BIT_FIELD("TimeStamp");
 
 	// TODO: better packing with single bit per component indicating zero/non-zero
 	Acceleration.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	PHYSICS_NET_BIT_FIELD("Acceleration");
 
 	Location.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	PHYSICS_NET_BIT_FIELD("Location");
 
 	// ControlRotation : FRotator handles each component zero/non-zero test; it uses a single signal bit for zero/non-zero, and uses 16 bits per component if non-zero.
 	ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	PHYSICS_NET_BIT_FIELD("ControlRotation");
 
 	SerializeOptionalValue<uint8>(bIsSaving, Ar, CompressedMoveFlags, 0);
+	PHYSICS_NET_BIT_FIELD("CompressedMoveFlags");
 
 	if (MoveType == ENetworkMoveType::NewMove)
 	{
 		// Location, relative movement base, and ending movement mode is only used for error checking, so only save for the final move.
 		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		PHYSICS_NET_BIT_FIELD("MovementBase");
+
 		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+		PHYSICS_NET_BIT_FIELD("MovementMode");
+
+		// Reference for client relative corrections.
+		Velocity.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		PHYSICS_NET_BIT_FIELD("Velocity");
 	}
 
 	return !Ar.IsError();
 }
 
+namespace PhysicsRedundantMove
+{
+	// Time stamp deltas are sent in tenths of a millisecond.
+	static const float TimeStampScale = 10000.f;
+
+	/** Acceleration as the server rebuilds it: FVector_NetQuantize10 and SerializePackedVector<10, 24> both round to a tenth. */
+	static FVector QuantizeAcceleration(const FVector& Acceleration)
+	{
+		return FVector(FMath::RoundToFloat(Acceleration.X * 10.f), FMath::RoundToFloat(Acceleration.Y * 10.f), FMath::RoundToFloat(Acceleration.Z * 10.f)) / 10.f;
+	}
+}
+
+bool FPhysicNetworkMoveData::SerializeRedundant(UPhysicsMovementComponent& PhysicsMovement, FArchive& Ar, UPackageMap* PackageMap, const FPhysicNetworkMoveData& NewerMove)
+{
+	NetworkMoveType = ENetworkMoveType::RedundantMove;
+
+	bool bLocalSuccess = true;
+	const bool bIsSaving = Ar.IsSaving();
+
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicNetworkMoveData.Redundant");
+
+	// Each move is sent relative to the next one as the server rebuilds it, and the sender keeps the rebuilt values too,
+	// so the next (older) move is delta encoded against the same base on both sides and rounding does not add up along the chain.
+	uint32 TimeStampDelta = 0;
+	if (bIsSaving)
+	{
+		// Rounded up: the rebuilt TimeStamp is never later than the move's own, or the server would take a move it already simulated for a new one.
+		TimeStampDelta = (uint32)FMath::Max(FMath::CeilToInt((NewerMove.TimeStamp - TimeStamp) * PhysicsRedundantMove::TimeStampScale), 0);
+		if (NewerMove.TimeStamp - TimeStampDelta / PhysicsRedundantMove::TimeStampScale > TimeStamp)
+		{
+			TimeStampDelta++;
+		}
+	}
+	Ar.SerializeIntPacked(TimeStampDelta);
+	TimeStamp = NewerMove.TimeStamp - TimeStampDelta / PhysicsRedundantMove::TimeStampScale;
+	PHYSICS_NET_BIT_FIELD("TimeStamp");
+
+	// The newer move may be the new move, whose acceleration is only rounded on the wire.
+	const FVector NewerAcceleration = PhysicsRedundantMove::QuantizeAcceleration(NewerMove.Acceleration);
+	if (bIsSaving)
+	{
+		Acceleration = PhysicsRedundantMove::QuantizeAcceleration(Acceleration);
+	}
+
+	uint8 bSameAcceleration = bIsSaving ? (FVector(Acceleration) == NewerAcceleration) : 0;
+	Ar.SerializeBits(&bSameAcceleration, 1);
+	if (bSameAcceleration)
+	{
+		Acceleration = NewerAcceleration;
+	}
+	else
+	{
+		// Both sides are on the tenth grid, so the difference is too and packs without further rounding.
+		FVector AccelerationDelta = bIsSaving ? PhysicsRedundantMove::QuantizeAcceleration(Acceleration - NewerAcceleration) : FVector::ZeroVector;
+		bLocalSuccess &= SerializePackedVector<10, 24>(AccelerationDelta, Ar);
+		Acceleration = NewerAcceleration + AccelerationDelta;
+	}
+	PHYSICS_NET_BIT_FIELD("Acceleration");
+
+	uint8 bSameControlRotation = bIsSaving ? ControlRotation.Equals(NewerMove.ControlRotation, 0.f) : 0;
+	Ar.SerializeBits(&bSameControlRotation, 1);
+	if (bSameControlRotation)
+	{
+		ControlRotation = NewerMove.ControlRotation;
+	}
+	else
+	{
+		ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	}
+	PHYSICS_NET_BIT_FIELD("ControlRotation");
+
+	uint8 bSameFlags = bIsSaving ? (CompressedMoveFlags == NewerMove.CompressedMoveFlags) : 0;
+	Ar.SerializeBits(&bSameFlags, 1);
+	if (bSameFlags)
+	{
+		CompressedMoveFlags = NewerMove.CompressedMoveFlags;
+	}
+	else
+	{
+		Ar << CompressedMoveFlags;
+	}
+	PHYSICS_NET_BIT_FIELD("CompressedMoveFlags");
+
+	if (!bIsSaving)
+	{
+		Location = FVector::ZeroVector;
+		Velocity = FVector::ZeroVector;
+		MovementBase = nullptr;
+	}
+
+	return bLocalSuccess && !Ar.IsError();
+}
+
+void FPhysicNetworkMoveData::ServerFillClientReference(FClientAdjustmentPhysic& Adjustment) const
+{
+	Adjustment.bHasClientReference = (NetworkMoveType == ENetworkMoveType::NewMove) && (MovementBase == nullptr);
+	Adjustment.ClientLoc = Location;
+	Adjustment.ClientVel = Velocity;
+}
+
 void FPhysicNetworkMoveDataContainer::ClientFillNetworkMoveData(const FSavedMove_Physics* ClientNewMove,
 	const FSavedMove_Physics* ClientPendingMove, const FSavedMove_Physics* ClientOldMove)
 {
 	bDisableCombinedScopedMove = false;
+	NumRedundantMoves = 0;
 
 	if (ensure(ClientNewMove))
 	{
@@ -698,40 +1629,84 @@ void FPhysicNetworkMoveDataContainer::ClientFillNetworkMoveData(const FSavedMove
 	}
 }
 
+void FPhysicNetworkMoveDataContainer::ClientFillRedundantMoves(const TArray<TSharedPtr<FSavedMove_Physics>>& SavedMoves,
+	const FSavedMove_Physics* ClientNewMove, int32 MaxMoves)
+{
+	NumRedundantMoves = 0;
+	MaxMoves = FMath::Min(MaxMoves, MaxRedundantMoves);
+
+	// SavedMoves only holds unacknowledged moves, oldest first.
+	for (int32 Index = SavedMoves.Num() - 1; Index >= 0 && NumRedundantMoves < MaxMoves; Index--)
+	{
+		const FSavedMove_Physics* SavedMove = SavedMoves[Index].Get();
+		if (SavedMove == ClientNewMove || SavedMove->TimeStamp >= ClientNewMove->TimeStamp)
+		{
+			continue;
+		}
+
+		RedundantMoveData[NumRedundantMoves++].ClientFillNetworkMoveData(*SavedMove, FPhysicNetworkMoveData::ENetworkMoveType::RedundantMove);
+	}
+}
+
 bool FPhysicNetworkMoveDataContainer::Serialize(UPhysicsMovementComponent& CharacterMovement, FArchive& Ar,
 	UPackageMap* PackageMap)
 {
 	// We must have data storage initialized. If not, then the storage container wasn't properly initialized.
 	check(NewMoveData && PendingMoveData && OldMoveData);
 
+	// Only the container's own flags, the moves account for themselves.
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicNetworkMoveDataContainer");
+
 	// Base move always serialized.
 	if (!NewMoveData->Serialize(CharacterMovement, Ar, PackageMap, FPhysicNetworkMoveData::ENetworkMoveType::NewMove))
 	{
 		return false;
 	}
+	PHYSICS_NET_BIT_SKIP();
 		
 	// Optional pending dual move
 	Ar.SerializeBits(&bHasPendingMove, 1);
 	if (bHasPendingMove)
 	{
 		Ar.SerializeBits(&bIsDualHybridRootMotionMove, 1);
+		PHYSICS_NET_BIT_FIELD("Flags");
 		if (!PendingMoveData->Serialize(CharacterMovement, Ar, PackageMap, FPhysicNetworkMoveData::ENetworkMoveType::PendingMove))
 		{
 			return false;
 		}
+		PHYSICS_NET_BIT_SKIP();
 	}
 
 	// Optional old move
 	Ar.SerializeBits(&bHasOldMove, 1);
+	PHYSICS_NET_BIT_FIELD("Flags");
 	if (bHasOldMove)
 	{
 		if (!OldMoveData->Serialize(CharacterMovement, Ar, PackageMap, FPhysicNetworkMoveData::ENetworkMoveType::OldMove))
 		{
 			return false;
 		}
+		PHYSICS_NET_BIT_SKIP();
 	}
 
 	Ar.SerializeBits(&bDisableCombinedScopedMove, 1);
+	PHYSICS_NET_BIT_FIELD("Flags");
+
+	// Redundancy window, newest first, each move relative to the one after it.
+	uint32 NumRedundant = NumRedundantMoves;
+	Ar.SerializeInt(NumRedundant, MaxRedundantMoves + 1);
+	NumRedundantMoves = (int32)NumRedundant;
+	PHYSICS_NET_BIT_FIELD("NumRedundantMoves");
+
+	for (int32 Index = 0; Index < NumRedundantMoves; Index++)
+	{
+		const FPhysicNetworkMoveData& NewerMove = (Index == 0) ? *NewMoveData : RedundantMoveData[Index - 1];
+		if (!RedundantMoveData[Index].SerializeRedundant(CharacterMovement, Ar, PackageMap, NewerMove))
+		{
+			return false;
+		}
+	}
+	PHYSICS_NET_BIT_SKIP();
 
 	return !Ar.IsError();
 }
@@ -751,22 +1726,122 @@ void FPhysicMoveResponseDataContainer::ServerFillResponseData(const UPhysicsMove
 
 }
 
+namespace PhysicsMoveResponse
+{
+	// Corrections relative to the client reported state. Location deltas are sent in millimeters, velocity deltas in tenths of cm/s.
+	static const uint32 RelativeScale = 10;
+	static const int32 RelativeMaxBitsPerComponent = 16;
+
+	static bool FitsRelative(const FVector& Delta)
+	{
+		return Delta.GetAbsMax() * RelativeScale < float(1 << (RelativeMaxBitsPerComponent - 1));
+	}
+
+	/** Serialize Value either as a quantized delta from Reference (if given and close enough) or as an absolute FVector. */
+	static void SerializeClientRelativeVector(FArchive& Ar, UPackageMap* PackageMap, FVector& Value, const FVector* Reference, bool& bOutSuccess)
+	{
+		FVector Delta = FVector::ZeroVector;
+		uint8 bRelative = 0;
+
+		if (Ar.IsSaving() && Reference != nullptr)
+		{
+			Delta = Value - *Reference;
+			bRelative = FitsRelative(Delta) ? 1 : 0;
+		}
+
+		Ar.SerializeBits(&bRelative, 1);
+
+		if (bRelative)
+		{
+			bOutSuccess &= SerializePackedVector<RelativeScale, RelativeMaxBitsPerComponent>(Delta, Ar);
+			if (Ar.IsLoading())
+			{
+				// Without a reference the move is gone on the client and the correction will be discarded, but the bits still need consuming.
+				Value = (Reference != nullptr ? *Reference : FVector::ZeroVector) + Delta;
+			}
+		}
+		else
+		{
+			Value.NetSerialize(Ar, PackageMap, bOutSuccess);
+		}
+	}
+}
+
+uint16 FPhysicMoveResponseDataContainer::QuantizeTimeStamp(float TimeStamp)
+{
+	return (uint16)(FMath::RoundToInt(TimeStamp * 10000.f) & 0xFFFF);
+}
+
+FVector FPhysicMoveResponseDataContainer::QuantizeReportedLocation(const FVector& Location)
+{
+	return FVector(FMath::RoundToInt(Location.X * 100.f), FMath::RoundToInt(Location.Y * 100.f), FMath::RoundToInt(Location.Z * 100.f)) / 100.f;
+}
+
+FVector FPhysicMoveResponseDataContainer::QuantizeReportedVelocity(const FVector& Velocity)
+{
+	return FVector(FMath::RoundToInt(Velocity.X * 10.f), FMath::RoundToInt(Velocity.Y * 10.f), FMath::RoundToInt(Velocity.Z * 10.f)) / 10.f;
+}
+
 bool FPhysicMoveResponseDataContainer::Serialize(UPhysicsMovementComponent& CharacterMovement, FArchive& Ar,
 	UPackageMap* PackageMap)
 {
 	bool bLocalSuccess = true;
 	const bool bIsSaving = Ar.IsSaving();
 
+	PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, "FPhysicMoveResponseDataContainer");
+
 	Ar.SerializeBits(&ClientAdjustment.bAckGoodMove, 1);
-	Ar << ClientAdjustment.TimeStamp;
+	PHYSICS_NET_BIT_FIELD("bAckGoodMove");
+
+	uint16 QuantizedTimeStamp = bIsSaving ? QuantizeTimeStamp(ClientAdjustment.TimeStamp) : 0;
+	Ar << QuantizedTimeStamp;
+	PHYSICS_NET_BIT_FIELD("TimeStamp");
+
+	// On the client, find the saved move this response is about. It provides both the exact TimeStamp and the reference state for relative corrections.
+	const FSavedMove_Physics* ReferenceMove = nullptr;
+	if (!bIsSaving)
+	{
+		const FNetworkPredictionData_Client_Physics* ClientData = CharacterMovement.GetPredictionData_Client_Physics();
+		for (const FSavedPhysicsMovePtr& SavedMove : ClientData->SavedMoves)
+		{
+			if (QuantizeTimeStamp(SavedMove->TimeStamp) == QuantizedTimeStamp)
+			{
+				ReferenceMove = SavedMove.Get();
+				break;
+			}
+		}
+
+		// Unknown moves were already acked or dropped; an invalid TimeStamp makes the response a no-op.
+		ClientAdjustment.TimeStamp = ReferenceMove ? ReferenceMove->TimeStamp : -1.f;
+	}
 
 	if (IsCorrection())
 	{
 		Ar.SerializeBits(&bHasBase, 1);
 		Ar.SerializeBits(&bHasRotation, 1);
+		PHYSICS_NET_BIT_FIELD("Flags");
 
-		ClientAdjustment.NewLoc.NetSerialize(Ar, PackageMap, bLocalSuccess);
-		ClientAdjustment.NewVel.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		FVector ReferenceLocation;
+		FVector ReferenceVelocity;
+		bool bHasReference = false;
+		if (bIsSaving)
+		{
+			bHasReference = ClientAdjustment.bHasClientReference;
+			ReferenceLocation = ClientAdjustment.ClientLoc;
+			ReferenceVelocity = ClientAdjustment.ClientVel;
+		}
+		else if (ReferenceMove != nullptr)
+		{
+			bHasReference = true;
+			ReferenceLocation = QuantizeReportedLocation(ReferenceMove->ReportedLocation);
+			ReferenceVelocity = QuantizeReportedVelocity(ReferenceMove->ReportedVelocity);
+		}
+
+		PhysicsMoveResponse::SerializeClientRelativeVector(Ar, PackageMap, ClientAdjustment.NewLoc, bHasReference ? &ReferenceLocation : nullptr, bLocalSuccess);
+		PHYSICS_NET_BIT_FIELD("NewLoc");
+
+		PhysicsMoveResponse::SerializeClientRelativeVector(Ar, PackageMap, ClientAdjustment.NewVel, bHasReference ? &ReferenceVelocity : nullptr, bLocalSuccess);
+		PHYSICS_NET_BIT_FIELD("NewVel");
 
 		if (bHasRotation)
 		{
@@ -776,13 +1851,43 @@ bool FPhysicMoveResponseDataContainer::Serialize(UPhysicsMovementComponent& Char
 		{
 			ClientAdjustment.NewRot = FRotator::ZeroRotator;
 		}
+		PHYSICS_NET_BIT_FIELD("NewRot");
 
 		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, ClientAdjustment.NewBase, nullptr);
-		SerializeOptionalValue<FName>(bIsSaving, Ar, ClientAdjustment.NewBaseBoneName, NAME_None);
+		PHYSICS_NET_BIT_FIELD("NewBase");
+
+		// Bone names on skinned bases go as a bone index, anything else falls back to the FName.
+		const USkinnedMeshComponent* SkinnedBase = Cast<USkinnedMeshComponent>(ClientAdjustment.NewBase);
+		uint32 BoneIndexPlusOne = 0;
+		if (bIsSaving && SkinnedBase && ClientAdjustment.NewBaseBoneName != NAME_None)
+		{
+			BoneIndexPlusOne = (uint32)(SkinnedBase->GetBoneIndex(ClientAdjustment.NewBaseBoneName) + 1);
+		}
+
+		uint8 bBoneIndex = (BoneIndexPlusOne != 0) ? 1 : 0;
+		Ar.SerializeBits(&bBoneIndex, 1);
+
+		if (bBoneIndex)
+		{
+			Ar.SerializeIntPacked(BoneIndexPlusOne);
+			if (!bIsSaving)
+			{
+				ClientAdjustment.NewBaseBoneName = SkinnedBase ? SkinnedBase->GetBoneName((int32)BoneIndexPlusOne - 1) : NAME_None;
+			}
+		}
+		else
+		{
+			SerializeOptionalValue<FName>(bIsSaving, Ar, ClientAdjustment.NewBaseBoneName, NAME_None);
+		}
+		PHYSICS_NET_BIT_FIELD("NewBaseBoneName");
+
 		SerializeOptionalValue<uint8>(bIsSaving, Ar, ClientAdjustment.MovementMode, MOVE_Walking);
+		PHYSICS_NET_BIT_FIELD("MovementMode");
+
 		Ar.SerializeBits(&ClientAdjustment.bBaseRelativePosition, 1);
+		PHYSICS_NET_BIT_FIELD("bBaseRelativePosition");
 	}
 
 	return !Ar.IsError();
-
 }
+
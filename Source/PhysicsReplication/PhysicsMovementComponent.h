@@ -6,10 +6,12 @@
 #include "PhysicsMovementReplication.h"
 #include "Components/ActorComponent.h"
 #include "Interfaces/NetworkPredictionInterface.h"
+#include "Templates/Function.h"
 #include "PhysicsMovementComponent.generated.h"
 
 
 class FNetworkPredictionData_Client_Physics;
+class FNetworkPredictionData_Server_Physics;
 
 /** Shared pointer for easy memory management of FSavedMove_Character, for accumulating and replaying network moves. */
 typedef TSharedPtr<class FSavedMove_Physics> FSavedPhysicsMovePtr;
@@ -51,6 +53,11 @@ public:
 	FRotator SavedControlRotation;
 	TWeakObjectPtr<UPrimitiveComponent> EndBase;
 
+	// State after the move as recorded and reported to the server. Replays rewrite SavedLocation and SavedVelocity but never these,
+	// so corrections relative to the reported state decode against what the server actually received.
+	FVector ReportedLocation;
+	FVector ReportedVelocity;
+
 	FVector Acceleration;
 	float MaxSpeed;
 
@@ -107,6 +114,14 @@ public:
 	virtual void GetPackedAngles(uint32& YawAndPitchPack, uint8& RollPack) const;
 };
 
+/** What the client has to do about a correction from the server, see UPhysicsMovementComponent::ClientAckCorrection(). */
+enum class EPhysicsCorrectionResult : uint8
+{
+	NoSavedMove,		// The corrected move was already acked or dropped, the correction is ignored.
+	WithinTolerance,	// The state recorded for the move matches the correction, it was handled as an ack.
+	Replay,				// The moves after the corrected one have to be replayed from the corrected state.
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class PHYSICSREPLICATION_API UPhysicsMovementComponent : public UActorComponent//, public INetworkPredictionInterface
 {
@@ -116,6 +131,90 @@ public:
 
 	UPhysicsMovementComponent();
 
+protected:
+
+	virtual void BeginPlay() override;
+
+public:
+
+	virtual void BeginDestroy() override;
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Get prediction data for a client game. Creates the data on first use. */
+	FNetworkPredictionData_Client_Physics* GetPredictionData_Client_Physics() const;
+
+	/** Get prediction data for a server game. Creates the data on first use. */
+	FNetworkPredictionData_Server_Physics* GetPredictionData_Server_Physics() const;
+
+	/** Delete the client prediction data, e.g. when the owner stops being locally controlled. Recreated on next use. */
+	void ResetPredictionData_Client();
+
+	/** Delete the server prediction data. Recreated on next use. */
+	void ResetPredictionData_Server();
+
+	/**
+	 * On the server, record that the move at TimeStamp was accepted. Good moves are not acked one by one: the newest accepted TimeStamp is kept
+	 * and sent as a single "acked up to" response by SendClientAdjustment() at most every ServerGoodMoveAckInterval seconds.
+	 * A pending correction is never replaced by a good move ack.
+	 */
+	virtual void ServerAckGoodMove(float TimeStamp);
+
+	/** Moves sent by the owning client with CallServerMovePacked(). */
+	UFUNCTION(Server, Unreliable)
+	void ServerMovePacked(const FPhysicServerMovePackedBits& PackedBits);
+
+	/** Deserialize moves received from the client, simulate the ones not processed yet and check the newest one against the client's result. */
+	virtual void MovePacked_ServerReceive(const FPhysicServerMovePackedBits& PackedBits);
+
+	/**
+	 * On the server, pass the moves of MoveData that were not processed yet to SimulateMove: redundant moves oldest first, then the new move.
+	 * Moves at or before the last processed TimeStamp are skipped, unless the client reset its TimeStamp, and DeltaTime is clamped to
+	 * MaxMoveDeltaTime. Returns true if the new move was simulated.
+	 */
+	bool ServerProcessMoves(const FPhysicNetworkMoveDataContainer& MoveData, TFunctionRef<void(const FPhysicNetworkMoveData& Move, float DeltaTime)> SimulateMove);
+
+	/**
+	 * Whether a move with TimeStamp should be simulated. A jump of more than half of MinTimeBetweenTimeStampResets means the client
+	 * reset its TimeStamp: bTimeStampResetDetected is set, and the move is valid only if it is from after the reset.
+	 */
+	bool IsClientTimeStampValid(float TimeStamp, const FNetworkPredictionData_Server_Physics& ServerData, bool& bTimeStampResetDetected) const;
+
+	/** Simulate one move received from the client on UpdatedPrimitive. */
+	virtual void ServerSimulateMove(const FPhysicNetworkMoveData& Move, float DeltaTime);
+
+	/**
+	 * Compare the server state after Move with the state the client reported for it. Queues a correction if they are further apart than
+	 * NetworkCorrectionTolerance and no correction was sent in the last NetworkMinTimeBetweenClientAdjustments seconds, a good move ack
+	 * if they are within tolerance. A move out of tolerance inside that window is not acked, the next correction covers it.
+	 */
+	virtual void ServerMoveHandleClientError(const FPhysicNetworkMoveData& Move, const FVector& ServerLocation, const FVector& ServerVelocity, float CurrentTime);
+
+	/**
+	 * On the server, send the pending response to the owning client if one is due.
+	 * Corrections go out immediately, coalesced good move acks only once ServerGoodMoveAckInterval has elapsed since the last response.
+	 */
+	virtual void SendClientAdjustment();
+
+	/** Take the pending response out if it is due at CurrentTime, see SendClientAdjustment(). Returns false if nothing should be sent yet. */
+	bool ServerPopClientAdjustment(float CurrentTime, FClientAdjustmentPhysic& OutAdjustment);
+
+	/** Serialize the response in PendingAdjustment and send it to the client with ClientMoveResponsePacked(). */
+	virtual void MoveResponsePacked_ServerSend(const FClientAdjustmentPhysic& PendingAdjustment);
+
+	/** Deserialize a response received from the server and pass it to ClientHandleMoveResponse(). */
+	virtual void MoveResponsePacked_ClientReceive(const FPhysicMoveResponsePackedBits& PackedBits);
+
+	/** Handle a deserialized response on the client: release acked moves or apply the correction. */
+	virtual void ClientHandleMoveResponse(const FPhysicMoveResponseDataContainer& MoveResponse);
+
+	/** Release every saved move up to and including the one at TimeStamp, which the server acked as good. */
+	virtual void ClientAckGoodMove(float TimeStamp);
+
+	/** Unreliable response from the server about moves it processed: either a range ack or a correction. */
+	UFUNCTION(Client, Unreliable)
+	void ClientMoveResponsePacked(const FPhysicMoveResponsePackedBits& PackedBits);
+
 	/**
 	* On the client, calls the ServerMovePacked_ClientSend() function with packed movement data.
 	* First the FCharacterNetworkMoveDataContainer from GetNetworkMoveDataContainer() is updated with ClientFillNetworkMoveData(), then serialized into a data stream to send client player moves to the server.
@@ -132,7 +231,155 @@ public:
 	/** Determine minimum delay between sending client updates to the server. If updates occur more frequently this than this time, moves may be combined delayed. */
 	virtual float GetClientNetSendDeltaTime(const FNetworkPredictionData_Client_Physics* ClientData, const FSavedPhysicsMovePtr& NewMove) const;
 
+	/**
+	 * Handle a correction from the server for the move at Adjustment.TimeStamp.
+	 * If the corrected state matches what we recorded for that move within tolerance the correction is treated as an ack and nothing is replayed.
+	 * Otherwise the updated primitive is snapped to the corrected state and the moves after the corrected one are flagged for replay.
+	 */
+	virtual void ClientAdjustPosition(const FClientAdjustmentPhysic& Adjustment);
+
+	/** Saved move bookkeeping of a correction, without touching UpdatedPrimitive: ack the corrected move and tell whether the moves after it need a replay. */
+	EPhysicsCorrectionResult ClientAckCorrection(const FClientAdjustmentPhysic& Adjustment);
+
+	/**
+	 * Replay every saved move but the newest from InOutLocation and InOutVelocity, oldest to newest, with StepMove advancing them by one move.
+	 * Replayed moves get their new state saved. Returns the index of the move the replay converged back onto, after which the remaining moves
+	 * are known to end on their saved states, or INDEX_NONE if it did not converge and the newest move still has to be replayed.
+	 */
+	int32 ClientReplayIntermediateMoves(FVector& InOutLocation, FVector& InOutVelocity, TFunctionRef<void(FSavedMove_Physics& Move, FVector& InOutLocation, FVector& InOutVelocity)> StepMove);
+
+	/**
+	 * Replay the moves that are still unacknowledged after a correction, oldest to newest.
+	 * Intermediate moves only run PerformMovementSweepOnly(); the newest move runs a full PerformMovement() so overlaps and physics are updated once.
+	 * Stops early if a replayed move ends up back on its recorded state, since the moves after it would replay to their recorded states as well.
+	 */
+	virtual void ClientUpdatePosition();
+
+	/** Returns true if the corrected state is within NetworkReplaySkipLocationTolerance / NetworkReplaySkipVelocityTolerance of the state recorded for SavedMove. */
+	virtual bool IsWithinReplayTolerance(const FSavedMove_Physics& SavedMove, const FVector& Location, const FVector& InVelocity) const;
+
+	/** Integrate Velocity from Acceleration over DeltaTime and sweep the updated primitive to its new location. */
+	virtual void PerformMovement(float DeltaTime);
+
+	/**
+	 * Lightweight version of PerformMovement() used for intermediate replay steps.
+	 * Runs a single sweep query from InOutLocation without moving the component, so no transform propagation, overlap or physics state updates happen.
+	 */
+	virtual void PerformMovementSweepOnly(float DeltaTime, FVector& InOutLocation);
+
+	/**
+	 * Set the visual-only component that hides corrections. It should be attached below UpdatedPrimitive and have no collision of its own:
+	 * the collision body always snaps to the corrected state, only this component is offset back towards where it was and eased in.
+	 * Corrections are not smoothed until one is set.
+	 */
+	UFUNCTION(BlueprintCallable, Category="Physics Movement (Networking)")
+	void SetSmoothedComponent(USceneComponent* NewSmoothedComponent);
+
+	/**
+	 * Called once a correction and its replay are done. OldLocation is where the client predicted it was before the correction, NewLocation where it is now.
+	 * The difference is added to MeshTranslationOffset, unless it is above NetworkNoSmoothUpdateDistance in which case we teleport.
+	 */
+	virtual void SmoothCorrection(const FVector& OldLocation, const FVector& NewLocation);
+
+	/** Decay MeshTranslationOffset according to NetworkSmoothingMode and apply it to SmoothedComponent. */
+	virtual void SmoothClientPosition(float DeltaTime);
+
 	static uint32 PackYawAndPitchTo32(const float Yaw, const float Pitch);
+
+	/** Current velocity of the updated primitive. */
+	UPROPERTY(Transient)
+	FVector Velocity;
+
+	/** Current acceleration, restored from each saved move when replaying. */
+	UPROPERTY(Transient)
+	FVector Acceleration;
+
+	/** Maximum speed used to clamp Velocity in PerformMovement(). */
+	UPROPERTY(Category="Physics Movement", EditAnywhere, BlueprintReadWrite, meta=(ClampMin="0", UIMin="0"))
+	float MaxSpeed;
+
+	/**
+	 * Minimum time between two good move acks sent to the client. Accepted moves in between are released by one "acked up to" response.
+	 * Zero acks every server frame that accepted a move. Corrections are never delayed.
+	 */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float ServerGoodMoveAckInterval;
+
+	/**
+	 * Minimum time between client TimeStamp resets. TimeStamps are floats and lose accuracy as they grow, so the client starts them
+	 * over at this interval. Has to be large enough that a client stalling or timing out does not look like a reset to the server.
+	 */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float MinTimeBetweenTimeStampResets;
+
+	/** Server corrects the client when its location after a move is further than this from the location the client reported. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkCorrectionTolerance;
+
+	/** Minimum time between two corrections. Moves out of tolerance in between are not acked, the next correction catches them up. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkMinTimeBetweenClientAdjustments;
+
+	/**
+	 * Unacknowledged moves repeated in every move packet, delta encoded against each other. The server simulates the ones it has not
+	 * processed yet, so a lost packet no longer merges its moves into the next one and causes a correction.
+	 */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0", ClampMax="7", UIMax="7"))
+	int32 NetworkRedundantMoveCount;
+
+	/** Corrections whose location is within this distance of the location recorded for the move are acked instead of replayed. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkReplaySkipLocationTolerance;
+
+	/** Corrections whose velocity is within this distance of the velocity recorded for the move are acked instead of replayed. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkReplaySkipVelocityTolerance;
+
+	/** Smoothing mode of SmoothedComponent after a correction. Modes other than Exponential and Linear disable smoothing. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditAnywhere, BlueprintReadOnly)
+	TEnumAsByte<ENetworkSmoothingMode> NetworkSmoothingMode;
+
+	/** How long to take to smoothly interpolate from the old visual position to the corrected one, in Exponential mode. Linear mode uses the time between corrections instead. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkSmoothLocationTime;
+
+	/** Corrections larger than this only smooth this much of the distance, the rest is visible as a snap. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkMaxSmoothUpdateDistance;
+
+	/** Corrections larger than this are teleports: the visual offset is dropped instead of smoothed. */
+	UPROPERTY(Category="Physics Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0", UIMin="0"))
+	float NetworkNoSmoothUpdateDistance;
+
+protected:
+
+	/** Primitive moved by this component. Defaults to the owner's root component. */
+	UPROPERTY(Transient)
+	UPrimitiveComponent* UpdatedPrimitive;
+
+	/** Visual-only component offset by network smoothing. Defaults to the first component attached to UpdatedPrimitive. */
+	UPROPERTY(Transient)
+	USceneComponent* SmoothedComponent;
+
+	/** Relative location of SmoothedComponent without any smoothing offset. */
+	FVector SmoothedComponentBaseLocation;
+
+	mutable FNetworkPredictionData_Client_Physics* ClientPredictionData;
+	mutable FNetworkPredictionData_Server_Physics* ServerPredictionData;
+
+	/** Move container, reused for every move packet sent or received. */
+	FPhysicNetworkMoveDataContainer MoveDataContainer;
+
+	/** Reused to avoid allocating for every move packet. */
+	FNetBitWriter MoveBitWriter;
+	FNetBitReader MoveBitReader;
+
+	/** Response container, reused for every response sent or received. */
+	FPhysicMoveResponseDataContainer MoveResponseDataContainer;
+
+	/** Reused to avoid allocating for every response. */
+	FNetBitWriter MoveResponseBitWriter;
+	FNetBitReader MoveResponseBitReader;
 };
 
 FORCEINLINE uint32 UPhysicsMovementComponent::PackYawAndPitchTo32(const float Yaw, const float Pitch)
@@ -167,7 +414,7 @@ class ENGINE_API FNetworkPredictionData_Client_Physics : public FNetworkPredicti
 {
 public:
 
-	FNetworkPredictionData_Client_Physics();
+	FNetworkPredictionData_Client_Physics(const UPhysicsMovementComponent& ClientMovement);
 	virtual ~FNetworkPredictionData_Client_Physics();
 
 	/** Client timestamp of last time it sent a servermove() to the server. This is an increasing timestamp from the owning UWorld. Used for holding off on sending movement updates to save bandwidth. */
@@ -224,14 +471,14 @@ public:
 	double SmoothingClientTimeStamp;
 
 	/**
-	 * Copied value from UCharacterMovementComponent::NetworkMaxSmoothUpdateDistance.
-	 * @see UCharacterMovementComponent::NetworkMaxSmoothUpdateDistance
+	 * Copied value from UPhysicsMovementComponent::NetworkMaxSmoothUpdateDistance.
+	 * @see UPhysicsMovementComponent::NetworkMaxSmoothUpdateDistance
 	 */
 	float MaxSmoothNetUpdateDist;
 
 	/**
-	 * Copied value from UCharacterMovementComponent::NetworkNoSmoothUpdateDistance.
-	 * @see UCharacterMovementComponent::NetworkNoSmoothUpdateDistance
+	 * Copied value from UPhysicsMovementComponent::NetworkNoSmoothUpdateDistance.
+	 * @see UPhysicsMovementComponent::NetworkNoSmoothUpdateDistance
 	 */
 	float NoSmoothNetUpdateDist;
 
@@ -290,7 +537,7 @@ class ENGINE_API FNetworkPredictionData_Server_Physics : public FNetworkPredicti
 {
 public:
 
-	FNetworkPredictionData_Server_Physics(const UCharacterMovementComponent& ServerMovement);
+	FNetworkPredictionData_Server_Physics(const UPhysicsMovementComponent& ServerMovement);
 	virtual ~FNetworkPredictionData_Server_Physics();
 
 	FClientAdjustmentPhysic PendingAdjustment;
@@ -307,6 +554,9 @@ public:
 	/** Last time server updated client with a move correction */
 	float LastUpdateTime;
 
+	/** Last time server sent any response (correction or range ack) to the client. Used to coalesce good move acks. */
+	float LastResponseSendTime;
+
 	/** Server clock time when last server move was received from client (does NOT include forced moves on server) */
 	float ServerTimeStampLastServerMove;
 
@@ -10,6 +10,7 @@
 class UPackageMap;
 class FSavedMove_Physics;
 class UPhysicsMovementComponent;
+struct FClientAdjustmentPhysic;
 
 // Number of bits to reserve in serialization container. Make this large enough to try to avoid re-allocation during the worst case RPC calls (dual move + unacknowledged "old important" move).
 #ifndef PHYSICS_SERIALIZATION_PACKEDBITS_RESERVED_SIZE
@@ -75,7 +76,8 @@ public:
 	{
 		NewMove,
 		PendingMove,
-		OldMove
+		OldMove,
+		RedundantMove
 	};
 
 	FPhysicNetworkMoveData()
@@ -83,6 +85,7 @@ public:
 		, TimeStamp(0.f)
 		, Acceleration(ForceInitToZero)
 		, Location(ForceInitToZero)
+		, Velocity(ForceInitToZero)
 		, ControlRotation(ForceInitToZero)
 		, CompressedMoveFlags(0)
 		, MovementBase(nullptr)
@@ -108,6 +111,21 @@ public:
 	 */
 	virtual bool Serialize(UPhysicsMovementComponent& PhysicsMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType);
 
+	/**
+	 * Serialize a redundant copy of an older unacknowledged move as a delta from NewerMove, the move sent right after it.
+	 * The time stamp goes as the difference in tenths of a millisecond, unchanged acceleration, control rotation and flags take one bit each.
+	 * Location and velocity are not sent: redundant moves are only re-simulated, never checked.
+	 * @see FPhysicNetworkMoveDataContainer::ClientFillRedundantMoves
+	 */
+	virtual bool SerializeRedundant(UPhysicsMovementComponent& PhysicsMovement, FArchive& Ar, UPackageMap* PackageMap, const FPhysicNetworkMoveData& NewerMove);
+
+	/**
+	 * On the server, copy the location and velocity reported in this move into the adjustment so a correction for it can be sent relative to them.
+	 * Only world space locations of the new move can be used as a reference.
+	 * @see FPhysicMoveResponseDataContainer::Serialize
+	 */
+	void ServerFillClientReference(FClientAdjustmentPhysic& Adjustment) const;
+
 	// Indicates whether this was the latest new move, a pending/dual move, or old important move.
 	ENetworkMoveType NetworkMoveType;
 
@@ -117,6 +135,7 @@ public:
 	float TimeStamp;
 	FVector_NetQuantize10 Acceleration;
 	FVector_NetQuantize100 Location;		// Either world location or relative to MovementBase if that is set.
+	FVector_NetQuantize10 Velocity;			// Only sent for the new move, used as the reference for corrections.
 	FRotator ControlRotation;
 	uint8 CompressedMoveFlags;
 
@@ -162,8 +181,15 @@ public:
 	 */
 	virtual void ClientFillNetworkMoveData(const FSavedMove_Physics* ClientNewMove, const FSavedMove_Physics* ClientPendingMove, const FSavedMove_Physics* ClientOldMove);
 
+	/**
+	 * Fill the redundancy window: up to MaxMoves of the unacknowledged SavedMoves sent right before ClientNewMove, newest first.
+	 * A packet then also carries moves whose own packet was lost, and the server can simulate them instead of merging them into the new move.
+	 */
+	virtual void ClientFillRedundantMoves(const TArray<TSharedPtr<FSavedMove_Physics>>& SavedMoves, const FSavedMove_Physics* ClientNewMove, int32 MaxMoves);
+
 	/**
 	 * Serialize movement data. Passes Serialize calls to each FPhysicNetworkMoveData as applicable, based on bHasPendingMove and bHasOldMove.
+	 * Redundant moves follow, each delta encoded against the move after it.
 	 */
 	virtual bool Serialize(UPhysicsMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap);
 
@@ -174,6 +200,13 @@ public:
 	FORCEINLINE FPhysicNetworkMoveData* GetPendingMoveData() const	{ return PendingMoveData; }
 	FORCEINLINE FPhysicNetworkMoveData* GetOldMoveData() const		{ return OldMoveData; }
 
+	/** Redundant move at Index, 0 being the newest (sent right before the new move). */
+	FORCEINLINE const FPhysicNetworkMoveData& GetRedundantMoveData(int32 Index) const	{ return RedundantMoveData[Index]; }
+	FORCEINLINE int32 GetNumRedundantMoves() const	{ return NumRedundantMoves; }
+
+	/** Upper bound of the redundancy window, the count is sent in 3 bits. */
+	static constexpr int32 MaxRedundantMoves = 7;
+
 	//------------------------------------------------------------------------
 	// Optional pending data used in "dual moves".
 	bool bHasPendingMove;
@@ -191,6 +224,10 @@ protected:
 	FPhysicNetworkMoveData* PendingMoveData;	// Only valid if bHasPendingMove is true
 	FPhysicNetworkMoveData* OldMoveData;		// Only valid if bHasOldMove is true
 
+	int32 NumRedundantMoves = 0;
+
+	FPhysicNetworkMoveData RedundantMoveData[MaxRedundantMoves];
+
 private:
 
 	FPhysicNetworkMoveData BaseDefaultMoveData[3];
@@ -235,8 +272,11 @@ public:
 		, NewRot(ForceInitToZero)
 		, NewBase(nullptr)
 		, NewBaseBoneName(NAME_None)
+		, ClientLoc(ForceInitToZero)
+		, ClientVel(ForceInitToZero)
 		, bAckGoodMove(false)
 		, bBaseRelativePosition(false)
+		, bHasClientReference(false)
 		, MovementMode(0)
 	{
 	}
@@ -248,8 +288,14 @@ public:
 	FRotator NewRot;
 	UPrimitiveComponent* NewBase;
 	FName NewBaseBoneName;
+
+	// Location and velocity the client reported for this move, as quantized on the wire. Server side only, never serialized.
+	FVector ClientLoc;
+	FVector ClientVel;
+
 	bool bAckGoodMove;
 	bool bBaseRelativePosition;
+	bool bHasClientReference;	// True if ClientLoc and ClientVel are valid and corrections may be sent relative to them.
 	uint8 MovementMode;
 };
 
@@ -282,9 +328,21 @@ public:
 
 	/**
 	 * Serialize the FClientAdjustmentPhysic data and other internal flags.
+	 * TimeStamp is sent as QuantizeTimeStamp() and resolved against the client's saved moves when loading.
+	 * NewLoc and NewVel are sent as quantized deltas from the client reported state when the server has one and the error is small, otherwise as absolute values.
+	 * NewBaseBoneName is sent as a bone index when the base is a skinned mesh.
 	 */
 	virtual bool Serialize(UPhysicsMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap);
 
+	/** Timestamps are sent as the low 16 bits of their value in tenths of a millisecond. Saved moves on the client span far less than that window, so they resolve uniquely. */
+	static uint16 QuantizeTimeStamp(float TimeStamp);
+
+	/** Round a location the way FVector_NetQuantize100 does, so the client can rebuild the reference the server received. */
+	static FVector QuantizeReportedLocation(const FVector& Location);
+
+	/** Round a velocity the way FVector_NetQuantize10 does, so the client can rebuild the reference the server received. */
+	static FVector QuantizeReportedVelocity(const FVector& Velocity);
+
 	bool IsGoodMove() const		{ return ClientAdjustment.bAckGoodMove;}
 	bool IsCorrection() const	{ return !IsGoodMove(); }
 
@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsNetBitProfiler.h"
+
+#if PHYSICS_NET_BIT_PROFILER
+
+#include "Engine/NetConnection.h"
+#include "Engine/PackageMapClient.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/CoreNet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsNetBits, Log, All);
+
+static TAutoConsoleVariable<int32> CVarPhysicsNetBitsEnable(
+	TEXT("PhysicsNetBits.Enable"),
+	0,
+	TEXT("Attribute the bits of the physics replication serializers to their fields. See PhysicsNetBits.Dump and PhysicsNetBits.Csv."),
+	ECVF_Default);
+
+FPhysicsNetBitProfiler& FPhysicsNetBitProfiler::Get()
+{
+	static FPhysicsNetBitProfiler Profiler;
+	return Profiler;
+}
+
+bool FPhysicsNetBitProfiler::IsEnabled()
+{
+	return CVarPhysicsNetBitsEnable.GetValueOnAnyThread() != 0;
+}
+
+void FPhysicsNetBitProfiler::Record(const FPhysicsNetBitKey& Key, int64 NumBits)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (StartTime < 0)
+	{
+		StartTime = Now;
+	}
+
+	const int64 Second = (int64)(Now - StartTime);
+	if (Second != CurrentSecond.Second)
+	{
+		FlushSecond();
+		CurrentSecond.Second = Second;
+	}
+
+	FPhysicsNetBitStats& SecondStats = CurrentSecond.Stats.FindOrAdd(Key);
+	SecondStats.NumBits += NumBits;
+	SecondStats.Count++;
+
+	FPhysicsNetBitStats& TotalStats = Totals.FindOrAdd(Key);
+	TotalStats.NumBits += NumBits;
+	TotalStats.Count++;
+}
+
+void FPhysicsNetBitProfiler::FlushSecond()
+{
+	if (CurrentSecond.Stats.Num() == 0)
+	{
+		return;
+	}
+
+	if (History.Num() >= MaxHistorySeconds)
+	{
+		History.RemoveAt(0);
+	}
+
+	History.Add(MoveTemp(CurrentSecond));
+	CurrentSecond = FSecondStats();
+}
+
+void FPhysicsNetBitProfiler::Dump() const
+{
+	TArray<TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>> Sorted;
+	for (const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& Pair : Totals)
+	{
+		Sorted.Add(Pair);
+	}
+
+	Sorted.Sort([](const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& A, const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& B)
+	{
+		return A.Value.NumBits > B.Value.NumBits;
+	});
+
+	int64 TotalBits = 0;
+	for (const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& Pair : Sorted)
+	{
+		TotalBits += Pair.Value.NumBits;
+	}
+
+	const double Duration = StartTime >= 0 ? FMath::Max(FPlatformTime::Seconds() - StartTime, 1.0) : 1.0;
+
+	UE_LOG(LogPhysicsNetBits, Log, TEXT("%lld bits over %.1fs"), TotalBits, Duration);
+	UE_LOG(LogPhysicsNetBits, Log, TEXT("%-24s %-4s %-40s %12s %8s %8s %8s %6s"), TEXT("Connection"), TEXT("Dir"), TEXT("Field"), TEXT("Bits"), TEXT("Count"), TEXT("Avg"), TEXT("Bits/s"), TEXT("%"));
+
+	for (const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& Pair : Sorted)
+	{
+		const FPhysicsNetBitKey& Key = Pair.Key;
+		const FPhysicsNetBitStats& Stats = Pair.Value;
+
+		UE_LOG(LogPhysicsNetBits, Log, TEXT("%-24s %-4s %-40s %12lld %8d %8.1f %8.0f %5.1f%%"),
+			*Key.Connection.ToString(), Key.bSending ? TEXT("Out") : TEXT("In"), *FString::Printf(TEXT("%s.%s"), *Key.Message.ToString(), *Key.Field.ToString()),
+			Stats.NumBits, Stats.Count, (double)Stats.NumBits / FMath::Max(Stats.Count, 1), Stats.NumBits / Duration, TotalBits > 0 ? 100.0 * Stats.NumBits / TotalBits : 0.0);
+	}
+}
+
+bool FPhysicsNetBitProfiler::WriteCsv(const FString& Filename)
+{
+	FlushSecond();
+
+	FString Csv = TEXT("Second,Connection,Direction,Message,Field,Bits,Count\n");
+	for (const FSecondStats& Second : History)
+	{
+		for (const TPair<FPhysicsNetBitKey, FPhysicsNetBitStats>& Pair : Second.Stats)
+		{
+			Csv += FString::Printf(TEXT("%lld,%s,%s,%s,%s,%lld,%d\n"), Second.Second, *Pair.Key.Connection.ToString(), Pair.Key.bSending ? TEXT("Out") : TEXT("In"),
+				*Pair.Key.Message.ToString(), *Pair.Key.Field.ToString(), Pair.Value.NumBits, Pair.Value.Count);
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *Filename))
+	{
+		UE_LOG(LogPhysicsNetBits, Error, TEXT("Failed to write %s"), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogPhysicsNetBits, Log, TEXT("Wrote %d seconds of bit costs to %s"), History.Num(), *Filename);
+	return true;
+}
+
+void FPhysicsNetBitProfiler::Reset()
+{
+	Totals.Reset();
+	History.Reset();
+	CurrentSecond = FSecondStats();
+	StartTime = -1;
+}
+
+FPhysicsNetBitCounter::FPhysicsNetBitCounter(FArchive& Ar, UPackageMap* PackageMap, FName InMessage)
+{
+	if (!FPhysicsNetBitProfiler::IsEnabled() || FPhysicsNetBitSuppressScope::IsSuppressed() || !Ar.IsNetArchive())
+	{
+		return;
+	}
+
+	const UPackageMapClient* PackageMapClient = Cast<UPackageMapClient>(PackageMap);
+	const UNetConnection* Connection = PackageMapClient ? PackageMapClient->GetConnection() : nullptr;
+
+	// Serialization for a connection, property replication, RPC parameters and our packed RPCs, always goes through FNetBitWriter
+	// and FNetBitReader. Any other archive is of unknown type and has no bit position we could read.
+	if (Connection == nullptr)
+	{
+		return;
+	}
+
+	if (Ar.IsSaving())
+	{
+		Writer = static_cast<const FNetBitWriter*>(&Ar);
+	}
+	else
+	{
+		Reader = static_cast<const FNetBitReader*>(&Ar);
+	}
+
+	bActive = true;
+
+	Key.Connection = FName(*Connection->LowLevelGetRemoteAddress(true));
+	Key.Message = InMessage;
+	Key.bSending = Ar.IsSaving();
+
+	LastBitPosition = GetBitPosition();
+}
+
+void FPhysicsNetBitCounter::Mark(FName Field)
+{
+	if (!bActive)
+	{
+		return;
+	}
+
+	const int64 BitPosition = GetBitPosition();
+
+	Key.Field = Field;
+	FPhysicsNetBitProfiler::Get().Record(Key, BitPosition - LastBitPosition);
+
+	LastBitPosition = BitPosition;
+}
+
+void FPhysicsNetBitCounter::Skip()
+{
+	if (bActive)
+	{
+		LastBitPosition = GetBitPosition();
+	}
+}
+
+int64 FPhysicsNetBitCounter::GetBitPosition() const
+{
+	return Writer ? Writer->GetNumBits() : Reader->GetPosBits();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsNetBitSuppressScope
+
+static thread_local int32 GPhysicsNetBitSuppressDepth = 0;
+
+FPhysicsNetBitSuppressScope::FPhysicsNetBitSuppressScope()
+{
+	GPhysicsNetBitSuppressDepth++;
+}
+
+FPhysicsNetBitSuppressScope::~FPhysicsNetBitSuppressScope()
+{
+	GPhysicsNetBitSuppressDepth--;
+}
+
+bool FPhysicsNetBitSuppressScope::IsSuppressed()
+{
+	return GPhysicsNetBitSuppressDepth > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Console commands
+
+static FAutoConsoleCommand CmdPhysicsNetBitsDump(
+	TEXT("PhysicsNetBits.Dump"),
+	TEXT("Log the bits spent per connection and field since the profiler was enabled or reset."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FPhysicsNetBitProfiler::Get().Dump();
+	}));
+
+static FAutoConsoleCommand CmdPhysicsNetBitsCsv(
+	TEXT("PhysicsNetBits.Csv"),
+	TEXT("Write the bits spent per second, connection and field. Usage: PhysicsNetBits.Csv [Filename]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Filename = Args.Num() > 0 ? Args[0] : FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("PhysicsNetBits-%s.csv"), *FDateTime::Now().ToString());
+		FPhysicsNetBitProfiler::Get().WriteCsv(Filename);
+	}));
+
+static FAutoConsoleCommand CmdPhysicsNetBitsReset(
+	TEXT("PhysicsNetBits.Reset"),
+	TEXT("Clear the bit costs recorded so far."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FPhysicsNetBitProfiler::Get().Reset();
+	}));
+
+#endif // PHYSICS_NET_BIT_PROFILER
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPackageMap;
+struct FBitReader;
+struct FBitWriter;
+
+/**
+ * Per field bit cost of the project's NetSerialize paths.
+ *
+ * A serializer declares a counter on its archive with PHYSICS_NET_BIT_COUNTER and marks each field after serializing it with
+ * PHYSICS_NET_BIT_FIELD. The bits the archive advanced since the previous mark are attributed to that field, for the connection
+ * of the package map, sent or received. Totals are kept for the whole session and per second.
+ *
+ * Compiled out unless PHYSICS_NET_BIT_PROFILER is set (default: non shipping builds), and a single branch until enabled with
+ * PhysicsNetBits.Enable 1. See PhysicsNetBits.Dump and PhysicsNetBits.Csv.
+ */
+
+#ifndef PHYSICS_NET_BIT_PROFILER
+#define PHYSICS_NET_BIT_PROFILER !UE_BUILD_SHIPPING
+#endif
+
+#if PHYSICS_NET_BIT_PROFILER
+
+struct FPhysicsNetBitKey
+{
+	FName				Connection;
+	FName				Message;
+	FName				Field;
+	bool				bSending { true };
+
+	friend bool operator==(const FPhysicsNetBitKey& A, const FPhysicsNetBitKey& B)
+	{
+		return A.Connection == B.Connection && A.Message == B.Message && A.Field == B.Field && A.bSending == B.bSending;
+	}
+
+	friend uint32 GetTypeHash(const FPhysicsNetBitKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.Connection), GetTypeHash(Key.Message)), HashCombine(GetTypeHash(Key.Field), (uint32)Key.bSending));
+	}
+};
+
+struct FPhysicsNetBitStats
+{
+	int64				NumBits { 0 };
+	int32				Count { 0 };
+};
+
+class PHYSICSREPLICATION_API FPhysicsNetBitProfiler
+{
+public:
+
+	static FPhysicsNetBitProfiler& Get();
+
+	/** PhysicsNetBits.Enable */
+	static bool			IsEnabled();
+
+	void				Record(const FPhysicsNetBitKey& Key, int64 NumBits);
+
+	/** Log session totals, most expensive fields first. */
+	void				Dump() const;
+
+	/** Write one row per second, connection, direction and field. */
+	bool				WriteCsv(const FString& Filename);
+
+	void				Reset();
+
+	/** Seconds of per second history kept for the CSV. */
+	int32				MaxHistorySeconds { 3600 };
+
+private:
+
+	void				FlushSecond();
+
+	struct FSecondStats
+	{
+		int64			Second { 0 };
+		TMap<FPhysicsNetBitKey, FPhysicsNetBitStats>	Stats;
+	};
+
+	TMap<FPhysicsNetBitKey, FPhysicsNetBitStats>	Totals;
+
+	FSecondStats		CurrentSecond;
+
+	TArray<FSecondStats>	History;
+
+	double				StartTime { -1 };
+};
+
+/**
+ * Attributes the bits serialized on Ar to fields of Message. Inactive unless the profiler is enabled and Ar belongs to a net connection,
+ * the only archives known to be bit archives. Local serialization (size estimates, emulation) is never recorded.
+ */
+class PHYSICSREPLICATION_API FPhysicsNetBitCounter
+{
+public:
+
+	FPhysicsNetBitCounter(FArchive& InAr, UPackageMap* PackageMap, FName InMessage);
+
+	/** Everything serialized since the previous mark (or the counter) was Field. */
+	void				Mark(FName Field);
+
+	/** Skip what was serialized since the previous mark, e.g. a nested message that has its own counter. */
+	void				Skip();
+
+private:
+
+	int64				GetBitPosition() const;
+
+	const FBitWriter*	Writer { nullptr };
+
+	const FBitReader*	Reader { nullptr };
+
+	FPhysicsNetBitKey	Key;
+
+	int64				LastBitPosition { 0 };
+
+	bool				bActive { false };
+};
+
+/** Counters are inactive while one of these is in scope on the thread, for serialization that is not sent as is. */
+class PHYSICSREPLICATION_API FPhysicsNetBitSuppressScope
+{
+public:
+
+	FPhysicsNetBitSuppressScope();
+	~FPhysicsNetBitSuppressScope();
+
+	static bool			IsSuppressed();
+};
+
+#define PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, Message) \
+	static const FName PhysicsNetBitMessageName(TEXT(Message)); \
+	FPhysicsNetBitCounter PhysicsNetBitCounter(Ar, PackageMap, PhysicsNetBitMessageName)
+
+#define PHYSICS_NET_BIT_FIELD(Field) \
+	{ static const FName PhysicsNetBitFieldName(TEXT(Field)); PhysicsNetBitCounter.Mark(PhysicsNetBitFieldName); }
+
+#define PHYSICS_NET_BIT_SKIP() \
+	PhysicsNetBitCounter.Skip()
+
+#define PHYSICS_NET_BIT_SUPPRESS() \
+	FPhysicsNetBitSuppressScope PhysicsNetBitSuppressScope
+
+#else
+
+#define PHYSICS_NET_BIT_COUNTER(Ar, PackageMap, Message)
+#define PHYSICS_NET_BIT_FIELD(Field)
+#define PHYSICS_NET_BIT_SKIP()
+#define PHYSICS_NET_BIT_SUPPRESS()
+
+#endif
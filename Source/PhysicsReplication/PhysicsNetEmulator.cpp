@@ -0,0 +1,493 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsNetEmulator.h"
+#include "PhysicsClockSyncComponent.h"
+
+#include "UObject/StrongObjectPtr.h"
+
+namespace PhysicsNetEmulator
+{
+	// Chance per processed move that the server applies an external push the client does not know about.
+	static const float ServerPushChance = 0.01f;
+
+	/** Run ServerTick and ClientTick at their own rates, in time order, until Duration. */
+	template<typename ServerTickType, typename ClientTickType>
+	void RunTimeline(float Duration, float ServerDeltaTime, float ClientDeltaTime, ServerTickType&& ServerTick, ClientTickType&& ClientTick)
+	{
+		double NextServerTime = 0;
+		double NextClientTime = 0;
+
+		while (FMath::Min(NextServerTime, NextClientTime) < Duration)
+		{
+			if (NextServerTime <= NextClientTime)
+			{
+				ServerTick(NextServerTime);
+				NextServerTime += ServerDeltaTime;
+			}
+			else
+			{
+				ClientTick(NextClientTime);
+				NextClientTime += ClientDeltaTime;
+			}
+		}
+	}
+
+	static void ResetWriter(FNetBitWriter& Writer)
+	{
+		FBitWriterMark Mark;
+		Mark.Pop(Writer);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsNetEmulatedLink
+
+FPhysicsNetEmulatedLink::FPhysicsNetEmulatedLink(const FPhysicsNetEmulatorSettings& InSettings, int32 InSeed)
+	: Settings(InSettings)
+	, Random(InSeed)
+{
+}
+
+void FPhysicsNetEmulatedLink::Send(double Now, const FNetBitWriter& Writer)
+{
+	NumSent++;
+	NumBitsSent += Writer.GetNumBits();
+
+	const uint32 Sequence = NextSequence++;
+
+	if (Random.FRand() * 100.f < Settings.LossPct)
+	{
+		NumLost++;
+		return;
+	}
+
+	double Delay = (Settings.LatencyMs + Random.FRandRange(-Settings.JitterMs, Settings.JitterMs)) / 1000.0;
+
+	if (Random.FRand() * 100.f < Settings.ReorderPct)
+	{
+		NumReordered++;
+		Delay += Settings.ReorderDelayMs / 1000.0;
+	}
+
+	Enqueue(Now + FMath::Max(Delay, 0.0), Sequence, Writer);
+
+	if (Random.FRand() * 100.f < Settings.DuplicatePct)
+	{
+		NumDuplicated++;
+		Enqueue(Now + FMath::Max(Delay, 0.0) + Random.FRandRange(0.f, Settings.JitterMs) / 1000.0, Sequence, Writer);
+	}
+}
+
+bool FPhysicsNetEmulatedLink::Receive(double Now, FPhysicsNetEmulatedPacket& OutPacket)
+{
+	for (;;)
+	{
+		int32 NextIndex = INDEX_NONE;
+		for (int32 Index = 0; Index < InFlight.Num(); Index++)
+		{
+			const FPhysicsNetEmulatedPacket& Packet = InFlight[Index];
+			if (Packet.DeliveryTime <= Now && (NextIndex == INDEX_NONE || Packet.DeliveryTime < InFlight[NextIndex].DeliveryTime))
+			{
+				NextIndex = Index;
+			}
+		}
+
+		if (NextIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		OutPacket = MoveTemp(InFlight[NextIndex]);
+		InFlight.RemoveAtSwap(NextIndex, 1, false);
+
+		if (Settings.bDropOutOfOrder && bHasDelivered && OutPacket.Sequence <= LastDeliveredSequence)
+		{
+			NumDroppedOutOfOrder++;
+			continue;
+		}
+
+		LastDeliveredSequence = bHasDelivered ? FMath::Max(LastDeliveredSequence, OutPacket.Sequence) : OutPacket.Sequence;
+		bHasDelivered = true;
+		NumDelivered++;
+		return true;
+	}
+}
+
+void FPhysicsNetEmulatedLink::Enqueue(double DeliveryTime, uint32 Sequence, const FNetBitWriter& Writer)
+{
+	FPhysicsNetEmulatedPacket& Packet = InFlight.AddDefaulted_GetRef();
+	Packet.DeliveryTime = DeliveryTime;
+	Packet.Sequence = Sequence;
+	Packet.NumBits = Writer.GetNumBits();
+	Packet.Data.Append(Writer.GetData(), Writer.GetNumBytes());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsNetSampleGenerator
+
+FPhysicsNetSampleGenerator::FPhysicsNetSampleGenerator(int32 InSeed)
+	: Random(InSeed)
+{
+	BodyLocation = FVector(Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(-2000.f, 2000.f), Random.FRandRange(50.f, 500.f));
+	BodyVelocity = Random.GetUnitVector() * Random.FRandRange(0.f, 800.f);
+	BodyRotation = FQuat::Identity;
+	BodyAngularVelocity = Random.GetUnitVector() * Random.FRandRange(0.f, PI);
+
+	MoveAcceleration = FVector::ZeroVector;
+	MoveControlRotation = FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f);
+}
+
+FPhysicsStateActor FPhysicsNetSampleGenerator::AdvanceBody(float DeltaTime)
+{
+	// Occasional kick, on average every two seconds, so the body does not come to rest.
+	if (Random.FRand() < DeltaTime * 0.5f)
+	{
+		BodyVelocity += Random.GetUnitVector() * Random.FRandRange(200.f, 1500.f);
+		BodyAngularVelocity += Random.GetUnitVector() * Random.FRandRange(0.f, 2.f * PI);
+	}
+
+	BodyVelocity.Z -= 980.f * DeltaTime;
+	BodyLocation += BodyVelocity * DeltaTime;
+
+	// Bounce on a ground plane at Z = 0.
+	if (BodyLocation.Z < 0.f)
+	{
+		BodyLocation.Z = 0.f;
+		BodyVelocity.Z = -BodyVelocity.Z * 0.5f;
+		BodyVelocity.X *= 0.9f;
+		BodyVelocity.Y *= 0.9f;
+		BodyAngularVelocity *= 0.8f;
+	}
+
+	const float AngularSpeed = BodyAngularVelocity.Size();
+	if (AngularSpeed > KINDA_SMALL_NUMBER)
+	{
+		BodyRotation = FQuat(BodyAngularVelocity / AngularSpeed, AngularSpeed * DeltaTime) * BodyRotation;
+		BodyRotation.Normalize();
+	}
+
+	FPhysicsStateActor State;
+	State.Transform = FTransform(BodyRotation, BodyLocation);
+	State.Velocity = BodyVelocity;
+	State.ServerDeltaTime = DeltaTime;
+	return State;
+}
+
+void FPhysicsNetSampleGenerator::NextMoveInput(float DeltaTime, FVector& OutAcceleration, FRotator& OutControlRotation)
+{
+	if (Random.FRand() < 0.05f)
+	{
+		MoveAcceleration = FVector::ZeroVector;
+	}
+	else
+	{
+		const FVector Change = FVector(Random.FRandRange(-1.f, 1.f), Random.FRandRange(-1.f, 1.f), 0.f) * 4000.f * DeltaTime;
+		MoveAcceleration = (MoveAcceleration + Change).GetClampedToMaxSize(2048.f);
+	}
+
+	MoveControlRotation.Yaw = FRotator::ClampAxis(MoveControlRotation.Yaw + Random.FRandRange(-90.f, 90.f) * DeltaTime);
+	MoveControlRotation.Pitch = FMath::Clamp(MoveControlRotation.Pitch + Random.FRandRange(-30.f, 30.f) * DeltaTime, -80.f, 80.f);
+
+	OutAcceleration = FVector(FMath::RoundToInt(MoveAcceleration.X * 10.f), FMath::RoundToInt(MoveAcceleration.Y * 10.f), FMath::RoundToInt(MoveAcceleration.Z * 10.f)) / 10.f;
+	OutControlRotation = MoveControlRotation;
+}
+
+void FPhysicsNetSampleGenerator::IntegrateMove(FVector& Location, FVector& Velocity, const FVector& Acceleration, float DeltaTime, float MaxSpeed)
+{
+	Velocity = (Velocity + Acceleration * DeltaTime).GetClampedToMaxSize(MaxSpeed);
+	Location += Velocity * DeltaTime;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsNetEmulatorScenario
+
+FPhysicsNetEmulatorScenario::FPhysicsNetEmulatorScenario(const FPhysicsNetEmulatorSettings& InSettings, float InDuration)
+	: Settings(InSettings)
+	, Duration(InDuration)
+{
+}
+
+FPhysicsNetStateScenarioResult FPhysicsNetEmulatorScenario::RunStateScenario(float ServerSendRate, float ClientFrameRate) const
+{
+	FPhysicsNetStateScenarioResult Result;
+
+	FRandomStream Random(Settings.Seed);
+	FPhysicsNetEmulatedLink Link(Settings, Random.RandHelper(MAX_int32));
+	FPhysicsNetSampleGenerator Generator(Random.RandHelper(MAX_int32));
+
+	const float ServerDeltaTime = 1.f / 60.f;
+	const float ClientDeltaTime = 1.f / ClientFrameRate;
+	const double SendInterval = 1.0 / ServerSendRate;
+	const double ReferenceDelay = Settings.LatencyMs / 1000.0;
+
+	// Server side, mirroring APhysicable::Tick.
+	FPhysicsStateActor PhysicsState;
+	FVector LastVelocity = FVector::ZeroVector;
+	double LastSendTime = -SendInterval;
+	TArray<TPair<double, FVector>> ServerHistory;
+
+	// Client side, mirroring APhysicable::SimulatedProxy_PhysicsState and ClientTick.
+	FPhysicableInterpolator Interpolator;
+	FTransform DisplayTransform = FTransform::Identity;
+	bool bHasState = false;
+	double ErrorSum = 0;
+
+	FNetBitWriter Writer(nullptr, 0);
+	Writer.SetAllowResize(true);
+
+	PhysicsNetEmulator::RunTimeline(Duration, ServerDeltaTime, ClientDeltaTime,
+		[&](double Now)
+		{
+			const FPhysicsStateActor BodyState = Generator.AdvanceBody(ServerDeltaTime);
+			ServerHistory.Emplace(Now, BodyState.Transform.GetLocation());
+
+			const FVector VelocityDifference = LastVelocity - BodyState.Velocity;
+			LastVelocity = BodyState.Velocity;
+
+			PhysicsState.Transform = BodyState.Transform;
+			PhysicsState.Velocity = VelocityDifference;
+			PhysicsState.ServerDeltaTime = ServerDeltaTime;
+			PhysicsState.ServerTimeStamp = float(Now);
+
+			if (Now - LastSendTime >= SendInterval)
+			{
+				LastSendTime = Now;
+
+				PhysicsNetEmulator::ResetWriter(Writer);
+				bool bSuccess = true;
+				PhysicsState.NetSerialize(Writer, nullptr, bSuccess);
+				Link.Send(Now, Writer);
+				Result.NumStatesSent++;
+			}
+		},
+		[&](double Now)
+		{
+			FPhysicsNetEmulatedPacket Packet;
+			while (Link.Receive(Now, Packet))
+			{
+				FNetBitReader Reader(nullptr, Packet.Data.GetData(), Packet.NumBits);
+				FPhysicsStateActor ReceivedState;
+				bool bSuccess = true;
+				ReceivedState.NetSerialize(Reader, nullptr, bSuccess);
+				if (!bSuccess || Reader.IsError())
+				{
+					continue;
+				}
+
+				// The timeline is shared, so the client knows the server time exactly.
+				ReceivedState.ServerTimeStamp = UPhysicsClockSyncComponent::UnwrapServerTime(ReceivedState.ServerTimeStamp, float(Now));
+
+				Interpolator.OnStateReceived(ReceivedState, DisplayTransform, ReceivedState.Velocity);
+				DisplayTransform = ReceivedState.Transform;
+				bHasState = true;
+				Result.NumStatesApplied++;
+			}
+
+			if (!bHasState)
+			{
+				return;
+			}
+
+			Interpolator.Tick(ClientDeltaTime, DisplayTransform);
+
+			// Newest server location the client could know about.
+			const double ReferenceTime = Now - ReferenceDelay;
+			const TPair<double, FVector>* Reference = nullptr;
+			for (int32 Index = ServerHistory.Num() - 1; Index >= 0; Index--)
+			{
+				if (ServerHistory[Index].Key <= ReferenceTime)
+				{
+					Reference = &ServerHistory[Index];
+					break;
+				}
+			}
+
+			if (Reference != nullptr)
+			{
+				const float Error = FVector::Dist(DisplayTransform.GetLocation(), Reference->Value);
+				ErrorSum += Error;
+				Result.MaxLocationError = FMath::Max(Result.MaxLocationError, Error);
+				Result.NumSamples++;
+			}
+		});
+
+	Result.AverageLocationError = Result.NumSamples > 0 ? float(ErrorSum / Result.NumSamples) : 0.f;
+	Result.AverageBitsPerState = Link.NumSent > 0 ? float(Link.NumBitsSent) / Link.NumSent : 0.f;
+	return Result;
+}
+
+FPhysicsNetMoveScenarioResult FPhysicsNetEmulatorScenario::RunMoveScenario(float ClientFrameRate, float ServerFrameRate) const
+{
+	FPhysicsNetMoveScenarioResult Result;
+
+	FRandomStream Random(Settings.Seed);
+	FPhysicsNetEmulatedLink Upstream(Settings, Random.RandHelper(MAX_int32));
+	FPhysicsNetEmulatedLink Downstream(Settings, Random.RandHelper(MAX_int32));
+	FPhysicsNetSampleGenerator Generator(Random.RandHelper(MAX_int32));
+	FRandomStream ServerRandom(Random.RandHelper(MAX_int32));
+
+	// The containers serialize through a movement component; it also owns the client prediction data the responses resolve against.
+	TStrongObjectPtr<UPhysicsMovementComponent> Movement(NewObject<UPhysicsMovementComponent>());
+	FNetworkPredictionData_Client_Physics* ClientData = Movement->GetPredictionData_Client_Physics();
+	const float MaxSpeed = Movement->MaxSpeed;
+	const int32 RedundantMoves = Settings.RedundantMoves >= 0 ? Settings.RedundantMoves : Movement->NetworkRedundantMoveCount;
+
+	const float ClientDeltaTime = 1.f / ClientFrameRate;
+	const float ServerDeltaTime = 1.f / ServerFrameRate;
+
+	FPhysicNetworkMoveDataContainer ClientMoveContainer;
+	FPhysicNetworkMoveDataContainer ServerMoveContainer;
+	FPhysicMoveResponseDataContainer ServerResponseContainer;
+	FPhysicMoveResponseDataContainer ClientResponseContainer;
+
+	FVector ClientLocation = FVector::ZeroVector;
+	FVector ClientVelocity = FVector::ZeroVector;
+
+	FVector ServerLocation = FVector::ZeroVector;
+	FVector ServerVelocity = FVector::ZeroVector;
+
+	int64 ResponseBits = 0;
+
+	FNetBitWriter Writer(nullptr, 0);
+	Writer.SetAllowResize(true);
+
+	PhysicsNetEmulator::RunTimeline(Duration, ServerDeltaTime, ClientDeltaTime,
+		[&](double Now)
+		{
+			FPhysicsNetEmulatedPacket Packet;
+			while (Upstream.Receive(Now, Packet))
+			{
+				FNetBitReader Reader(nullptr, Packet.Data.GetData(), Packet.NumBits);
+				if (!ServerMoveContainer.Serialize(*Movement, Reader, nullptr) || Reader.IsError())
+				{
+					continue;
+				}
+
+				// Same bookkeeping as UPhysicsMovementComponent::MovePacked_ServerReceive, simulated without collision.
+				const bool bNewMove = Movement->ServerProcessMoves(ServerMoveContainer, [&](const FPhysicNetworkMoveData& Move, float DeltaTime)
+				{
+					if (Move.NetworkMoveType == FPhysicNetworkMoveData::ENetworkMoveType::RedundantMove)
+					{
+						Result.NumRedundantMovesProcessed++;
+					}
+					else
+					{
+						if (ServerRandom.FRand() < PhysicsNetEmulator::ServerPushChance)
+						{
+							ServerVelocity += ServerRandom.GetUnitVector() * FVector(1.f, 1.f, 0.f) * 600.f;
+						}
+						Result.NumMovesProcessed++;
+					}
+
+					FPhysicsNetSampleGenerator::IntegrateMove(ServerLocation, ServerVelocity, Move.Acceleration, DeltaTime, MaxSpeed);
+				});
+
+				if (bNewMove)
+				{
+					Movement->ServerMoveHandleClientError(*ServerMoveContainer.GetNewMoveData(), ServerLocation, ServerVelocity, float(Now));
+				}
+			}
+
+			FClientAdjustmentPhysic Adjustment;
+			if (Movement->ServerPopClientAdjustment(float(Now), Adjustment))
+			{
+				ServerResponseContainer.ServerFillResponseData(*Movement, Adjustment);
+
+				PhysicsNetEmulator::ResetWriter(Writer);
+				ServerResponseContainer.Serialize(*Movement, Writer, nullptr);
+				Downstream.Send(Now, Writer);
+
+				ResponseBits += Writer.GetNumBits();
+				Result.NumResponses++;
+			}
+		},
+		[&](double Now)
+		{
+			FPhysicsNetEmulatedPacket Packet;
+			while (Downstream.Receive(Now, Packet))
+			{
+				FNetBitReader Reader(nullptr, Packet.Data.GetData(), Packet.NumBits);
+				if (!ClientResponseContainer.Serialize(*Movement, Reader, nullptr) || Reader.IsError())
+				{
+					continue;
+				}
+
+				const FClientAdjustmentPhysic& Adjustment = ClientResponseContainer.ClientAdjustment;
+				if (ClientResponseContainer.IsGoodMove())
+				{
+					Movement->ClientAckGoodMove(Adjustment.TimeStamp);
+					continue;
+				}
+
+				// Same bookkeeping as UPhysicsMovementComponent::ClientAdjustPosition / ClientUpdatePosition, simulated without collision.
+				const EPhysicsCorrectionResult Correction = Movement->ClientAckCorrection(Adjustment);
+				if (Correction == EPhysicsCorrectionResult::WithinTolerance)
+				{
+					Result.NumReplaysSkipped++;
+				}
+				if (Correction != EPhysicsCorrectionResult::Replay)
+				{
+					continue;
+				}
+
+				Result.NumCorrections++;
+
+				ClientLocation = Adjustment.NewLoc;
+				ClientVelocity = Adjustment.NewVel;
+				if (ClientData->SavedMoves.Num() == 0)
+				{
+					continue;
+				}
+
+				const int32 ConvergedMoveIndex = Movement->ClientReplayIntermediateMoves(ClientLocation, ClientVelocity, [&](FSavedMove_Physics& Move, FVector& InOutLocation, FVector& InOutVelocity)
+				{
+					FPhysicsNetSampleGenerator::IntegrateMove(InOutLocation, InOutVelocity, Move.Acceleration, Move.DeltaTime, MaxSpeed);
+					Result.NumMovesReplayed++;
+				});
+
+				FSavedMove_Physics& NewestMove = *ClientData->SavedMoves.Last();
+				if (ConvergedMoveIndex != INDEX_NONE)
+				{
+					ClientLocation = NewestMove.SavedLocation;
+					ClientVelocity = NewestMove.SavedVelocity;
+					continue;
+				}
+
+				FPhysicsNetSampleGenerator::IntegrateMove(ClientLocation, ClientVelocity, NewestMove.Acceleration, NewestMove.DeltaTime, MaxSpeed);
+				NewestMove.SavedLocation = ClientLocation;
+				NewestMove.SavedVelocity = ClientVelocity;
+				Result.NumMovesReplayed++;
+			}
+
+			FSavedPhysicsMovePtr NewMove = MakeShared<FSavedMove_Physics>();
+			NewMove->Clear();
+			NewMove->TimeStamp = float(Now) + ClientDeltaTime;
+			NewMove->DeltaTime = ClientDeltaTime;
+			Generator.NextMoveInput(ClientDeltaTime, NewMove->Acceleration, NewMove->SavedControlRotation);
+
+			FPhysicsNetSampleGenerator::IntegrateMove(ClientLocation, ClientVelocity, NewMove->Acceleration, ClientDeltaTime, MaxSpeed);
+			NewMove->SavedLocation = ClientLocation;
+			NewMove->SavedVelocity = ClientVelocity;
+			NewMove->ReportedLocation = ClientLocation;
+			NewMove->ReportedVelocity = ClientVelocity;
+
+			ClientData->SavedMoves.Add(NewMove);
+			if (ClientData->SavedMoves.Num() > ClientData->MaxSavedMoveCount)
+			{
+				ClientData->SavedMoves.RemoveAt(0);
+			}
+			Result.MaxSavedMoves = FMath::Max(Result.MaxSavedMoves, ClientData->SavedMoves.Num());
+
+			ClientMoveContainer.ClientFillNetworkMoveData(NewMove.Get(), nullptr, nullptr);
+			ClientMoveContainer.ClientFillRedundantMoves(ClientData->SavedMoves, NewMove.Get(), RedundantMoves);
+
+			PhysicsNetEmulator::ResetWriter(Writer);
+			ClientMoveContainer.Serialize(*Movement, Writer, nullptr);
+			Upstream.Send(Now, Writer);
+			Result.NumMovesSent++;
+		});
+
+	Result.AverageBitsPerMove = Upstream.NumSent > 0 ? float(Upstream.NumBitsSent) / Upstream.NumSent : 0.f;
+	Result.AverageBitsPerResponse = Result.NumResponses > 0 ? float(ResponseBits) / Result.NumResponses : 0.f;
+	return Result;
+}
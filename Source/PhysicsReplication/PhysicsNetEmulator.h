@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Physicable.h"
+#include "PhysicsMovementComponent.h"
+
+/**
+ * Deterministic, in-memory network emulation for the replication pipeline.
+ *
+ * The project's serializers (FPhysicsStateActor, FPhysicNetworkMoveDataContainer, FPhysicMoveResponseDataContainer) are
+ * written to bit streams, pushed through a seeded emulated link and read back on the other side, where the client
+ * interpolation and move prediction bookkeeping consume them. No net driver, world or wall clock is involved, so
+ * thousands of seeded scenarios run in seconds. See UPhysicsNetEmulatorCommandlet for the command line front end.
+ */
+
+struct PHYSICSREPLICATION_API FPhysicsNetEmulatorSettings
+{
+	int32		Seed { 0 };
+
+	/** One way latency, in milliseconds. */
+	float		LatencyMs { 50.f };
+
+	/** Uniform random variation of the latency, in milliseconds. */
+	float		JitterMs { 5.f };
+
+	/** Chance for a packet to be dropped, in percent. */
+	float		LossPct { 0.f };
+
+	/** Chance for a packet to be delivered twice, in percent. */
+	float		DuplicatePct { 0.f };
+
+	/** Chance for a packet to be held back by ReorderDelayMs so that later packets overtake it, in percent. */
+	float		ReorderPct { 0.f };
+
+	float		ReorderDelayMs { 30.f };
+
+	/** Drop packets older than the newest one received, like UNetConnection does without a packet order cache. */
+	bool		bDropOutOfOrder { true };
+
+	/** Unacknowledged moves repeated in each move packet. Negative uses UPhysicsMovementComponent::NetworkRedundantMoveCount. */
+	int32		RedundantMoves { -1 };
+};
+
+struct PHYSICSREPLICATION_API FPhysicsNetEmulatedPacket
+{
+	double			DeliveryTime { 0 };
+
+	uint32			Sequence { 0 };
+
+	int64			NumBits { 0 };
+
+	TArray<uint8>	Data;
+};
+
+/** One direction of an emulated connection. */
+class PHYSICSREPLICATION_API FPhysicsNetEmulatedLink
+{
+public:
+
+	FPhysicsNetEmulatedLink(const FPhysicsNetEmulatorSettings& InSettings, int32 InSeed);
+
+	/** Queue the content of Writer for delivery. */
+	void			Send(double Now, const FNetBitWriter& Writer);
+
+	/** Pop the next packet due at Now. Returns false when nothing else is due. */
+	bool			Receive(double Now, FPhysicsNetEmulatedPacket& OutPacket);
+
+	int32			NumSent { 0 };
+	int32			NumLost { 0 };
+	int32			NumDuplicated { 0 };
+	int32			NumReordered { 0 };
+	int32			NumDroppedOutOfOrder { 0 };
+	int32			NumDelivered { 0 };
+	int64			NumBitsSent { 0 };
+
+private:
+
+	void			Enqueue(double DeliveryTime, uint32 Sequence, const FNetBitWriter& Writer);
+
+	FPhysicsNetEmulatorSettings		Settings;
+
+	FRandomStream	Random;
+
+	uint32			NextSequence { 0 };
+
+	uint32			LastDeliveredSequence { 0 };
+
+	bool			bHasDelivered { false };
+
+	TArray<FPhysicsNetEmulatedPacket>	InFlight;
+};
+
+/** Seeded generator of plausible physicable trajectories and client moves. */
+class PHYSICSREPLICATION_API FPhysicsNetSampleGenerator
+{
+public:
+
+	explicit FPhysicsNetSampleGenerator(int32 InSeed);
+
+	/** Advance a bouncing rigid body by DeltaTime, with an occasional random impulse, and return its state. */
+	FPhysicsStateActor	AdvanceBody(float DeltaTime);
+
+	/** Next client input: a random walk of the acceleration, rounded like FVector_NetQuantize10 so client and server integrate the same value. */
+	void				NextMoveInput(float DeltaTime, FVector& OutAcceleration, FRotator& OutControlRotation);
+
+	/** Same integration as UPhysicsMovementComponent::PerformMovement(), without collision. */
+	static void			IntegrateMove(FVector& Location, FVector& Velocity, const FVector& Acceleration, float DeltaTime, float MaxSpeed);
+
+	FRandomStream		Random;
+
+private:
+
+	FVector				BodyLocation;
+	FVector				BodyVelocity;
+	FQuat				BodyRotation;
+	FVector				BodyAngularVelocity;
+
+	FVector				MoveAcceleration;
+	FRotator			MoveControlRotation;
+};
+
+struct PHYSICSREPLICATION_API FPhysicsNetStateScenarioResult
+{
+	int32		NumStatesSent { 0 };
+	int32		NumStatesApplied { 0 };
+	int32		NumSamples { 0 };
+	float		AverageLocationError { 0 };
+	float		MaxLocationError { 0 };
+	float		AverageBitsPerState { 0 };
+};
+
+struct PHYSICSREPLICATION_API FPhysicsNetMoveScenarioResult
+{
+	int32		NumMovesSent { 0 };
+	int32		NumMovesProcessed { 0 };
+	int32		NumRedundantMovesProcessed { 0 };
+	int32		NumResponses { 0 };
+	int32		NumCorrections { 0 };
+	int32		NumReplaysSkipped { 0 };
+	int32		NumMovesReplayed { 0 };
+	int32		MaxSavedMoves { 0 };
+	float		AverageBitsPerMove { 0 };
+	float		AverageBitsPerResponse { 0 };
+};
+
+class PHYSICSREPLICATION_API FPhysicsNetEmulatorScenario
+{
+public:
+
+	FPhysicsNetEmulatorScenario(const FPhysicsNetEmulatorSettings& InSettings, float InDuration);
+
+	/**
+	 * Server simulates a physicable and sends FPhysicsStateActor at ServerSendRate. The client receives states at its frame
+	 * rate, interpolates them with FPhysicableInterpolator and is measured every frame against the server location one latency earlier,
+	 * which is the newest location it could know about.
+	 */
+	FPhysicsNetStateScenarioResult	RunStateScenario(float ServerSendRate = 20.f, float ClientFrameRate = 60.f) const;
+
+	/**
+	 * Client produces moves and sends them in FPhysicNetworkMoveDataContainer. The server re-simulates them, with occasional
+	 * external pushes, and answers with coalesced acks or corrections in FPhysicMoveResponseDataContainer. The client releases
+	 * acked moves and replays after corrections using the same bookkeeping as UPhysicsMovementComponent.
+	 */
+	FPhysicsNetMoveScenarioResult	RunMoveScenario(float ClientFrameRate = 60.f, float ServerFrameRate = 30.f) const;
+
+private:
+
+	FPhysicsNetEmulatorSettings		Settings;
+
+	float							Duration;
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsNetEmulatorCommandlet.h"
+#include "PhysicsNetEmulator.h"
+
+#include "Misc/FileHelper.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsNetEmulator, Log, All);
+
+UPhysicsNetEmulatorCommandlet::UPhysicsNetEmulatorCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPhysicsNetEmulatorCommandlet::Main(const FString& Params)
+{
+	FPhysicsNetEmulatorSettings Settings;
+	int32 NumSeeds = 100;
+	int32 FirstSeed = 1;
+	float Duration = 10.f;
+	float MaxAverageError = -1.f;
+	FString CsvFilename;
+
+	FParse::Value(*Params, TEXT("Seeds="), NumSeeds);
+	FParse::Value(*Params, TEXT("FirstSeed="), FirstSeed);
+	FParse::Value(*Params, TEXT("Duration="), Duration);
+	FParse::Value(*Params, TEXT("Latency="), Settings.LatencyMs);
+	FParse::Value(*Params, TEXT("Jitter="), Settings.JitterMs);
+	FParse::Value(*Params, TEXT("Loss="), Settings.LossPct);
+	FParse::Value(*Params, TEXT("Duplicate="), Settings.DuplicatePct);
+	FParse::Value(*Params, TEXT("Reorder="), Settings.ReorderPct);
+	FParse::Value(*Params, TEXT("ReorderDelay="), Settings.ReorderDelayMs);
+	FParse::Value(*Params, TEXT("RedundantMoves="), Settings.RedundantMoves);
+	FParse::Value(*Params, TEXT("MaxAverageError="), MaxAverageError);
+	FParse::Value(*Params, TEXT("Csv="), CsvFilename);
+
+	TArray<FString> CsvLines;
+	CsvLines.Add(TEXT("Seed,StateAvgError,StateMaxError,StateBits,MovesSent,MovesProcessed,RedundantMovesProcessed,Responses,Corrections,ReplaysSkipped,MovesReplayed,MaxSavedMoves,MoveBits,ResponseBits"));
+
+	double StateErrorSum = 0;
+	float StateMaxError = 0.f;
+	int64 NumCorrections = 0;
+	int64 NumReplaysSkipped = 0;
+	int64 NumResponses = 0;
+	int64 NumMovesSent = 0;
+	int64 NumRedundantMovesProcessed = 0;
+	int32 MaxSavedMoves = 0;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Seed = FirstSeed; Seed < FirstSeed + NumSeeds; Seed++)
+	{
+		Settings.Seed = Seed;
+		const FPhysicsNetEmulatorScenario Scenario(Settings, Duration);
+
+		const FPhysicsNetStateScenarioResult StateResult = Scenario.RunStateScenario();
+		const FPhysicsNetMoveScenarioResult MoveResult = Scenario.RunMoveScenario();
+
+		StateErrorSum += StateResult.AverageLocationError;
+		StateMaxError = FMath::Max(StateMaxError, StateResult.MaxLocationError);
+		NumCorrections += MoveResult.NumCorrections;
+		NumReplaysSkipped += MoveResult.NumReplaysSkipped;
+		NumResponses += MoveResult.NumResponses;
+		NumMovesSent += MoveResult.NumMovesSent;
+		NumRedundantMovesProcessed += MoveResult.NumRedundantMovesProcessed;
+		MaxSavedMoves = FMath::Max(MaxSavedMoves, MoveResult.MaxSavedMoves);
+
+		CsvLines.Add(FString::Printf(TEXT("%d,%.3f,%.3f,%.1f,%d,%d,%d,%d,%d,%d,%d,%d,%.1f,%.1f"), Seed,
+			StateResult.AverageLocationError, StateResult.MaxLocationError, StateResult.AverageBitsPerState,
+			MoveResult.NumMovesSent, MoveResult.NumMovesProcessed, MoveResult.NumRedundantMovesProcessed, MoveResult.NumResponses, MoveResult.NumCorrections,
+			MoveResult.NumReplaysSkipped, MoveResult.NumMovesReplayed, MoveResult.MaxSavedMoves,
+			MoveResult.AverageBitsPerMove, MoveResult.AverageBitsPerResponse));
+	}
+
+	const float AverageError = NumSeeds > 0 ? float(StateErrorSum / NumSeeds) : 0.f;
+
+	UE_LOG(LogPhysicsNetEmulator, Display, TEXT("%d seeds in %.2fs (latency %.0fms, jitter %.0fms, loss %.1f%%, duplicate %.1f%%, reorder %.1f%%)"),
+		NumSeeds, FPlatformTime::Seconds() - StartTime, Settings.LatencyMs, Settings.JitterMs, Settings.LossPct, Settings.DuplicatePct, Settings.ReorderPct);
+	UE_LOG(LogPhysicsNetEmulator, Display, TEXT("State: average error %.2f, max error %.2f"), AverageError, StateMaxError);
+	UE_LOG(LogPhysicsNetEmulator, Display, TEXT("Moves: %lld sent, %lld redundant moves processed, %lld responses, %lld corrections, %lld replays skipped, max %d saved moves"),
+		NumMovesSent, NumRedundantMovesProcessed, NumResponses, NumCorrections, NumReplaysSkipped, MaxSavedMoves);
+
+	if (!CsvFilename.IsEmpty() && !FFileHelper::SaveStringArrayToFile(CsvLines, *CsvFilename))
+	{
+		UE_LOG(LogPhysicsNetEmulator, Error, TEXT("Could not write %s"), *CsvFilename);
+		return 1;
+	}
+
+	if (MaxAverageError >= 0.f && AverageError > MaxAverageError)
+	{
+		UE_LOG(LogPhysicsNetEmulator, Error, TEXT("Average error %.2f is above the limit of %.2f"), AverageError, MaxAverageError);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PhysicsNetEmulatorCommandlet.generated.h"
+
+/**
+ * Runs seeded FPhysicsNetEmulatorScenario batches and reports aggregate interpolation error and prediction statistics.
+ *
+ * UE4Editor-Cmd PhysicsReplication -run=PhysicsNetEmulator -Seeds=1000 -Latency=80 -Jitter=10 -Loss=2 -Duplicate=1 -Reorder=2
+ *
+ * Optional: -FirstSeed= -Duration= (seconds per scenario) -RedundantMoves= (0-7) -Csv= (one line per seed) -MaxAverageError= (fails with a non zero
+ * exit code when the mean state interpolation error goes above it, for CI).
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicsNetEmulatorCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsNetEmulatorCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
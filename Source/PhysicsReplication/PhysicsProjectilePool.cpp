@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsProjectilePool.h"
+#include "PhysicsReplicationProjectile.h"
+
+void UPhysicsProjectilePool::Prewarm(TSubclassOf<APhysicsReplicationProjectile> Class, int32 Count, bool bReplicated)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	TArray<APhysicsReplicationProjectile*>& Inactive = Pools.FindOrAdd(Class).Get(bReplicated);
+	const int32 NumToSpawn = FMath::Min(Count, MaxPooledPerClass) - Inactive.Num();
+
+	for (int32 Index = 0; Index < NumToSpawn; Index++)
+	{
+		if (APhysicsReplicationProjectile* Projectile = SpawnPooled(Class, FVector::ZeroVector, FRotator::ZeroRotator, bReplicated))
+		{
+			Projectile->DeactivateToPool();
+			Inactive.Add(Projectile);
+		}
+	}
+}
+
+APhysicsReplicationProjectile* UPhysicsProjectilePool::Acquire(TSubclassOf<APhysicsReplicationProjectile> Class, const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator, bool bReplicated)
+{
+	if (Class == nullptr)
+	{
+		return nullptr;
+	}
+
+	APhysicsReplicationProjectile* Projectile = nullptr;
+
+	TArray<APhysicsReplicationProjectile*>& Inactive = Pools.FindOrAdd(Class).Get(bReplicated);
+	while (Projectile == nullptr && Inactive.Num() > 0)
+	{
+		// Destroyed behind our back (level streaming, world teardown...)
+		APhysicsReplicationProjectile* Candidate = Inactive.Pop(false);
+		Projectile = IsValid(Candidate) ? Candidate : nullptr;
+	}
+
+	if (Projectile == nullptr)
+	{
+		Projectile = SpawnPooled(Class, Location, Rotation, bReplicated);
+		if (Projectile == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	Projectile->SetOwner(Owner);
+	Projectile->SetInstigator(Instigator);
+	Projectile->ActivateFromPool(Location, Rotation);
+	return Projectile;
+}
+
+void UPhysicsProjectilePool::Release(APhysicsReplicationProjectile* Projectile)
+{
+	if (!IsValid(Projectile) || !Projectile->IsPooledActive())
+	{
+		return;
+	}
+
+	TArray<APhysicsReplicationProjectile*>& Inactive = Pools.FindOrAdd(Projectile->GetClass()).Get(Projectile->GetIsReplicated());
+	if (Inactive.Num() >= MaxPooledPerClass)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+	Inactive.Add(Projectile);
+}
+
+APhysicsReplicationProjectile* UPhysicsProjectilePool::SpawnPooled(UClass* Class, const FVector& Location, const FRotator& Rotation, bool bReplicated)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	APhysicsReplicationProjectile* Projectile = GetWorld()->SpawnActor<APhysicsReplicationProjectile>(Class, Location, Rotation, SpawnParams);
+	if (Projectile)
+	{
+		Projectile->SetPool(this);
+
+		// Clients can only have local projectiles, and local projectiles never open a channel on the server.
+		if (!bReplicated || GetWorld()->GetNetMode() == NM_Client)
+		{
+			Projectile->SetReplicates(false);
+		}
+	}
+	return Projectile;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicsProjectilePool.generated.h"
+
+class APhysicsReplicationProjectile;
+
+USTRUCT()
+struct FPhysicsProjectilePoolList
+{
+	GENERATED_BODY()
+
+	/** Deactivated projectiles ready to be handed out again. */
+	UPROPERTY()
+	TArray<APhysicsReplicationProjectile*>	Inactive;
+
+	/** Same for projectiles that do not replicate (local copies of event driven shots). */
+	UPROPERTY()
+	TArray<APhysicsReplicationProjectile*>	InactiveLocal;
+
+	TArray<APhysicsReplicationProjectile*>&	Get(bool bReplicated) { return bReplicated ? Inactive : InactiveLocal; }
+};
+
+/**
+ * Server side pool of projectiles, one list per class.
+ *
+ * Projectiles are spawned once, then deactivated (hidden, no collision, movement stopped, dormant) instead of destroyed and
+ * reactivated for the next shot, so automatic fire neither spawns actors nor opens and closes a channel per shot.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicsProjectilePool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Spawn Count deactivated projectiles of Class up front, up to MaxPooledPerClass. */
+	void								Prewarm(TSubclassOf<APhysicsReplicationProjectile> Class, int32 Count, bool bReplicated = true);
+
+	/**
+	 * Hand out an active projectile at Location / Rotation. Spawns a new one if the pool of Class is empty.
+	 * Non replicated projectiles are kept apart; they are used for event driven shots, on the server and on clients.
+	 */
+	APhysicsReplicationProjectile*		Acquire(TSubclassOf<APhysicsReplicationProjectile> Class, const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator, bool bReplicated = true);
+
+	/** Deactivate Projectile and keep it for the next Acquire(). Destroys it if its pool is full. */
+	void								Release(APhysicsReplicationProjectile* Projectile);
+
+	/** Upper bound of inactive projectiles kept per class. */
+	int32								MaxPooledPerClass { 64 };
+
+private:
+
+	APhysicsReplicationProjectile*		SpawnPooled(UClass* Class, const FVector& Location, const FRotator& Rotation, bool bReplicated);
+
+	UPROPERTY()
+	TMap<UClass*, FPhysicsProjectilePoolList>	Pools;
+};
@@ -1,11 +1,15 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "PhysicsReplicationCharacter.h"
+#include "PhysicsCharacterMovementComponent.h"
+#include "PhysicsClockSyncComponent.h"
 #include "PhysicsReplicationProjectile.h"
+#include "PhysicsProjectilePool.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
 #include "GameFramework/InputSettings.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Kismet/GameplayStatics.h"
@@ -17,7 +21,8 @@ DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
 //////////////////////////////////////////////////////////////////////////
 // APhysicsReplicationCharacter
 
-APhysicsReplicationCharacter::APhysicsReplicationCharacter()
+APhysicsReplicationCharacter::APhysicsReplicationCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UPhysicsCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(55.f, 96.0f);
@@ -68,6 +73,27 @@ void APhysicsReplicationCharacter::BeginPlay()
 	//Attach gun mesh component to Skeleton, doing it here because the skeleton is not yet created in the constructor
 	FP_Gun->AttachToComponent(Mesh1P, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
 
+	if (ProjectileClass != nullptr && (GetLocalRole() == ROLE_Authority || bReplicateProjectilesAsEvents))
+	{
+		if (UPhysicsProjectilePool* ProjectilePool = GetWorld()->GetSubsystem<UPhysicsProjectilePool>())
+		{
+			// Event driven shots only ever use local projectiles, on the server as well as on clients
+			ProjectilePool->Prewarm(ProjectileClass, ProjectilePoolPrewarmCount, !bReplicateProjectilesAsEvents);
+		}
+	}
+
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		if (UPhysicsCharacterMovementComponent* PhysicsMovement = GetPhysicsCharacterMovement())
+		{
+			PhysicsMovement->OnServerInputEvent.AddUObject(this, &APhysicsReplicationCharacter::HandleInputEvent);
+		}
+	}
+}
+
+UPhysicsCharacterMovementComponent* APhysicsReplicationCharacter::GetPhysicsCharacterMovement() const
+{
+	return Cast<UPhysicsCharacterMovementComponent>(GetCharacterMovement());
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -98,7 +124,17 @@ void APhysicsReplicationCharacter::SetupPlayerInputComponent(class UInputCompone
 	PlayerInputComponent->BindAxis("LookUpRate", this, &APhysicsReplicationCharacter::LookUpAtRate);
 }
 
-void APhysicsReplicationCharacter::Fire_Implementation()
+void APhysicsReplicationCharacter::HandleInputEvent(EPhysicsInputEvent Event)
+{
+	switch (Event)
+	{
+	case EPhysicsInputEvent::Fire:
+		Fire();
+		break;
+	}
+}
+
+void APhysicsReplicationCharacter::Fire()
 {
 	// try and fire a projectile
 	if (ProjectileClass != nullptr)
@@ -110,19 +146,122 @@ void APhysicsReplicationCharacter::Fire_Implementation()
 			// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
 			const FVector SpawnLocation = ((FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
 
-			//Set Spawn Collision Handling Override
-			FActorSpawnParameters ActorSpawnParams;
-			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+			// Don't fire from inside geometry, the pool reuses projectiles without spawn collision handling
+			if (World->EncroachingBlockingGeometry(ProjectileClass->GetDefaultObject<AActor>(), SpawnLocation, SpawnRotation))
+			{
+				return;
+			}
+
+			if (bReplicateProjectilesAsEvents)
+			{
+				FireProjectileEvent(SpawnLocation, SpawnRotation);
+				return;
+			}
 
-			// spawn the projectile at the muzzle
-			World->SpawnActor<APhysicsReplicationProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+			// take the projectile from the pool and fire it from the muzzle
+			if (UPhysicsProjectilePool* ProjectilePool = World->GetSubsystem<UPhysicsProjectilePool>())
+			{
+				ProjectilePool->Acquire(ProjectileClass, SpawnLocation, SpawnRotation, this, this);
+			}
 		}
 	}
 }
 
+void APhysicsReplicationCharacter::FireProjectileEvent(const FVector& Origin, const FRotator& Rotation)
+{
+	UWorld* const World = GetWorld();
+	UPhysicsProjectilePool* ProjectilePool = World->GetSubsystem<UPhysicsProjectilePool>();
+	if (ProjectilePool == nullptr)
+	{
+		return;
+	}
+
+	const APhysicsReplicationProjectile* ProjectileCDO = ProjectileClass->GetDefaultObject<APhysicsReplicationProjectile>();
+
+	FPhysicsProjectileFireEvent FireEvent;
+	FireEvent.Origin = Origin;
+	FireEvent.Direction = Rotation.Vector();
+	FireEvent.Speed = ProjectileCDO->GetProjectileMovement()->InitialSpeed;
+	FireEvent.Seed = FMath::Rand();
+	FireEvent.ServerTime = UPhysicsClockSyncComponent::GetServerTime(World);
+	FireEvent.ShotId = ++NextShotId;
+
+	// the server copy is authoritative: it applies impulses and reports how the shot ended
+	if (APhysicsReplicationProjectile* Projectile = ProjectilePool->Acquire(ProjectileClass, Origin, Rotation, this, this, false))
+	{
+		Projectile->InitFireEvent(this, FireEvent, false);
+	}
+
+	MulticastProjectileFired(FireEvent);
+}
+
+void APhysicsReplicationCharacter::MulticastProjectileFired_Implementation(const FPhysicsProjectileFireEvent& FireEvent)
+{
+	if (GetLocalRole() == ROLE_Authority || ProjectileClass == nullptr)
+	{
+		return;
+	}
+
+	UPhysicsProjectilePool* ProjectilePool = GetWorld()->GetSubsystem<UPhysicsProjectilePool>();
+	if (ProjectilePool == nullptr)
+	{
+		return;
+	}
+
+	if (APhysicsReplicationProjectile* Projectile = ProjectilePool->Acquire(ProjectileClass, FireEvent.Origin, FireEvent.Direction.Rotation(), this, this, false))
+	{
+		Projectile->InitFireEvent(this, FireEvent, true);
+		CosmeticProjectiles.Add(FireEvent.ShotId, Projectile);
+	}
+
+	// end events can get lost, forget copies that already went back to the pool on their own
+	for (auto It = CosmeticProjectiles.CreateIterator(); It; ++It)
+	{
+		const APhysicsReplicationProjectile* Projectile = It.Value().Get();
+		if (Projectile == nullptr || !Projectile->IsPooledActive() || Projectile->GetShotId() != It.Key())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void APhysicsReplicationCharacter::NotifyProjectileEnded(uint16 ShotId, const FVector& Location, bool bHit)
+{
+	MulticastProjectileEnded(ShotId, Location, bHit);
+}
+
+void APhysicsReplicationCharacter::MulticastProjectileEnded_Implementation(uint16 ShotId, FVector_NetQuantize Location, bool bHit)
+{
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		return;
+	}
+
+	TWeakObjectPtr<APhysicsReplicationProjectile> CosmeticProjectile;
+	if (!CosmeticProjectiles.RemoveAndCopyValue(ShotId, CosmeticProjectile))
+	{
+		return;
+	}
+
+	APhysicsReplicationProjectile* Projectile = CosmeticProjectile.Get();
+	if (Projectile && Projectile->IsPooledActive() && Projectile->GetShotId() == ShotId)
+	{
+		// end where the server's projectile ended
+		if (bHit)
+		{
+			Projectile->SetActorLocation(Location);
+		}
+		Projectile->FinishShot(bHit);
+	}
+}
+
 void APhysicsReplicationCharacter::OnFire()
 {
-	Fire();
+	// Sent in the move stream, unreliable and repeated until the server acks it
+	if (UPhysicsCharacterMovementComponent* PhysicsMovement = GetPhysicsCharacterMovement())
+	{
+		PhysicsMovement->QueueInputEvent(EPhysicsInputEvent::Fire);
+	}
 
 	// try and play the sound if specified
 	if (FireSound != nullptr)
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "PhysicsReplicationProjectile.h"
 #include "PhysicsReplicationCharacter.generated.h"
 
 class UInputComponent;
@@ -13,6 +14,8 @@ class UCameraComponent;
 class UMotionControllerComponent;
 class UAnimMontage;
 class USoundBase;
+class UPhysicsCharacterMovementComponent;
+enum class EPhysicsInputEvent : uint8;
 
 UCLASS(config=Game)
 class APhysicsReplicationCharacter : public ACharacter
@@ -37,7 +40,7 @@ class APhysicsReplicationCharacter : public ACharacter
 
 public:
 	
-	APhysicsReplicationCharacter();
+	APhysicsReplicationCharacter(const FObjectInitializer& ObjectInitializer);
 
 protected:
 	
@@ -61,6 +64,20 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category=Projectile)
 	TSubclassOf<class APhysicsReplicationProjectile> ProjectileClass;
 
+	/** Projectiles spawned into the pool when this character starts on the server */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	int32 ProjectilePoolPrewarmCount = 16;
+
+	/**
+	 * Replicate shots as events instead of replicated actors: one fire event per shot, simulated locally by every client,
+	 * then one event when the server's projectile hits or expires.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	bool bReplicateProjectilesAsEvents = false;
+
+	/** Server. Called by the authoritative projectile of an event driven shot when it hits something or expires. */
+	void NotifyProjectileEnded(uint16 ShotId, const FVector& Location, bool bHit);
+
 	/** Sound to play each time we fire */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Gameplay)
 	USoundBase* FireSound;
@@ -71,8 +88,25 @@ public:
 
 protected:
 
-	UFUNCTION(Server,Reliable)
+	/** Server. Fire a projectile from the muzzle. Clients ask for it with an EPhysicsInputEvent::Fire input event. */
 	void Fire();
+
+	/** Server. Input events sent by the owning client in its moves. */
+	void HandleInputEvent(EPhysicsInputEvent Event);
+
+	/** Server. Fire an event driven shot: simulate it locally and tell clients to do the same. */
+	void FireProjectileEvent(const FVector& Origin, const FRotator& Rotation);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastProjectileFired(const FPhysicsProjectileFireEvent& FireEvent);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastProjectileEnded(uint16 ShotId, FVector_NetQuantize Location, bool bHit);
+
+	uint16 NextShotId = 0;
+
+	/** Clients. Local copies of event driven shots still in flight. */
+	TMap<uint16, TWeakObjectPtr<APhysicsReplicationProjectile>> CosmeticProjectiles;
 	
 	/** Fires a projectile. */
 	void OnFire();
@@ -104,6 +138,9 @@ public:
 	/** Returns Mesh1P subobject **/
 	USkeletalMeshComponent* GetMesh1P() const { return Mesh1P; }
 
+	/** Returns the character movement, which carries input events to the server **/
+	UPhysicsCharacterMovementComponent* GetPhysicsCharacterMovement() const;
+
 	/** Returns FirstPersonCameraComponent subobject **/
 	UCameraComponent* GetFirstPersonCameraComponent() const { return FirstPersonCameraComponent; }
 
@@ -3,6 +3,8 @@
 #include "PhysicsReplicationGameMode.h"
 #include "PhysicsReplicationHUD.h"
 #include "PhysicsReplicationCharacter.h"
+#include "PhysicsReplicationPlayerController.h"
+#include "PhysicableJoinSnapshotComponent.h"
 #include "UObject/ConstructorHelpers.h"
 
 APhysicsReplicationGameMode::APhysicsReplicationGameMode() : Super()
@@ -13,4 +15,18 @@ APhysicsReplicationGameMode::APhysicsReplicationGameMode() : Super()
 
 	// use our custom HUD class
 	HUDClass = APhysicsReplicationHUD::StaticClass();
+
+	// carries the clock sync, state hash and join snapshot components
+	PlayerControllerClass = APhysicsReplicationPlayerController::StaticClass();
+}
+
+void APhysicsReplicationGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	// the resting level physicables are not replicated on join, they come in one snapshot
+	if (UPhysicableJoinSnapshotComponent* JoinSnapshot = NewPlayer->FindComponentByClass<UPhysicableJoinSnapshotComponent>())
+	{
+		JoinSnapshot->SendSnapshot();
+	}
 }
@@ -13,6 +13,8 @@ class APhysicsReplicationGameMode : public AGameModeBase
 
 public:
 	APhysicsReplicationGameMode();
+
+	virtual void PostLogin(APlayerController* NewPlayer) override;
 };
 
 
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsReplicationGraph.h"
+#include "Physicable.h"
+#include "PhysicableMesh.h"
+#include "PhysicsReplicationCharacter.h"
+#include "PhysicsReplicationProjectile.h"
+
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetConnection.h"
+#include "ReplicationGraphTypes.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsReplicationGraph, Log, All);
+
+UPhysicsReplicationGraph::UPhysicsReplicationGraph()
+{
+	GridCellSize = 10000.f;
+	SpatialBias = FVector2D(-200000.f, -200000.f);
+	PhysicableCullDistance = 15000.f;
+
+	GridNode = nullptr;
+	AlwaysRelevantNode = nullptr;
+}
+
+void UPhysicsReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	ClassRouteMap.Set(ALevelScriptActor::StaticClass(), EPhysicsRepGraphRoute::NotRouted);
+	ClassRouteMap.Set(APhysicable::StaticClass(), EPhysicsRepGraphRoute::Spatialize_Dormancy);
+	ClassRouteMap.Set(APhysicableMesh::StaticClass(), EPhysicsRepGraphRoute::Spatialize_Dormancy);
+	ClassRouteMap.Set(APhysicsReplicationProjectile::StaticClass(), EPhysicsRepGraphRoute::Spatialize_Dynamic);
+	ClassRouteMap.Set(APhysicsReplicationCharacter::StaticClass(), EPhysicsRepGraphRoute::AlwaysRelevant);
+
+	// Replication period and cull distance come from the class defaults, the graph ignores per instance values.
+	const float ServerMaxTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.f;
+
+	auto SetSpatializedClassInfo = [this, ServerMaxTickRate](UClass* Class, float CullDistance)
+	{
+		const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.SetCullDistanceSquared(FMath::Square(CullDistance));
+		ClassInfo.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(ServerMaxTickRate / ActorCDO->NetUpdateFrequency), 1);
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	};
+
+	SetSpatializedClassInfo(APhysicable::StaticClass(), PhysicableCullDistance);
+	SetSpatializedClassInfo(APhysicableMesh::StaticClass(), PhysicableCullDistance);
+	SetSpatializedClassInfo(APhysicsReplicationProjectile::StaticClass(), PhysicableCullDistance);
+}
+
+void UPhysicsReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UPhysicsReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+
+	AlwaysRelevantForConnectionList.Emplace(RepGraphConnection->NetConnection, AlwaysRelevantConnectionNode);
+}
+
+void UPhysicsReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	AlwaysRelevantForConnectionList.RemoveAllSwap([NetConnection](const FPhysicsConnectionAlwaysRelevantNodePair& Pair)
+	{
+		return Pair.NetConnection == NetConnection;
+	});
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+EPhysicsRepGraphRoute UPhysicsReplicationGraph::GetRoute(const AActor* Actor) const
+{
+	if (const EPhysicsRepGraphRoute* Route = ClassRouteMap.Get(Actor->GetClass()))
+	{
+		return *Route;
+	}
+
+	if (Actor->bAlwaysRelevant)
+	{
+		return EPhysicsRepGraphRoute::AlwaysRelevant;
+	}
+
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return EPhysicsRepGraphRoute::OwnerOnly;
+	}
+
+	// Anything else may or may not move; the grid decides from its dormancy.
+	return EPhysicsRepGraphRoute::Spatialize_Dormancy;
+}
+
+void UPhysicsReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetRoute(ActorInfo.Actor))
+	{
+		case EPhysicsRepGraphRoute::AlwaysRelevant:
+			AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::OwnerOnly:
+			ActorsWithoutNetConnection.Add(ActorInfo.Actor);
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Static:
+			GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Dynamic:
+			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Dormancy:
+			GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+			break;
+
+		default:
+			break;
+	}
+}
+
+void UPhysicsReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetRoute(ActorInfo.Actor))
+	{
+		case EPhysicsRepGraphRoute::AlwaysRelevant:
+			AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::OwnerOnly:
+			ActorsWithoutNetConnection.Remove(ActorInfo.Actor);
+			if (UReplicationGraphNode_AlwaysRelevant_ForConnection* Node = GetAlwaysRelevantNodeForConnection(ActorInfo.Actor->GetNetConnection()))
+			{
+				Node->NotifyRemoveNetworkActor(ActorInfo);
+			}
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Static:
+			GridNode->RemoveActor_Static(ActorInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Dynamic:
+			GridNode->RemoveActor_Dynamic(ActorInfo);
+			break;
+
+		case EPhysicsRepGraphRoute::Spatialize_Dormancy:
+			GridNode->RemoveActor_Dormancy(ActorInfo);
+			break;
+
+		default:
+			break;
+	}
+}
+
+UReplicationGraphNode_AlwaysRelevant_ForConnection* UPhysicsReplicationGraph::GetAlwaysRelevantNodeForConnection(UNetConnection* Connection)
+{
+	if (Connection == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (FPhysicsConnectionAlwaysRelevantNodePair* Pair = AlwaysRelevantForConnectionList.FindByKey(Connection))
+	{
+		return Pair->Node;
+	}
+
+	return nullptr;
+}
+
+int32 UPhysicsReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	// Owner only actors are usually added before their owner has a connection; move them to their connection's node once it does.
+	for (int32 Index = ActorsWithoutNetConnection.Num() - 1; Index >= 0; Index--)
+	{
+		bool bRemove = false;
+		if (AActor* Actor = ActorsWithoutNetConnection[Index])
+		{
+			if (UNetConnection* Connection = Actor->GetNetConnection())
+			{
+				bRemove = true;
+				if (UReplicationGraphNode_AlwaysRelevant_ForConnection* Node = GetAlwaysRelevantNodeForConnection(Connection))
+				{
+					Node->NotifyAddNetworkActor(FNewReplicatedActorInfo(Actor));
+				}
+				else
+				{
+					UE_LOG(LogPhysicsReplicationGraph, Warning, TEXT("No always relevant node for %s's connection"), *Actor->GetName());
+				}
+			}
+		}
+		else
+		{
+			bRemove = true;
+		}
+
+		if (bRemove)
+		{
+			ActorsWithoutNetConnection.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "PhysicsReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_AlwaysRelevant_ForConnection;
+
+/** How an actor class is routed into the graph. */
+enum class EPhysicsRepGraphRoute : uint8
+{
+	NotRouted,				// Not replicated through the graph
+	AlwaysRelevant,			// Replicated to every connection, e.g. players and game state
+	OwnerOnly,				// Replicated to the owning connection only, e.g. player controllers
+	Spatialize_Static,		// Grid, never moves
+	Spatialize_Dynamic,		// Grid, moves every frame
+	Spatialize_Dormancy,	// Grid, treated as static while dormant and dynamic while awake
+};
+
+USTRUCT()
+struct FPhysicsConnectionAlwaysRelevantNodePair
+{
+	GENERATED_BODY()
+
+	FPhysicsConnectionAlwaysRelevantNodePair() { }
+	FPhysicsConnectionAlwaysRelevantNodePair(UNetConnection* InConnection, UReplicationGraphNode_AlwaysRelevant_ForConnection* InNode) : NetConnection(InConnection), Node(InNode) { }
+
+	bool operator==(const UNetConnection* InConnection) const { return InConnection == NetConnection; }
+
+	UPROPERTY()
+	UNetConnection* NetConnection { nullptr };
+
+	UPROPERTY()
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* Node { nullptr };
+};
+
+/**
+ * Replication graph of the project.
+ *
+ * Physicables and projectiles go into a 2D spatial grid, so gathering the actors of a connection only visits the cells around its
+ * viewer instead of every actor in the level. Resting physicables go dormant (see APhysicable::RestTimeBeforeDormancy) and are
+ * kept in the grid as static actors until they wake up. Players and always relevant actors go into one list shared by every connection.
+ *
+ * Enabled in DefaultEngine.ini through the net driver's ReplicationDriverClassName.
+ */
+UCLASS(transient, config=Engine)
+class PHYSICSREPLICATION_API UPhysicsReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/** Size of a grid cell, in cm. */
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	/** Bias of the grid origin, so a level centered on the world origin does not need negative cells. */
+	UPROPERTY(Config)
+	FVector2D SpatialBias;
+
+	/** Cull distance of physicables and projectiles, in cm. */
+	UPROPERTY(Config)
+	float PhysicableCullDistance;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY()
+	TArray<FPhysicsConnectionAlwaysRelevantNodePair> AlwaysRelevantForConnectionList;
+
+	/** Owner only actors whose connection was not known yet when they were added. */
+	UPROPERTY()
+	TArray<AActor*> ActorsWithoutNetConnection;
+
+private:
+
+	EPhysicsRepGraphRoute GetRoute(const AActor* Actor) const;
+
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* GetAlwaysRelevantNodeForConnection(UNetConnection* Connection);
+
+	TClassMap<EPhysicsRepGraphRoute> ClassRouteMap;
+};
@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsReplicationPlayerController.h"
+#include "PhysicsClockSyncComponent.h"
+#include "PhysicsStateHashComponent.h"
+#include "PhysicableJoinSnapshotComponent.h"
+#include "PhysicsKeyframeErrorComponent.h"
+
+APhysicsReplicationPlayerController::APhysicsReplicationPlayerController()
+{
+	ClockSync = CreateDefaultSubobject<UPhysicsClockSyncComponent>(TEXT("ClockSync"));
+	StateHash = CreateDefaultSubobject<UPhysicsStateHashComponent>(TEXT("StateHash"));
+	JoinSnapshot = CreateDefaultSubobject<UPhysicableJoinSnapshotComponent>(TEXT("JoinSnapshot"));
+	KeyframeError = CreateDefaultSubobject<UPhysicsKeyframeErrorComponent>(TEXT("KeyframeError"));
+}
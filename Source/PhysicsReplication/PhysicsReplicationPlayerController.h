@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicsReplicationPlayerController.generated.h"
+
+class UPhysicsClockSyncComponent;
+class UPhysicsStateHashComponent;
+class UPhysicsKeyframeErrorComponent;
+class UPhysicableJoinSnapshotComponent;
+
+UCLASS()
+class PHYSICSREPLICATION_API APhysicsReplicationPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+
+	APhysicsReplicationPlayerController();
+
+	UPhysicsClockSyncComponent*		GetClockSync() const { return ClockSync; }
+
+	UPhysicsStateHashComponent*		GetStateHash() const { return StateHash; }
+
+	UPhysicableJoinSnapshotComponent*	GetJoinSnapshot() const { return JoinSnapshot; }
+
+	UPhysicsKeyframeErrorComponent*	GetKeyframeError() const { return KeyframeError; }
+
+private:
+
+	/** Estimated server time on the owning client. */
+	UPROPERTY(VisibleAnywhere, Category="Replication")
+	UPhysicsClockSyncComponent*		ClockSync;
+
+	/** Reports the state hashes of the physicables the owning client shows. */
+	UPROPERTY(VisibleAnywhere, Category="Replication")
+	UPhysicsStateHashComponent*		StateHash;
+
+	/** Sends the resting level physicables to the owning client when it joins. */
+	UPROPERTY(VisibleAnywhere, Category="Replication")
+	UPhysicableJoinSnapshotComponent*	JoinSnapshot;
+
+	/** Reports the keyframe errors of the physicables the owning client simulates from contact events. */
+	UPROPERTY(VisibleAnywhere, Category="Replication")
+	UPhysicsKeyframeErrorComponent*	KeyframeError;
+};
@@ -1,8 +1,15 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "PhysicsReplicationProjectile.h"
+#include "Physicable.h"
+#include "PhysicsClockSyncComponent.h"
+#include "PhysicsImpulseAggregator.h"
+#include "PhysicsProjectilePool.h"
+#include "PhysicsReplicationCharacter.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
 
 APhysicsReplicationProjectile::APhysicsReplicationProjectile() 
 {
@@ -40,11 +47,163 @@ APhysicsReplicationProjectile::APhysicsReplicationProjectile()
 
 void APhysicsReplicationProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	// Cosmetic copies keep bouncing until the server reports the hit
+	if (bCosmetic)
+	{
+		return;
+	}
+
+	// Held kinematic on the server while a client simulates it: the shot goes to that client, or takes the simulation back.
+	APhysicable* Physicable = Cast<APhysicable>(OtherActor);
+	if (Physicable && Physicable->IsClientAuthoritative() && GetNetMode() != NM_Client)
+	{
+		const APawn* ShooterPawn = Shooter.Get();
+		if (Physicable->RouteClientAuthorityImpulse(GetVelocity() * 100.0f, GetActorLocation(), ShooterPawn ? ShooterPawn->GetController() : nullptr))
+		{
+			FinishShot(true);
+			return;
+		}
+	}
+
 	// Only add impulse and destroy projectile if we hit a physics
 	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr) && OtherComp->IsSimulatingPhysics())
 	{
-		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+		// Batched with the other hits of this frame, applied before the physics step
+		if (UPhysicsImpulseAggregator* ImpulseAggregator = GetWorld()->GetSubsystem<UPhysicsImpulseAggregator>())
+		{
+			ImpulseAggregator->AddImpulseAtLocation(OtherComp, GetVelocity() * 100.0f, GetActorLocation(), Hit.BoneName);
+		}
+		else
+		{
+			OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+		}
+
+		FinishShot(true);
+	}
+}
 
+void APhysicsReplicationProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(APhysicsReplicationProjectile, bPooledActive);
+}
+
+void APhysicsReplicationProjectile::SetPool(UPhysicsProjectilePool* InPool)
+{
+	Pool = InPool;
+
+	// The pool keeps the actor alive, the lifespan only returns it.
+	PooledLifeSpan = InitialLifeSpan;
+	SetLifeSpan(0.f);
+}
+
+void APhysicsReplicationProjectile::ActivateFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	SetNetDormancy(DORM_Awake);
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	bPooledActive = true;
+	ApplyPooledActive();
+
+	if (PooledLifeSpan > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(PooledLifeSpanTimer, this, &APhysicsReplicationProjectile::OnPooledLifeSpanExpired, PooledLifeSpan);
+	}
+
+	ForceNetUpdate();
+}
+
+void APhysicsReplicationProjectile::DeactivateToPool()
+{
+	GetWorldTimerManager().ClearTimer(PooledLifeSpanTimer);
+
+	bPooledActive = false;
+	ApplyPooledActive();
+
+	Shooter = nullptr;
+	ShotId = 0;
+	bCosmetic = false;
+
+	// The channel closes once clients have acked the deactivation, and reopens on the next activation.
+	ForceNetUpdate();
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void APhysicsReplicationProjectile::InitFireEvent(APhysicsReplicationCharacter* InShooter, const FPhysicsProjectileFireEvent& FireEvent, bool bInCosmetic)
+{
+	Shooter = InShooter;
+	ShotId = FireEvent.ShotId;
+	ShotSeed = FireEvent.Seed;
+	bCosmetic = bInCosmetic;
+
+	float Elapsed = 0.f;
+	if (bCosmetic)
+	{
+		Elapsed = FMath::Clamp(UPhysicsClockSyncComponent::GetServerTime(this) - FireEvent.ServerTime, 0.f, MaxFireEventCatchUp);
+	}
+
+	// Same ballistic path the movement component follows, without collision for the part we skip.
+	const FVector Gravity(0.f, 0.f, ProjectileMovement->GetGravityZ());
+	const FVector StartVelocity = FVector(FireEvent.Direction) * FireEvent.Speed;
+
+	SetActorLocationAndRotation(FireEvent.Origin + StartVelocity * Elapsed + 0.5f * Gravity * FMath::Square(Elapsed), FireEvent.Direction.Rotation(), false, nullptr, ETeleportType::ResetPhysics);
+	ProjectileMovement->Velocity = StartVelocity + Gravity * Elapsed;
+	ProjectileMovement->UpdateComponentVelocity();
+
+	if (Elapsed > 0.f && PooledLifeSpan > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(PooledLifeSpanTimer, this, &APhysicsReplicationProjectile::OnPooledLifeSpanExpired, FMath::Max(PooledLifeSpan - Elapsed, KINDA_SMALL_NUMBER));
+	}
+}
+
+void APhysicsReplicationProjectile::FinishShot(bool bHit)
+{
+	APhysicsReplicationCharacter* ShooterCharacter = Shooter.Get();
+	if (ShooterCharacter && !bCosmetic)
+	{
+		ShooterCharacter->NotifyProjectileEnded(ShotId, GetActorLocation(), bHit);
+	}
+
+	ReturnToPool();
+}
+
+void APhysicsReplicationProjectile::OnPooledLifeSpanExpired()
+{
+	FinishShot(false);
+}
+
+void APhysicsReplicationProjectile::ReturnToPool()
+{
+	if (UPhysicsProjectilePool* ProjectilePool = Pool.Get())
+	{
+		ProjectilePool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
+}
+
+void APhysicsReplicationProjectile::OnRep_PooledActive()
+{
+	ApplyPooledActive();
+}
+
+void APhysicsReplicationProjectile::ApplyPooledActive()
+{
+	SetActorHiddenInGame(!bPooledActive);
+	SetActorEnableCollision(bPooledActive);
+
+	if (bPooledActive)
+	{
+		ProjectileMovement->SetUpdatedComponent(CollisionComp);
+		ProjectileMovement->Velocity = GetActorForwardVector() * ProjectileMovement->InitialSpeed;
+		ProjectileMovement->UpdateComponentVelocity();
+		ProjectileMovement->Activate(true);
+	}
+	else
+	{
+		ProjectileMovement->StopMovementImmediately();
+		ProjectileMovement->Deactivate();
+	}
 }
\ No newline at end of file
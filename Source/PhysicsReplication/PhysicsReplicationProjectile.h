@@ -4,10 +4,40 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
 #include "PhysicsReplicationProjectile.generated.h"
 
 class USphereComponent;
 class UProjectileMovementComponent;
+class UPhysicsProjectilePool;
+class APhysicsReplicationCharacter;
+
+/** Everything a client needs to simulate a shot locally. */
+USTRUCT()
+struct FPhysicsProjectileFireEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize10 Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	UPROPERTY()
+	float Speed = 0.f;
+
+	/** Seed for anything random about the shot, identical on server and clients. */
+	UPROPERTY()
+	int32 Seed = 0;
+
+	/** Server world time of the shot; clients fast forward their copy by the time it took the event to arrive. */
+	UPROPERTY()
+	float ServerTime = 0.f;
+
+	UPROPERTY()
+	uint16 ShotId = 0;
+};
 
 UCLASS(config=Game)
 class APhysicsReplicationProjectile : public AActor
@@ -33,5 +63,68 @@ public:
 	USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
 	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Server. Called by the pool that spawned this projectile; the pool's lifespan timer replaces InitialLifeSpan from then on. */
+	void SetPool(UPhysicsProjectilePool* InPool);
+
+	/** Server. Move to Location / Rotation and start flying again. */
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation);
+
+	/** Server. Hide, stop and go dormant until the next ActivateFromPool(). */
+	void DeactivateToPool();
+
+	bool IsPooledActive() const { return bPooledActive; }
+
+	/**
+	 * Turn an activated, non replicated projectile into the local copy of an event driven shot. The server copy is authoritative and
+	 * reports its hit or expiry to InShooter; cosmetic copies on clients only fly until the server says the shot ended.
+	 */
+	void InitFireEvent(APhysicsReplicationCharacter* InShooter, const FPhysicsProjectileFireEvent& FireEvent, bool bInCosmetic);
+
+	/** End the shot: report it to the shooter if this is the authoritative copy of an event driven shot, then return to the pool. */
+	void FinishShot(bool bHit);
+
+	uint16 GetShotId() const { return ShotId; }
+
+	int32 GetShotSeed() const { return ShotSeed; }
+
+protected:
+
+	/** Give the projectile back to its pool, or destroy it if it was not spawned by one. */
+	void ReturnToPool();
+
+	void OnPooledLifeSpanExpired();
+
+	UFUNCTION()
+	void OnRep_PooledActive();
+
+	/** Show or hide the projectile and enable or disable its collision and movement. */
+	void ApplyPooledActive();
+
+	/** False while the projectile sits in its pool. */
+	UPROPERTY(ReplicatedUsing=OnRep_PooledActive)
+	bool bPooledActive = true;
+
+	TWeakObjectPtr<UPhysicsProjectilePool> Pool;
+
+	/** InitialLifeSpan of pooled projectiles, applied on each activation. */
+	float PooledLifeSpan = 0.f;
+
+	FTimerHandle PooledLifeSpanTimer;
+
+	/** Set for event driven shots only. */
+	TWeakObjectPtr<APhysicsReplicationCharacter> Shooter;
+
+	uint16 ShotId = 0;
+
+	int32 ShotSeed = 0;
+
+	/** Client copy of an event driven shot: no impulses, no reports. */
+	bool bCosmetic = false;
+
+	/** Clients never fast forward a shot by more than this, in seconds. */
+	static constexpr float MaxFireEventCatchUp = 0.5f;
 };
 
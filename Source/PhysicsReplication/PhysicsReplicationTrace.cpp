@@ -0,0 +1,434 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsReplicationTrace.h"
+
+#include "Async/MappedFileHandle.h"
+#include "Engine/Engine.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsTrace, Log, All);
+
+FArchive& operator<<(FArchive& Ar, FPhysicsTraceRecord& Record)
+{
+	uint8 Source = (uint8)Record.Source;
+
+	Ar << Record.Time;
+	Ar << Record.ObjectId;
+	Ar << Source;
+	Ar << Record.ClientIndex;
+	Ar << Record.State.Transform;
+	Ar << Record.State.Velocity;
+	Ar << Record.State.ServerDeltaTime;
+	Ar << Record.State.ServerTimeStamp;
+	Ar << Record.State.IslandId;
+	Ar << Record.State.IslandSize;
+	Ar << Record.StartVelocity;
+
+	Record.Source = (EPhysicsTraceSource)Source;
+	return Ar;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsTraceWriter
+
+FPhysicsTraceWriter::FPhysicsTraceWriter(int32 InChunkSize)
+	: ChunkSize(InChunkSize)
+{
+}
+
+FPhysicsTraceWriter::~FPhysicsTraceWriter()
+{
+	Close();
+}
+
+bool FPhysicsTraceWriter::Open(const FString& Filename)
+{
+	Close();
+
+	FileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename);
+	if (FileHandle == nullptr)
+	{
+		UE_LOG(LogPhysicsTrace, Error, TEXT("Failed to open %s for writing"), *Filename);
+		return false;
+	}
+
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter HeaderWriter(HeaderBytes);
+	FPhysicsTraceFileHeader Header;
+	HeaderWriter << Header;
+	FileHandle->Write(HeaderBytes.GetData(), HeaderBytes.Num());
+
+	ChunkBuffer.Reset(ChunkSize);
+	NumChunkRecords = 0;
+	return true;
+}
+
+void FPhysicsTraceWriter::Append(FPhysicsTraceRecord& Record)
+{
+	if (FileHandle == nullptr)
+	{
+		return;
+	}
+
+	FMemoryWriter RecordWriter(ChunkBuffer);
+	RecordWriter.Seek(ChunkBuffer.Num());
+	RecordWriter << Record;
+	NumChunkRecords++;
+
+	if (ChunkBuffer.Num() >= ChunkSize)
+	{
+		Flush();
+	}
+}
+
+void FPhysicsTraceWriter::Flush()
+{
+	if (FileHandle == nullptr || NumChunkRecords == 0)
+	{
+		return;
+	}
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, ChunkBuffer.Num());
+	CompressedBuffer.SetNumUninitialized(CompressedSize, false);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, CompressedBuffer.GetData(), CompressedSize, ChunkBuffer.GetData(), ChunkBuffer.Num()))
+	{
+		UE_LOG(LogPhysicsTrace, Error, TEXT("Failed to compress trace chunk, dropping %u records"), NumChunkRecords);
+	}
+	else
+	{
+		FPhysicsTraceChunkHeader ChunkHeader;
+		ChunkHeader.UncompressedSize = ChunkBuffer.Num();
+		ChunkHeader.CompressedSize = CompressedSize;
+		ChunkHeader.NumRecords = NumChunkRecords;
+
+		TArray<uint8> HeaderBytes;
+		FMemoryWriter HeaderWriter(HeaderBytes);
+		HeaderWriter << ChunkHeader;
+
+		FileHandle->Write(HeaderBytes.GetData(), HeaderBytes.Num());
+		FileHandle->Write(CompressedBuffer.GetData(), CompressedSize);
+	}
+
+	ChunkBuffer.Reset(ChunkSize);
+	NumChunkRecords = 0;
+}
+
+void FPhysicsTraceWriter::Close()
+{
+	if (FileHandle != nullptr)
+	{
+		Flush();
+		FileHandle->Flush();
+		delete FileHandle;
+		FileHandle = nullptr;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsTraceReader
+
+FPhysicsTraceReader::~FPhysicsTraceReader()
+{
+	Close();
+}
+
+bool FPhysicsTraceReader::Open(const FString& Filename)
+{
+	Close();
+
+	MappedHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename);
+	if (MappedHandle == nullptr)
+	{
+		UE_LOG(LogPhysicsTrace, Error, TEXT("Failed to memory map %s"), *Filename);
+		return false;
+	}
+
+	MappedRegion = MappedHandle->MapRegion(0, MappedHandle->GetFileSize());
+	if (MappedRegion == nullptr)
+	{
+		UE_LOG(LogPhysicsTrace, Error, TEXT("Failed to map a region of %s"), *Filename);
+		Close();
+		return false;
+	}
+
+	Data = MappedRegion->GetMappedPtr();
+	DataSize = MappedRegion->GetMappedSize();
+
+	FPhysicsTraceFileHeader Header;
+	Header.Magic = 0;
+
+	TArray<uint8> HeaderBytes(Data, (int32)FMath::Min<int64>(DataSize, 2 * sizeof(uint32)));
+	FMemoryReader HeaderReader(HeaderBytes);
+	HeaderReader << Header;
+
+	if (HeaderReader.IsError() || Header.Magic != FPhysicsTraceFileHeader::ExpectedMagic || Header.Version != FPhysicsTraceFileHeader::CurrentVersion)
+	{
+		UE_LOG(LogPhysicsTrace, Error, TEXT("%s is not a physics replication trace (or has an unsupported version)"), *Filename);
+		Close();
+		return false;
+	}
+
+	Offset = HeaderReader.Tell();
+	return true;
+}
+
+void FPhysicsTraceReader::Close()
+{
+	delete MappedRegion;
+	MappedRegion = nullptr;
+
+	delete MappedHandle;
+	MappedHandle = nullptr;
+
+	Data = nullptr;
+	DataSize = 0;
+	Offset = 0;
+}
+
+bool FPhysicsTraceReader::ReadNextChunk(TArray<FPhysicsTraceRecord>& OutRecords)
+{
+	OutRecords.Reset();
+
+	if (Data == nullptr || Offset + FPhysicsTraceChunkHeader::SerializedSize > DataSize)
+	{
+		return false;
+	}
+
+	FPhysicsTraceChunkHeader ChunkHeader;
+	{
+		TArray<uint8> HeaderBytes(Data + Offset, FPhysicsTraceChunkHeader::SerializedSize);
+		FMemoryReader HeaderReader(HeaderBytes);
+		HeaderReader << ChunkHeader;
+	}
+	Offset += FPhysicsTraceChunkHeader::SerializedSize;
+
+	if (Offset + ChunkHeader.CompressedSize > DataSize)
+	{
+		UE_LOG(LogPhysicsTrace, Warning, TEXT("Truncated trace chunk at offset %lld"), Offset);
+		return false;
+	}
+
+	ChunkBuffer.SetNumUninitialized(ChunkHeader.UncompressedSize, false);
+	if (!FCompression::UncompressMemory(NAME_Zlib, ChunkBuffer.GetData(), ChunkHeader.UncompressedSize, Data + Offset, ChunkHeader.CompressedSize))
+	{
+		UE_LOG(LogPhysicsTrace, Warning, TEXT("Failed to decompress trace chunk at offset %lld"), Offset);
+		return false;
+	}
+	Offset += ChunkHeader.CompressedSize;
+
+	FMemoryReader RecordReader(ChunkBuffer);
+	OutRecords.SetNum(ChunkHeader.NumRecords);
+	for (FPhysicsTraceRecord& Record : OutRecords)
+	{
+		RecordReader << Record;
+	}
+
+	return !RecordReader.IsError();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsTraceRecorder
+
+FPhysicsTraceRecorder& FPhysicsTraceRecorder::Get()
+{
+	static FPhysicsTraceRecorder Recorder;
+	return Recorder;
+}
+
+bool FPhysicsTraceRecorder::Start(const FString& Filename)
+{
+	if (!Writer.Open(Filename))
+	{
+		return false;
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	UE_LOG(LogPhysicsTrace, Log, TEXT("Recording physics replication trace to %s"), *Filename);
+	return true;
+}
+
+void FPhysicsTraceRecorder::Stop()
+{
+	if (Writer.IsOpen())
+	{
+		Writer.Close();
+		UE_LOG(LogPhysicsTrace, Log, TEXT("Stopped recording physics replication trace"));
+	}
+}
+
+void FPhysicsTraceRecorder::RecordState(const APhysicable* Physicable, EPhysicsTraceSource Source, const FPhysicsStateActor& State, const FVector& StartVelocity)
+{
+	FPhysicsTraceRecord Record;
+	Record.Time = FPlatformTime::Seconds() - StartTime;
+	Record.ObjectId = GetObjectId(Physicable);
+	Record.Source = Source;
+	Record.State = State;
+	Record.StartVelocity = StartVelocity;
+	Record.ClientIndex = Source == EPhysicsTraceSource::Server ? 0 : GetClientIndex(Physicable->GetWorld());
+
+	Writer.Append(Record);
+}
+
+uint32 FPhysicsTraceRecorder::GetObjectId(const AActor* Actor)
+{
+	const UNetDriver* NetDriver = Actor->GetNetDriver();
+	if (NetDriver && NetDriver->GuidCache.IsValid())
+	{
+		// The server may record a state before the actor is first replicated; assigning the NetGUID early is what replication does anyway.
+		const FNetworkGUID NetGUID = NetDriver->IsServer() ? NetDriver->GuidCache->GetOrAssignNetGUID(const_cast<AActor*>(Actor)) : NetDriver->GuidCache->GetNetGUID(Actor);
+		if (NetGUID.IsValid())
+		{
+			return NetGUID.Value;
+		}
+	}
+
+	// Standalone: unique within the world.
+	return GetTypeHash(Actor->GetPathName());
+}
+
+int32 FPhysicsTraceRecorder::GetClientIndex(const UWorld* World)
+{
+	const APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+	if (PlayerController && PlayerController->PlayerState)
+	{
+		return PlayerController->PlayerState->GetPlayerId();
+	}
+	return INDEX_NONE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FPhysicsTracePlayer
+
+FPhysicsTracePlayer::FPhysicsTracePlayer(int32 InClientIndex, float InStepSeconds)
+	: ClientIndex(InClientIndex)
+	, StepSeconds(InStepSeconds)
+{
+}
+
+FPhysicsTracePlaybackStats FPhysicsTracePlayer::Play(FPhysicsTraceReader& Reader)
+{
+	FPhysicsTracePlaybackStats Stats;
+	double ErrorSum = 0;
+
+	const double WallStart = FPlatformTime::Seconds();
+
+	TArray<FPhysicsTraceRecord> Records;
+	while (Reader.ReadNextChunk(Records))
+	{
+		for (const FPhysicsTraceRecord& Record : Records)
+		{
+			AdvanceTo(Record.Time, Stats, ErrorSum);
+
+			// Without a client given, replay the first one that recorded a state.
+			if (ClientIndex == INDEX_NONE && Record.Source != EPhysicsTraceSource::Server)
+			{
+				ClientIndex = Record.ClientIndex;
+			}
+
+			FObjectState& Object = Objects.FindOrAdd(Record.ObjectId);
+			if (Record.Source == EPhysicsTraceSource::Server)
+			{
+				Object.ServerState = Record.State;
+				Object.bHasServerState = true;
+			}
+			else if (Record.ClientIndex != INDEX_NONE && Record.ClientIndex == ClientIndex)
+			{
+				// Same sequence as APhysicable::SimulatedProxy_PhysicsState: start from the displayed transform, then snap to the new state.
+				Object.Interpolator.OnStateReceived(Record.State, Object.DisplayTransform, Record.StartVelocity);
+				Object.DisplayTransform = Record.State.Transform;
+				Object.bHasClientState = true;
+			}
+
+			Stats.NumRecords++;
+			Stats.TraceDuration = Record.Time;
+		}
+	}
+
+	Stats.WallDuration = FPlatformTime::Seconds() - WallStart;
+	Stats.AverageLocationError = Stats.NumSamples > 0 ? float(ErrorSum / Stats.NumSamples) : 0.f;
+	return Stats;
+}
+
+void FPhysicsTracePlayer::AdvanceTo(double Time, FPhysicsTracePlaybackStats& Stats, double& ErrorSum)
+{
+	while (PlaybackTime + StepSeconds <= Time)
+	{
+		PlaybackTime += StepSeconds;
+
+		for (TPair<uint32, FObjectState>& Pair : Objects)
+		{
+			FObjectState& Object = Pair.Value;
+			if (!Object.bHasClientState)
+			{
+				continue;
+			}
+
+			Object.Interpolator.Tick(StepSeconds, Object.DisplayTransform);
+
+			if (Object.bHasServerState)
+			{
+				const float Error = FVector::Dist(Object.DisplayTransform.GetLocation(), Object.ServerState.Transform.GetLocation());
+				ErrorSum += Error;
+				Stats.MaxLocationError = FMath::Max(Stats.MaxLocationError, Error);
+				Stats.NumSamples++;
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Console commands
+
+static FAutoConsoleCommand CmdPhysicsTraceRecord(
+	TEXT("PhysicsTrace.Record"),
+	TEXT("Start recording physics replication states. Usage: PhysicsTrace.Record [Filename]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Filename = Args.Num() > 0 ? Args[0] : FPaths::ProjectSavedDir() / TEXT("PhysicsTraces") / FString::Printf(TEXT("%s.prtrace"), *FDateTime::Now().ToString());
+		FPhysicsTraceRecorder::Get().Start(Filename);
+	}));
+
+static FAutoConsoleCommand CmdPhysicsTraceStop(
+	TEXT("PhysicsTrace.Stop"),
+	TEXT("Stop recording physics replication states."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FPhysicsTraceRecorder::Get().Stop();
+	}));
+
+static FAutoConsoleCommand CmdPhysicsTracePlay(
+	TEXT("PhysicsTrace.Play"),
+	TEXT("Replay a trace through the client interpolation offline. Usage: PhysicsTrace.Play Filename [PlayerId] [StepSeconds]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogPhysicsTrace, Warning, TEXT("Usage: PhysicsTrace.Play Filename [PlayerId] [StepSeconds]"));
+			return;
+		}
+
+		FPhysicsTraceReader Reader;
+		if (!Reader.Open(Args[0]))
+		{
+			return;
+		}
+
+		const int32 ClientIndex = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : INDEX_NONE;
+		const float StepSeconds = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 1.f / 60.f;
+
+		FPhysicsTracePlayer Player(ClientIndex, StepSeconds);
+		const FPhysicsTracePlaybackStats Stats = Player.Play(Reader);
+
+		UE_LOG(LogPhysicsTrace, Log, TEXT("Played %d records (%.2fs of trace) in %.3fs (%.1fx real time). Samples: %d, average error: %.2f, max error: %.2f"),
+			Stats.NumRecords, Stats.TraceDuration, Stats.WallDuration, Stats.GetSpeedup(), Stats.NumSamples, Stats.AverageLocationError, Stats.MaxLocationError);
+	}));
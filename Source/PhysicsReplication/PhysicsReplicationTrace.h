@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Physicable.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Physics replication traces.
+ *
+ * A trace is a stream of physicable states as the server produced them and as each client received them. It is written
+ * in fixed size chunks that are compressed independently, so a recording can be streamed to disk while the game runs
+ * and read back chunk by chunk from a memory mapped file.
+ *
+ * File layout:
+ *   FPhysicsTraceFileHeader
+ *   repeated { FPhysicsTraceChunkHeader, CompressedSize bytes of zlib compressed records }
+ */
+
+enum class EPhysicsTraceSource : uint8
+{
+	Server,				// State produced by the server in APhysicable::UpdatePhysicsState
+	ClientReceived,		// State received by a client in APhysicable::SimulatedProxy_PhysicsState
+};
+
+struct PHYSICSREPLICATION_API FPhysicsTraceRecord
+{
+	/** Seconds since the recording started. */
+	double				Time { 0 };
+
+	/** Stable id of the physicable, identical on server and clients. */
+	uint32				ObjectId { 0 };
+
+	EPhysicsTraceSource	Source { EPhysicsTraceSource::Server };
+
+	/** Player id of the client that recorded this state, INDEX_NONE before it has one. Zero for server states. */
+	int32				ClientIndex { 0 };
+
+	FPhysicsStateActor	State;
+
+	/** VelocityDifference at the time of the record, used as the interpolation start velocity on clients. */
+	FVector				StartVelocity { FVector::ZeroVector };
+
+	friend FArchive& operator<<(FArchive& Ar, FPhysicsTraceRecord& Record);
+};
+
+struct FPhysicsTraceFileHeader
+{
+	static const uint32	ExpectedMagic = 0x52545250; // 'PRTR'
+	static const uint32	CurrentVersion = 3;	// 2: ServerTimeStamp, IslandId and IslandSize. 3: ObjectId from the NetGUID, ClientIndex is the player id
+
+	uint32				Magic { ExpectedMagic };
+	uint32				Version { CurrentVersion };
+
+	friend FArchive& operator<<(FArchive& Ar, FPhysicsTraceFileHeader& Header)
+	{
+		return Ar << Header.Magic << Header.Version;
+	}
+};
+
+struct FPhysicsTraceChunkHeader
+{
+	uint32				UncompressedSize { 0 };
+	uint32				CompressedSize { 0 };
+	uint32				NumRecords { 0 };
+
+	friend FArchive& operator<<(FArchive& Ar, FPhysicsTraceChunkHeader& Header)
+	{
+		return Ar << Header.UncompressedSize << Header.CompressedSize << Header.NumRecords;
+	}
+
+	static constexpr int64 SerializedSize = 3 * sizeof(uint32);
+};
+
+/** Streams records to disk, compressing each chunk once it reaches ChunkSize bytes. */
+class PHYSICSREPLICATION_API FPhysicsTraceWriter
+{
+public:
+
+	explicit FPhysicsTraceWriter(int32 InChunkSize = 64 * 1024);
+	~FPhysicsTraceWriter();
+
+	bool				Open(const FString& Filename);
+
+	void				Append(FPhysicsTraceRecord& Record);
+
+	/** Compress and write whatever is buffered, even if the chunk is not full. */
+	void				Flush();
+
+	void				Close();
+
+	bool				IsOpen() const { return FileHandle != nullptr; }
+
+private:
+
+	IFileHandle*		FileHandle { nullptr };
+
+	int32				ChunkSize;
+
+	uint32				NumChunkRecords { 0 };
+
+	TArray<uint8>		ChunkBuffer;
+
+	TArray<uint8>		CompressedBuffer;
+};
+
+/** Reads a trace through a memory mapped view of the file, decompressing one chunk at a time. */
+class PHYSICSREPLICATION_API FPhysicsTraceReader
+{
+public:
+
+	~FPhysicsTraceReader();
+
+	bool				Open(const FString& Filename);
+
+	void				Close();
+
+	/** Decompress the next chunk into OutRecords (replacing its content). Returns false at the end of the trace or on a corrupt chunk. */
+	bool				ReadNextChunk(TArray<FPhysicsTraceRecord>& OutRecords);
+
+private:
+
+	IMappedFileHandle*	MappedHandle { nullptr };
+
+	IMappedFileRegion*	MappedRegion { nullptr };
+
+	const uint8*		Data { nullptr };
+
+	int64				DataSize { 0 };
+
+	int64				Offset { 0 };
+
+	TArray<uint8>		ChunkBuffer;
+};
+
+/** Records states from every world in the process while a recording is active. */
+class PHYSICSREPLICATION_API FPhysicsTraceRecorder
+{
+public:
+
+	static FPhysicsTraceRecorder& Get();
+
+	bool				Start(const FString& Filename);
+
+	void				Stop();
+
+	FORCEINLINE bool	IsRecording() const { return Writer.IsOpen(); }
+
+	void				RecordState(const APhysicable* Physicable, EPhysicsTraceSource Source, const FPhysicsStateActor& State, const FVector& StartVelocity);
+
+	/** Id used to match the same physicable across server and client worlds: its NetGUID, assigned by the server. */
+	static uint32		GetObjectId(const AActor* Actor);
+
+	/** Player id of the local player of a client world, the same in and outside PIE. */
+	static int32		GetClientIndex(const UWorld* World);
+
+private:
+
+	FPhysicsTraceWriter	Writer;
+
+	double				StartTime { 0 };
+};
+
+struct PHYSICSREPLICATION_API FPhysicsTracePlaybackStats
+{
+	int32				NumRecords { 0 };
+
+	int32				NumSamples { 0 };
+
+	double				TraceDuration { 0 };
+
+	double				WallDuration { 0 };
+
+	float				AverageLocationError { 0 };
+
+	float				MaxLocationError { 0 };
+
+	float				GetSpeedup() const { return WallDuration > 0 ? TraceDuration / WallDuration : 0; }
+};
+
+/**
+ * Replays the states one client received through FPhysicableInterpolator, as fast as possible, and measures the displayed
+ * location against the latest server state of each object at a fixed sample rate.
+ */
+class PHYSICSREPLICATION_API FPhysicsTracePlayer
+{
+public:
+
+	/** InClientIndex is the player id of the client to replay, INDEX_NONE for the first client in the trace. */
+	FPhysicsTracePlayer(int32 InClientIndex, float InStepSeconds = 1.f / 60.f);
+
+	FPhysicsTracePlaybackStats	Play(FPhysicsTraceReader& Reader);
+
+private:
+
+	struct FObjectState
+	{
+		FPhysicableInterpolator	Interpolator;
+		FTransform				DisplayTransform { FTransform::Identity };
+		FPhysicsStateActor		ServerState;
+		bool					bHasServerState { false };
+		bool					bHasClientState { false };
+	};
+
+	void				AdvanceTo(double Time, FPhysicsTracePlaybackStats& Stats, double& ErrorSum);
+
+	int32				ClientIndex;
+
+	float				StepSeconds;
+
+	double				PlaybackTime { 0 };
+
+	TMap<uint32, FObjectState>	Objects;
+};
@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsSerializationBenchmarkCommandlet.h"
+#include "PhysicsNetEmulator.h"
+
+#include "HAL/PlatformTLS.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/StrongObjectPtr.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsSerializationBenchmark, Log, All);
+
+namespace PhysicsSerializationBenchmark
+{
+	/** Forwards to the real allocator and counts the allocations made by the benchmark thread. */
+	class FCountingMalloc : public FMalloc
+	{
+	public:
+
+		explicit FCountingMalloc(FMalloc* InUsedMalloc)
+			: UsedMalloc(InUsedMalloc)
+			, ThreadId(FPlatformTLS::GetCurrentThreadId())
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+		{
+			Count();
+			return UsedMalloc->Malloc(Size, Alignment);
+		}
+
+		virtual void* Realloc(void* Ptr, SIZE_T NewSize, uint32 Alignment) override
+		{
+			Count();
+			return UsedMalloc->Realloc(Ptr, NewSize, Alignment);
+		}
+
+		virtual void Free(void* Ptr) override
+		{
+			UsedMalloc->Free(Ptr);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return UsedMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return UsedMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { UsedMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { UsedMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { UsedMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return UsedMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return UsedMalloc->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return UsedMalloc->GetDescriptiveName(); }
+
+		FMalloc*		UsedMalloc;
+
+		uint32			ThreadId;
+
+		int64			NumAllocations { 0 };
+
+	private:
+
+		FORCEINLINE void Count()
+		{
+			if (FPlatformTLS::GetCurrentThreadId() == ThreadId)
+			{
+				NumAllocations++;
+			}
+		}
+	};
+
+	struct FResult
+	{
+		FString			Name;
+		int64			NumOps { 0 };
+		double			NsPerOp { 0 };
+		double			AllocationsPerOp { 0 };
+		double			AverageBits { 0 };
+		int64			P99Bits { 0 };
+	};
+
+	/** A serialized message, kept so the read cases decode exactly what the write cases produced. */
+	struct FMessage
+	{
+		TArray<uint8>	Data;
+		int64			NumBits { 0 };
+	};
+
+	static void ResetWriter(FNetBitWriter& Writer)
+	{
+		FBitWriterMark Mark;
+		Mark.Pop(Writer);
+	}
+
+	static void FillBitStats(const TArray<FMessage>& Messages, FResult& Result)
+	{
+		TArray<int64> Bits;
+		Bits.Reserve(Messages.Num());
+
+		int64 TotalBits = 0;
+		for (const FMessage& Message : Messages)
+		{
+			Bits.Add(Message.NumBits);
+			TotalBits += Message.NumBits;
+		}
+
+		if (Bits.Num() == 0)
+		{
+			return;
+		}
+
+		Bits.Sort();
+		Result.AverageBits = double(TotalBits) / Bits.Num();
+		Result.P99Bits = Bits[FMath::Clamp(FMath::CeilToInt(Bits.Num() * 0.99) - 1, 0, Bits.Num() - 1)];
+	}
+
+	/** Run Body(SampleIndex) for every sample, Iterations times, and fill the timing and allocation columns of Result. */
+	template<typename BodyType>
+	static void Measure(FCountingMalloc& CountingMalloc, int32 NumSamples, int32 Iterations, FResult& Result, BodyType&& Body)
+	{
+		// One untimed pass, so buffers reach their steady state size before anything is counted.
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			Body(SampleIndex);
+		}
+
+		const int64 StartAllocations = CountingMalloc.NumAllocations;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+		{
+			for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+			{
+				Body(SampleIndex);
+			}
+		}
+
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		Result.NumOps = int64(NumSamples) * Iterations;
+		if (Result.NumOps > 0)
+		{
+			Result.NsPerOp = FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1e9 / Result.NumOps;
+			Result.AllocationsPerOp = double(CountingMalloc.NumAllocations - StartAllocations) / Result.NumOps;
+		}
+	}
+
+	static void StoreMessage(const FNetBitWriter& Writer, FMessage& Message)
+	{
+		Message.NumBits = Writer.GetNumBits();
+		Message.Data.Reset();
+		Message.Data.Append(Writer.GetData(), Writer.GetNumBytes());
+	}
+
+	static void WriteResults(const FString& OutputBase, int32 Seed, int32 NumSamples, int32 Iterations, const TArray<FResult>& Results)
+	{
+		TArray<FString> CsvLines;
+		CsvLines.Add(TEXT("Name,Ops,NsPerOp,AllocationsPerOp,AverageBits,P99Bits"));
+
+		FString Json = FString::Printf(TEXT("{\n\t\"seed\": %d,\n\t\"samples\": %d,\n\t\"iterations\": %d,\n\t\"results\": [\n"), Seed, NumSamples, Iterations);
+
+		for (int32 Index = 0; Index < Results.Num(); Index++)
+		{
+			const FResult& Result = Results[Index];
+
+			CsvLines.Add(FString::Printf(TEXT("%s,%lld,%.2f,%.3f,%.2f,%lld"),
+				*Result.Name, Result.NumOps, Result.NsPerOp, Result.AllocationsPerOp, Result.AverageBits, Result.P99Bits));
+
+			Json += FString::Printf(TEXT("\t\t{ \"name\": \"%s\", \"ops\": %lld, \"ns_per_op\": %.2f, \"allocations_per_op\": %.3f, \"average_bits\": %.2f, \"p99_bits\": %lld }%s\n"),
+				*Result.Name, Result.NumOps, Result.NsPerOp, Result.AllocationsPerOp, Result.AverageBits, Result.P99Bits,
+				Index + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+		}
+
+		Json += TEXT("\t]\n}\n");
+
+		const FString CsvFilename = OutputBase + TEXT(".csv");
+		const FString JsonFilename = OutputBase + TEXT(".json");
+
+		if (!FFileHelper::SaveStringArrayToFile(CsvLines, *CsvFilename) || !FFileHelper::SaveStringToFile(Json, *JsonFilename))
+		{
+			UE_LOG(LogPhysicsSerializationBenchmark, Error, TEXT("Could not write %s(.csv|.json)"), *OutputBase);
+			return;
+		}
+
+		UE_LOG(LogPhysicsSerializationBenchmark, Display, TEXT("Results written to %s and %s"), *CsvFilename, *JsonFilename);
+	}
+}
+
+UPhysicsSerializationBenchmarkCommandlet::UPhysicsSerializationBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPhysicsSerializationBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace PhysicsSerializationBenchmark;
+
+	int32 NumSamples = 4096;
+	int32 Iterations = 50;
+	int32 Seed = 1;
+	FString OutputBase = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("PhysicsSerialization-%s"), *FDateTime::Now().ToString());
+
+	FParse::Value(*Params, TEXT("Samples="), NumSamples);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Output="), OutputBase);
+
+	NumSamples = FMath::Max(NumSamples, 1);
+	Iterations = FMath::Max(Iterations, 1);
+
+	// Inputs: a client walking around at 60Hz, the moves it saved, what the server answered, and a physicable's state stream.
+	FPhysicsNetSampleGenerator Generator(Seed);
+	FRandomStream& Random = Generator.Random;
+
+	TStrongObjectPtr<UPhysicsMovementComponent> Movement(NewObject<UPhysicsMovementComponent>());
+	FNetworkPredictionData_Client_Physics* ClientData = Movement->GetPredictionData_Client_Physics();
+
+	const float MoveDeltaTime = 1.f / 60.f;
+	TArray<FSavedPhysicsMovePtr> Moves;
+	Moves.Reserve(NumSamples);
+	{
+		FVector Location = FVector::ZeroVector;
+		FVector Velocity = FVector::ZeroVector;
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			FSavedPhysicsMovePtr Move = MakeShared<FSavedMove_Physics>();
+			Move->Clear();
+			Move->TimeStamp = (SampleIndex + 1) * MoveDeltaTime;
+			Move->DeltaTime = MoveDeltaTime;
+			Generator.NextMoveInput(MoveDeltaTime, Move->Acceleration, Move->SavedControlRotation);
+			FPhysicsNetSampleGenerator::IntegrateMove(Location, Velocity, Move->Acceleration, MoveDeltaTime, Movement->MaxSpeed);
+			Move->SavedLocation = Location;
+			Move->SavedVelocity = Velocity;
+			// As set by PostUpdate_Record; new moves and correction references are encoded against these.
+			Move->ReportedLocation = Location;
+			Move->ReportedVelocity = Velocity;
+			Moves.Add(Move);
+		}
+	}
+
+	// Responses are about one of the moves the client still has saved, so the read side can resolve them.
+	const int32 NumSavedMoves = FMath::Min(NumSamples, ClientData->MaxSavedMoveCount);
+	ClientData->SavedMoves.Append(Moves.GetData(), NumSavedMoves);
+
+	TArray<FClientAdjustmentPhysic> Adjustments;
+	Adjustments.SetNum(NumSamples);
+	for (FClientAdjustmentPhysic& Adjustment : Adjustments)
+	{
+		const FSavedMove_Physics& Move = *ClientData->SavedMoves[Random.RandHelper(NumSavedMoves)];
+		Adjustment.TimeStamp = Move.TimeStamp;
+
+		// Mostly acks, as on a healthy connection; corrections are usually small, sometimes a teleport.
+		Adjustment.bAckGoodMove = Random.FRand() < 0.8f;
+		if (!Adjustment.bAckGoodMove)
+		{
+			const float ErrorSize = Random.FRand() < 0.9f ? Random.FRandRange(1.f, 50.f) : Random.FRandRange(1000.f, 10000.f);
+			Adjustment.NewLoc = Move.ReportedLocation + Random.GetUnitVector() * ErrorSize;
+			Adjustment.NewVel = Move.ReportedVelocity + Random.GetUnitVector() * Random.FRandRange(0.f, 200.f);
+			Adjustment.bHasClientReference = true;
+			Adjustment.ClientLoc = FPhysicMoveResponseDataContainer::QuantizeReportedLocation(Move.ReportedLocation);
+			Adjustment.ClientVel = FPhysicMoveResponseDataContainer::QuantizeReportedVelocity(Move.ReportedVelocity);
+		}
+	}
+
+	TArray<FPhysicsStateActor> States;
+	States.Reserve(NumSamples);
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+	{
+		States.Add(Generator.AdvanceBody(1.f / 60.f));
+	}
+
+	FCountingMalloc* CountingMalloc = new FCountingMalloc(GMalloc);
+	GMalloc = CountingMalloc;
+
+	TArray<FResult> Results;
+	FNetBitWriter Writer(nullptr, PHYSICS_SERIALIZATION_PACKEDBITS_RESERVED_SIZE);
+	Writer.SetAllowResize(true);
+	FNetBitReader Reader(nullptr, nullptr, 0);
+
+	// Client move container: a new move, with a pending move every fourth frame like a combined dual move.
+	{
+		FPhysicNetworkMoveDataContainer Container;
+		TArray<FMessage> Messages;
+		Messages.SetNum(NumSamples);
+
+		FResult& Write = Results.AddDefaulted_GetRef();
+		Write.Name = TEXT("MoveContainer.Write");
+		Measure(*CountingMalloc, NumSamples, Iterations, Write, [&](int32 SampleIndex)
+		{
+			const FSavedMove_Physics* PendingMove = (SampleIndex > 0 && SampleIndex % 4 == 0) ? Moves[SampleIndex - 1].Get() : nullptr;
+			Container.ClientFillNetworkMoveData(Moves[SampleIndex].Get(), PendingMove, nullptr);
+			ResetWriter(Writer);
+			Container.Serialize(*Movement, Writer, nullptr);
+		});
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			const FSavedMove_Physics* PendingMove = (SampleIndex > 0 && SampleIndex % 4 == 0) ? Moves[SampleIndex - 1].Get() : nullptr;
+			Container.ClientFillNetworkMoveData(Moves[SampleIndex].Get(), PendingMove, nullptr);
+			ResetWriter(Writer);
+			Container.Serialize(*Movement, Writer, nullptr);
+			StoreMessage(Writer, Messages[SampleIndex]);
+		}
+		FillBitStats(Messages, Write);
+
+		FResult& Read = Results.AddDefaulted_GetRef();
+		Read.Name = TEXT("MoveContainer.Read");
+		Measure(*CountingMalloc, NumSamples, Iterations, Read, [&](int32 SampleIndex)
+		{
+			Reader.SetData(Messages[SampleIndex].Data.GetData(), Messages[SampleIndex].NumBits);
+			Container.Serialize(*Movement, Reader, nullptr);
+		});
+		FillBitStats(Messages, Read);
+
+		// The packed bits wrapper the move goes through as an RPC parameter.
+		FPhysicServerMovePackedBits PackedBits;
+		TArray<FMessage> PackedMessages;
+		PackedMessages.SetNum(NumSamples);
+
+		FResult& PackedWrite = Results.AddDefaulted_GetRef();
+		PackedWrite.Name = TEXT("PackedBits.Write");
+		Measure(*CountingMalloc, NumSamples, Iterations, PackedWrite, [&](int32 SampleIndex)
+		{
+			const FMessage& Message = Messages[SampleIndex];
+			PackedBits.DataBits.SetNumUninitialized(Message.NumBits);
+			FMemory::Memcpy(PackedBits.DataBits.GetData(), Message.Data.GetData(), Message.Data.Num());
+			ResetWriter(Writer);
+			bool bSuccess = true;
+			PackedBits.NetSerialize(Writer, nullptr, bSuccess);
+		});
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			const FMessage& Message = Messages[SampleIndex];
+			PackedBits.DataBits.SetNumUninitialized(Message.NumBits);
+			FMemory::Memcpy(PackedBits.DataBits.GetData(), Message.Data.GetData(), Message.Data.Num());
+			ResetWriter(Writer);
+			bool bSuccess = true;
+			PackedBits.NetSerialize(Writer, nullptr, bSuccess);
+			StoreMessage(Writer, PackedMessages[SampleIndex]);
+		}
+		FillBitStats(PackedMessages, PackedWrite);
+
+		FResult& PackedRead = Results.AddDefaulted_GetRef();
+		PackedRead.Name = TEXT("PackedBits.Read");
+		Measure(*CountingMalloc, NumSamples, Iterations, PackedRead, [&](int32 SampleIndex)
+		{
+			Reader.SetData(PackedMessages[SampleIndex].Data.GetData(), PackedMessages[SampleIndex].NumBits);
+			bool bSuccess = true;
+			PackedBits.NetSerialize(Reader, nullptr, bSuccess);
+		});
+		FillBitStats(PackedMessages, PackedRead);
+	}
+
+	// Server move response: acks and corrections.
+	{
+		FPhysicMoveResponseDataContainer Container;
+		TArray<FMessage> Messages;
+		Messages.SetNum(NumSamples);
+
+		FResult& Write = Results.AddDefaulted_GetRef();
+		Write.Name = TEXT("MoveResponse.Write");
+		Measure(*CountingMalloc, NumSamples, Iterations, Write, [&](int32 SampleIndex)
+		{
+			Container.ServerFillResponseData(*Movement, Adjustments[SampleIndex]);
+			ResetWriter(Writer);
+			Container.Serialize(*Movement, Writer, nullptr);
+		});
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			Container.ServerFillResponseData(*Movement, Adjustments[SampleIndex]);
+			ResetWriter(Writer);
+			Container.Serialize(*Movement, Writer, nullptr);
+			StoreMessage(Writer, Messages[SampleIndex]);
+		}
+		FillBitStats(Messages, Write);
+
+		FResult& Read = Results.AddDefaulted_GetRef();
+		Read.Name = TEXT("MoveResponse.Read");
+		Measure(*CountingMalloc, NumSamples, Iterations, Read, [&](int32 SampleIndex)
+		{
+			Reader.SetData(Messages[SampleIndex].Data.GetData(), Messages[SampleIndex].NumBits);
+			Container.Serialize(*Movement, Reader, nullptr);
+		});
+		FillBitStats(Messages, Read);
+	}
+
+	// Physicable state.
+	{
+		TArray<FMessage> Messages;
+		Messages.SetNum(NumSamples);
+
+		FResult& Write = Results.AddDefaulted_GetRef();
+		Write.Name = TEXT("PhysicsState.Write");
+		Measure(*CountingMalloc, NumSamples, Iterations, Write, [&](int32 SampleIndex)
+		{
+			ResetWriter(Writer);
+			bool bSuccess = true;
+			States[SampleIndex].NetSerialize(Writer, nullptr, bSuccess);
+		});
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			ResetWriter(Writer);
+			bool bSuccess = true;
+			States[SampleIndex].NetSerialize(Writer, nullptr, bSuccess);
+			StoreMessage(Writer, Messages[SampleIndex]);
+		}
+		FillBitStats(Messages, Write);
+
+		FPhysicsStateActor ReadState;
+		FResult& Read = Results.AddDefaulted_GetRef();
+		Read.Name = TEXT("PhysicsState.Read");
+		Measure(*CountingMalloc, NumSamples, Iterations, Read, [&](int32 SampleIndex)
+		{
+			Reader.SetData(Messages[SampleIndex].Data.GetData(), Messages[SampleIndex].NumBits);
+			bool bSuccess = true;
+			ReadState.NetSerialize(Reader, nullptr, bSuccess);
+		});
+		FillBitStats(Messages, Read);
+	}
+
+	// Control rotation packing.
+	{
+		volatile uint32 Sink = 0;
+		FResult& Pack = Results.AddDefaulted_GetRef();
+		Pack.Name = TEXT("PackYawAndPitchTo32");
+		Measure(*CountingMalloc, NumSamples, Iterations, Pack, [&](int32 SampleIndex)
+		{
+			const FRotator& Rotation = Moves[SampleIndex]->SavedControlRotation;
+			Sink = Sink ^ UPhysicsMovementComponent::PackYawAndPitchTo32(Rotation.Yaw, Rotation.Pitch);
+		});
+		Pack.AverageBits = 32;
+		Pack.P99Bits = 32;
+	}
+
+	// Memory allocated while counting is freed by the same underlying allocator, so the proxy can go away now.
+	GMalloc = CountingMalloc->UsedMalloc;
+	delete CountingMalloc;
+
+	ClientData->SavedMoves.Reset();
+
+	for (const FResult& Result : Results)
+	{
+		UE_LOG(LogPhysicsSerializationBenchmark, Display, TEXT("%-24s %10.2f ns/op %8.3f allocs/op %8.2f bits avg %6lld bits p99"),
+			*Result.Name, Result.NsPerOp, Result.AllocationsPerOp, Result.AverageBits, Result.P99Bits);
+	}
+
+	WriteResults(OutputBase, Seed, NumSamples, Iterations, Results);
+
+	return 0;
+}
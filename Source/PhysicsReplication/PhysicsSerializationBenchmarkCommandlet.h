@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PhysicsSerializationBenchmarkCommandlet.generated.h"
+
+/**
+ * Microbenchmarks for the replication serializers, run over moves and states from FPhysicsNetSampleGenerator.
+ *
+ * UE4Editor-Cmd PhysicsReplication -run=PhysicsSerializationBenchmark -Samples=4096 -Iterations=50 -Seed=1
+ *
+ * Reports ns/op, allocations/op and average/p99 bits per message for each case, and writes them as CSV and JSON to
+ * Saved/Benchmarks (or -Output=<path without extension>) so runs can be diffed between commits.
+ */
+UCLASS()
+class PHYSICSREPLICATION_API UPhysicsSerializationBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsSerializationBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
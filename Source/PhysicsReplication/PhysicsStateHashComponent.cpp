@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicsStateHashComponent.h"
+
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPhysicsStateHash, Log, All);
+
+UPhysicsStateHashComponent::UPhysicsStateHashComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UPhysicsStateHashComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	if (PlayerController == nullptr || !PlayerController->IsLocalController() || GetNetMode() != NM_Client)
+	{
+		return;
+	}
+
+	TimeSinceReport += DeltaTime;
+	if (TimeSinceReport >= ReportInterval)
+	{
+		TimeSinceReport = 0;
+		SendReport();
+	}
+}
+
+float UPhysicsStateHashComponent::GetMismatchRate() const
+{
+	const int64 NumChecked = NumMatches + NumMismatches;
+	return NumChecked > 0 ? float(NumMismatches) / NumChecked : 0.f;
+}
+
+int32 UPhysicsStateHashComponent::GetNumConfirmed() const
+{
+	int32 NumConfirmed = 0;
+	for (const TPair<TWeakObjectPtr<APhysicable>, uint32>& Pair : ConfirmedHashes)
+	{
+		const APhysicable* Physicable = Pair.Key.Get();
+		if (Physicable && Pair.Value == Physicable->PhysicsState.GetQuantizedHash())
+		{
+			NumConfirmed++;
+		}
+	}
+	return NumConfirmed;
+}
+
+void UPhysicsStateHashComponent::SendReport()
+{
+	TArray<FPhysicsStateHashReport> Reports;
+	int32 Index = 0;
+
+	for (TActorIterator<APhysicable> It(GetWorld()); It; ++It)
+	{
+		FPhysicsStateHashReport Report;
+		if (!It->GetClientStateHash(Report.TimeStamp, Report.Hash))
+		{
+			continue;
+		}
+
+		if (Index++ < ReportCursor)
+		{
+			continue;
+		}
+
+		Report.Physicable = *It;
+		Reports.Add(Report);
+
+		if (Reports.Num() >= MaxHashesPerReport)
+		{
+			break;
+		}
+	}
+
+	// Start over once the end of the list is reached.
+	ReportCursor = Reports.Num() < MaxHashesPerReport ? 0 : ReportCursor + Reports.Num();
+
+	if (Reports.Num() > 0)
+	{
+		ServerReportStateHashes(Reports);
+	}
+}
+
+void UPhysicsStateHashComponent::ServerReportStateHashes_Implementation(const TArray<FPhysicsStateHashReport>& Reports)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (const FPhysicsStateHashReport& Report : Reports)
+	{
+		APhysicable* Physicable = Report.Physicable;
+		if (!IsValid(Physicable))
+		{
+			continue;
+		}
+
+		NumReports++;
+
+		const EPhysicsStateHashCheck Check = Physicable->CheckClientStateHash(Report.TimeStamp, Report.Hash);
+		if (Check == EPhysicsStateHashCheck::Match)
+		{
+			NumMatches++;
+			ConfirmedHashes.Add(Physicable, Report.Hash);
+			continue;
+		}
+
+		if (Check == EPhysicsStateHashCheck::Unknown)
+		{
+			continue;
+		}
+
+		NumMismatches++;
+		ConfirmedHashes.Remove(Physicable);
+
+		const float* LastResendTime = LastResendTimes.Find(Physicable);
+		if (LastResendTime && Now - *LastResendTime < ResendCooldown)
+		{
+			continue;
+		}
+
+		UE_LOG(LogPhysicsStateHash, Verbose, TEXT("%s: state hash mismatch for %s, resending"), *GetNameSafe(GetOwner()), *Physicable->GetName());
+
+		LastResendTimes.Add(Physicable, Now);
+		NumResends++;
+		ClientResendState(Physicable, Physicable->PhysicsState);
+	}
+
+	// Forget physicables that are gone.
+	for (auto It = LastResendTimes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto It = ConfirmedHashes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UPhysicsStateHashComponent::ClientResendState_Implementation(APhysicable* Physicable, const FPhysicsStateActor& State)
+{
+	if (Physicable)
+	{
+		Physicable->ApplyResentState(State);
+	}
+}
+
+static FAutoConsoleCommand CmdPhysicsStateHashDump(
+	TEXT("PhysicsStateHash.Dump"),
+	TEXT("Log the state hash checks, mismatches and confirmed physicables since the last reset, per connection."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UPhysicsStateHashComponent> It; It; ++It)
+		{
+			const UWorld* World = It->GetWorld();
+			const APlayerController* PlayerController = Cast<APlayerController>(It->GetOwner());
+			if (World == nullptr || !World->IsGameWorld() || World->GetNetMode() == NM_Client || PlayerController == nullptr || PlayerController->IsLocalController())
+			{
+				continue;
+			}
+
+			UE_LOG(LogPhysicsStateHash, Display, TEXT("%s %s: %lld hashes reported, %lld matches, %lld mismatches (%.2f%%), %lld states resent, %d physicables confirmed"),
+				*World->GetName(), *GetNameSafe(PlayerController->GetNetConnection()), It->NumReports, It->NumMatches, It->NumMismatches,
+				It->GetMismatchRate() * 100.f, It->NumResends, It->GetNumConfirmed());
+		}
+	}));
+
+static FAutoConsoleCommand CmdPhysicsStateHashReset(
+	TEXT("PhysicsStateHash.Reset"),
+	TEXT("Clear the state hash counters."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UPhysicsStateHashComponent> It; It; ++It)
+		{
+			It->NumReports = 0;
+			It->NumMatches = 0;
+			It->NumMismatches = 0;
+			It->NumResends = 0;
+		}
+	}));
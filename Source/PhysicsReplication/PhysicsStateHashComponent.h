@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Physicable.h"
+#include "PhysicsStateHashComponent.generated.h"
+
+/** Hash of what a client shows for one physicable, and the time stamp of the state it shows. */
+USTRUCT()
+struct FPhysicsStateHashReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APhysicable*	Physicable { nullptr };
+
+	/** Wrapped time stamp of the state, see FPhysicsStateActor::GetWrappedTimeStamp(). */
+	UPROPERTY()
+	uint16			TimeStamp { 0 };
+
+	UPROPERTY()
+	uint32			Hash { 0 };
+};
+
+/**
+ * Detects physicables whose client state diverged from the server, without streaming states to find out.
+ *
+ * The owning client reports, round robin, the quantized hash of the transform it shows for every physicable that reached its last
+ * received state. The server compares each with the hash of the state it sent for the same time stamp, and resends the full state to
+ * that client only when they differ. This component lives on the player controller, so confirmations and counters are kept for its
+ * connection alone, see PhysicsStateHash.Dump.
+ */
+UCLASS(ClassGroup=(Physics), meta=(BlueprintSpawnableComponent))
+class PHYSICSREPLICATION_API UPhysicsStateHashComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPhysicsStateHashComponent();
+
+	virtual void		TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Server only. Mismatches over checks with a verdict for this connection, since the last reset. */
+	float				GetMismatchRate() const;
+
+	/** Server only. Physicables whose last state sent this client confirmed. */
+	int32				GetNumConfirmed() const;
+
+	/** Server only. Counters of this connection, since the last reset. */
+	int64				NumReports { 0 };
+
+	int64				NumMatches { 0 };
+
+	int64				NumMismatches { 0 };
+
+	int64				NumResends { 0 };
+
+protected:
+
+	/** Seconds between two reports. */
+	UPROPERTY(EditDefaultsOnly, Category="State Hash", meta=(ClampMin="0.05"))
+	float				ReportInterval { 0.25f };
+
+	/** Physicables per report. The next report carries on from there. */
+	UPROPERTY(EditDefaultsOnly, Category="State Hash", meta=(ClampMin="1"))
+	int32				MaxHashesPerReport { 32 };
+
+	/** Seconds before the same physicable is resent to this client again. */
+	UPROPERTY(EditDefaultsOnly, Category="State Hash", meta=(ClampMin="0"))
+	float				ResendCooldown { 1.f };
+
+private:
+
+	UFUNCTION(Server, Unreliable)
+	void				ServerReportStateHashes(const TArray<FPhysicsStateHashReport>& Reports);
+
+	/** Unreliable: if it is lost, the next report mismatches again. */
+	UFUNCTION(Client, Unreliable)
+	void				ClientResendState(APhysicable* Physicable, const FPhysicsStateActor& State);
+
+	void				SendReport();
+
+	/** Client. Index of the physicable the next report starts from. */
+	int32				ReportCursor { 0 };
+
+	float				TimeSinceReport { 0 };
+
+	/** Server only. Last time each physicable was resent to this client. */
+	TMap<TWeakObjectPtr<APhysicable>, float>	LastResendTimes;
+
+	/** Server only. Hash of the state this client last confirmed for each physicable. */
+	TMap<TWeakObjectPtr<APhysicable>, uint32>	ConfirmedHashes;
+};